@@ -13,24 +13,31 @@
  ****************************************************************************************/
 
 #include "astronode.h"
+#include "astronode_nvm.h"
+#include "astronode_latency.h"
+#include "astronode_energy.h"
+#include "astronode_cmdstore.h"
 
 ans_status_e ASTRONODE::begin(Stream &serialPort)
+{
+  _serialPort = &serialPort;
+
+  return connect();
+}
+
+ans_status_e ASTRONODE::connect(void)
 {
   if ((_printDebug == true) || (_printFullDebug == true))
   {
     _debugSerial->println(F("ASTRONODE: Connecting to module"));
   }
 
-  _serialPort = &serialPort;
-
   // Set-up UART
-  _serialPort->setTimeout(TIMEOUT_SERIAL);
+  transport_set_timeout(TIMEOUT_SERIAL);
+  _transport_timeout = TIMEOUT_SERIAL;
 
   // Clear buffer
-  while (_serialPort->available() > 0)
-  {
-    _serialPort->read();
-  }
+  transport_discard_input();
 
   // Send dummy command (known bug in Astronode S)
   dummy_cmd();
@@ -39,6 +46,118 @@ ans_status_e ASTRONODE::begin(Stream &serialPort)
   return read_module_state();
 }
 
+#if defined(ASTRONODE_WITH_WARM_START)
+#define WARM_RECORD_VERSION 1
+
+ans_status_e ASTRONODE::begin_warm(Stream &serialPort,
+                                   ASTRONODE_NVM &nvm,
+                                   uint32_t address)
+{
+  _serialPort = &serialPort;
+
+  return warm_connect(&nvm, address);
+}
+
+ans_status_e ASTRONODE::warm_connect(ASTRONODE_NVM *nvm,
+                                     uint32_t address)
+{
+  _warm_nvm = nvm;
+  _warm_address = address;
+  _warm_valid = false;
+
+  // Set-up UART
+  transport_set_timeout(TIMEOUT_SERIAL);
+  _transport_timeout = TIMEOUT_SERIAL;
+
+  // Clear buffer
+  transport_discard_input();
+
+  // Module was not reset since the record was written: configuration and GUID are still valid
+  ASTRONODE_WARM_RECORD record;
+  if (read_module_state() == ANS_STATUS_SUCCESS &&
+      warm_record_load(&record) &&
+      record.last_rst == mst_struct.last_rst &&
+      record.uptime <= mst_struct.uptime)
+  {
+    if ((_printDebug == true) || (_printFullDebug == true))
+    {
+      _debugSerial->println(F("ASTRONODE: Warm start"));
+    }
+    config = record.config;
+    memcpy(_warm_guid, record.guid, sizeof(_warm_guid));
+    _warm_valid = true;
+    _config_valid = true;
+    warm_record_save(); // Latest uptime: a reset after this start is seen even once the uptime passed the old one
+    return ANS_STATUS_SUCCESS;
+  }
+
+  // Full start
+  ans_status_e ret_val = connect();
+  if (ret_val == ANS_STATUS_SUCCESS)
+  {
+    ret_val = configuration_read();
+  }
+  if (ret_val == ANS_STATUS_SUCCESS)
+  {
+    String guid;
+    ret_val = guid_read(&guid);
+    if (ret_val == ANS_STATUS_SUCCESS)
+    {
+      memset(_warm_guid, 0, sizeof(_warm_guid));
+      memcpy(_warm_guid, guid.c_str(), (guid.length() < sizeof(_warm_guid)) ? guid.length() : sizeof(_warm_guid));
+      _warm_valid = true;
+      warm_record_save();
+    }
+  }
+  return ret_val;
+}
+
+bool ASTRONODE::warm_record_load(ASTRONODE_WARM_RECORD *record)
+{
+  if (_warm_nvm == NULL ||
+      !_warm_nvm->read(_warm_address, (uint8_t *)record, sizeof(ASTRONODE_WARM_RECORD)))
+  {
+    return false;
+  }
+  return record->version == WARM_RECORD_VERSION &&
+         record->crc == crc_compute(record->version,
+                                    (uint8_t *)record + 1,
+                                    offsetof(ASTRONODE_WARM_RECORD, crc) - 1,
+                                    0xFFFF);
+}
+
+bool ASTRONODE::warm_record_save(void)
+{
+  if (_warm_nvm == NULL || _warm_valid == false || _config_valid == false)
+  {
+    return false;
+  }
+
+  ASTRONODE_WARM_RECORD record;
+  memset(&record, 0, sizeof(record)); // Deterministic padding for the CRC
+  record.version = WARM_RECORD_VERSION;
+  record.config = config;
+  memcpy(record.guid, _warm_guid, sizeof(record.guid));
+  record.last_rst = mst_struct.last_rst;
+  record.uptime = mst_struct.uptime;
+  record.crc = crc_compute(record.version,
+                           (uint8_t *)&record + 1,
+                           offsetof(ASTRONODE_WARM_RECORD, crc) - 1,
+                           0xFFFF);
+  return _warm_nvm->write(_warm_address, (uint8_t *)&record, sizeof(record));
+}
+
+void ASTRONODE::warm_record_invalidate(void)
+{
+  if (_warm_nvm != NULL)
+  {
+    uint8_t version = 0;
+    _warm_nvm->write(_warm_address, &version, sizeof(version));
+  }
+}
+
+#endif
+
 void ASTRONODE::end()
 {
   // Empty
@@ -96,15 +215,10 @@ ans_status_e ASTRONODE::configuration_write(bool with_pl_ack,
     param_w[2] |= 1 << 3; // Message Transmission (Tx) Pending Event Pin Mask
 
   // Send request
-  uint8_t reg = CFG_WR;
-  ans_status_e ret_val = encode_send_request(reg, param_w, sizeof(param_w));
-  if (ret_val == ANS_STATUS_DATA_SENT)
+  ans_status_e ret_val = transact(CFG_WR, param_w, sizeof(param_w));
+  if (ret_val == ANS_STATUS_SUCCESS)
   {
-    ret_val = receive_decode_answer(&reg, NULL, 0);
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == CFG_WA)
-    {
-      ret_val = ANS_STATUS_SUCCESS;
-    }
+    _config_valid = false;
   }
   return ret_val;
 }
@@ -120,27 +234,23 @@ ans_status_e ASTRONODE::configuration_read(void)
   uint8_t param_a[8] = {};
 
   // Send request
-  uint8_t reg = CFG_RR;
-  ans_status_e ret_val = encode_send_request(reg, NULL, 0);
-  if (ret_val == ANS_STATUS_DATA_SENT)
-  {
-    ret_val = receive_decode_answer(&reg, param_a, sizeof(param_a));
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == CFG_RA)
-    {
-      config.product_id = param_a[0];
-      config.hardware_rev = param_a[1];
-      config.firmware_maj_ver = param_a[2];
-      config.firmware_min_ver = param_a[3];
-      config.firmware_rev = param_a[4];
-      config.with_pl_ack = (param_a[5] & (1 << 0));
-      config.with_geoloc = (param_a[5] & (1 << 1));
-      config.with_ephemeris = (param_a[5] & (1 << 2));
-      config.with_deep_sleep_en = (param_a[5] & (1 << 3));
-      config.with_msg_ack_pin_en = (param_a[7] & (1 << 0));
-      config.with_msg_reset_pin_en = (param_a[7] & (1 << 1));
-
-      ret_val = ANS_STATUS_SUCCESS;
-    }
+  ans_status_e ret_val = transact(CFG_RR, NULL, 0, param_a);
+  if (ret_val == ANS_STATUS_SUCCESS)
+  {
+    config.product_id = param_a[0];
+    config.hardware_rev = param_a[1];
+    config.firmware_maj_ver = param_a[2];
+    config.firmware_min_ver = param_a[3];
+    config.firmware_rev = param_a[4];
+    config.with_pl_ack = (param_a[5] & (1 << 0));
+    config.with_geoloc = (param_a[5] & (1 << 1));
+    config.with_ephemeris = (param_a[5] & (1 << 2));
+    config.with_deep_sleep_en = (param_a[5] & (1 << 3));
+    config.with_msg_ack_pin_en = (param_a[7] & (1 << 0));
+    config.with_msg_reset_pin_en = (param_a[7] & (1 << 1));
+    config.with_msg_cmd_pin_en = (param_a[7] & (1 << 2));
+    config.with_msg_tx_pend_pin_en = (param_a[7] & (1 << 3));
+    _config_valid = true;
   }
   return ret_val;
 }
@@ -152,23 +262,74 @@ ans_status_e ASTRONODE::configuration_save(void)
     _debugSerial->println(F("ASTRONODE: Save configuration"));
   }
 
+#if defined(ASTRONODE_WITH_WARM_START)
+  warm_record_invalidate(); // The saved configuration may differ from the record
+#endif
+
   // Set parameters
   // None
 
   // Send request
-  uint8_t reg = CFG_SR;
-  ans_status_e ret_val = encode_send_request(reg, NULL, 0);
+  return transact(CFG_SR);
+}
 
-  // delay(TIMEOUT_FLASH); // Not ideal location
+ans_status_e ASTRONODE::configuration_sync(bool with_pl_ack,
+                                           bool with_geoloc,
+                                           bool with_ephemeris,
+                                           bool with_deep_sleep,
+                                           bool with_ack_event_pin_mask,
+                                           bool with_reset_event_pin_mask,
+                                           bool with_cmd_event_pin_mask,
+                                           bool with_tx_pend_event_pin_mask)
+{
+  // After a warm start or a read, config already holds the module configuration
+  ans_status_e ret_val = (_config_valid == true) ? ANS_STATUS_SUCCESS : configuration_read();
+  if (ret_val != ANS_STATUS_SUCCESS)
+  {
+    return ret_val;
+  }
 
-  if (ret_val == ANS_STATUS_DATA_SENT)
+  if (config.with_pl_ack == with_pl_ack &&
+      config.with_geoloc == with_geoloc &&
+      config.with_ephemeris == with_ephemeris &&
+      config.with_deep_sleep_en == with_deep_sleep &&
+      config.with_msg_ack_pin_en == with_ack_event_pin_mask &&
+      config.with_msg_reset_pin_en == with_reset_event_pin_mask &&
+      config.with_msg_cmd_pin_en == with_cmd_event_pin_mask &&
+      config.with_msg_tx_pend_pin_en == with_tx_pend_event_pin_mask)
   {
-    ret_val = receive_decode_answer(&reg, NULL, 0);
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == CFG_SA)
+    if ((_printDebug == true) || (_printFullDebug == true))
     {
-      ret_val = ANS_STATUS_SUCCESS;
+      _debugSerial->println(F("ASTRONODE: Configuration unchanged, not saved"));
     }
+    return ANS_STATUS_SUCCESS;
+  }
+
+#if defined(ASTRONODE_WITH_WARM_START)
+  warm_record_invalidate(); // Until the new configuration is read back
+#endif
+  ret_val = configuration_write(with_pl_ack,
+                                with_geoloc,
+                                with_ephemeris,
+                                with_deep_sleep,
+                                with_ack_event_pin_mask,
+                                with_reset_event_pin_mask,
+                                with_cmd_event_pin_mask,
+                                with_tx_pend_event_pin_mask);
+  if (ret_val == ANS_STATUS_SUCCESS)
+  {
+    ret_val = configuration_save();
   }
+  if (ret_val == ANS_STATUS_SUCCESS)
+  {
+    ret_val = configuration_read();
+  }
+#if defined(ASTRONODE_WITH_WARM_START)
+  if (ret_val == ANS_STATUS_SUCCESS)
+  {
+    warm_record_save(); // Keep the warm start record in line with the module
+  }
+#endif
   return ret_val;
 }
 
@@ -193,17 +354,7 @@ ans_status_e ASTRONODE::wifi_configuration_write(const char *wland_ssid,
   memcpy(&param_w[97], auth_token, auth_token_length);
 
   // Send request
-  uint8_t reg = WIF_WR;
-  ans_status_e ret_val = encode_send_request(reg, param_w, sizeof(param_w));
-  if (ret_val == ANS_STATUS_DATA_SENT)
-  {
-    ret_val = receive_decode_answer(&reg, NULL, 0);
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == WIF_WA)
-    {
-      ret_val = ANS_STATUS_SUCCESS;
-    }
-  }
-  return ret_val;
+  return transact(WIF_WR, param_w, sizeof(param_w));
 }
 
 ans_status_e ASTRONODE::satellite_search_config_write(uint8_t search_period,
@@ -226,17 +377,7 @@ ans_status_e ASTRONODE::satellite_search_config_write(uint8_t search_period,
     param_w[1] |= 1 << 0;
 
   // Send request
-  uint8_t reg = SSC_WR;
-  ans_status_e ret_val = encode_send_request(reg, param_w, sizeof(param_w));
-  if (ret_val == ANS_STATUS_DATA_SENT)
-  {
-    ret_val = receive_decode_answer(&reg, NULL, 0);
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == SSC_WA)
-    {
-      ret_val = ANS_STATUS_SUCCESS;
-    }
-  }
-  return ret_val;
+  return transact(SSC_WR, param_w, sizeof(param_w));
 }
 
 ans_status_e ASTRONODE::geolocation_write(int32_t lat,
@@ -257,17 +398,7 @@ ans_status_e ASTRONODE::geolocation_write(int32_t lat,
   memcpy(&param_w[4], &lon, sizeof(lon));
 
   // Send request
-  uint8_t reg = GEO_WR;
-  ans_status_e ret_val = encode_send_request(reg, param_w, sizeof(param_w));
-  if (ret_val == ANS_STATUS_DATA_SENT)
-  {
-    ret_val = receive_decode_answer(&reg, NULL, 0);
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == GEO_WA)
-    {
-      ret_val = ANS_STATUS_SUCCESS;
-    }
-  }
-  return ret_val;
+  return transact(GEO_WR, param_w, sizeof(param_w));
 }
 
 ans_status_e ASTRONODE::factory_reset(void)
@@ -277,22 +408,18 @@ ans_status_e ASTRONODE::factory_reset(void)
     _debugSerial->println(F("ASTRONODE: Factory reset"));
   }
 
+#if defined(ASTRONODE_WITH_WARM_START)
+  warm_record_invalidate(); // Configuration back to default, module reset
+#endif
+
   // Set parameters
   // None
 
   // Send request
-  uint8_t reg = CFG_FR;
-  ans_status_e ret_val = encode_send_request(reg, NULL, 0);
-
-  // delay(TIMEOUT_FLASH); // Not ideal location
-
-  if (ret_val == ANS_STATUS_DATA_SENT)
+  ans_status_e ret_val = transact(CFG_FR);
+  if (ret_val == ANS_STATUS_SUCCESS)
   {
-    ret_val = receive_decode_answer(&reg, NULL, 0);
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == CFG_FA)
-    {
-      ret_val = ANS_STATUS_SUCCESS;
-    }
+    _config_valid = false;
   }
   return ret_val;
 }
@@ -304,22 +431,27 @@ ans_status_e ASTRONODE::guid_read(String *guid)
     _debugSerial->println(F("ASTRONODE: Read GUID"));
   }
 
+#if defined(ASTRONODE_WITH_WARM_START)
+  if (_warm_valid == true)
+  {
+    for (uint8_t i = 0; i < sizeof(_warm_guid); i++)
+    {
+      guid->concat(_warm_guid[i]);
+    }
+    return ANS_STATUS_SUCCESS;
+  }
+#endif
+
   // Set parameters
   uint8_t param_a[36] = {};
 
   // Send request
-  uint8_t reg = MGI_RR;
-  ans_status_e ret_val = encode_send_request(reg, NULL, 0);
-  if (ret_val == ANS_STATUS_DATA_SENT)
+  ans_status_e ret_val = transact(MGI_RR, NULL, 0, param_a);
+  if (ret_val == ANS_STATUS_SUCCESS)
   {
-    ret_val = receive_decode_answer(&reg, param_a, sizeof(param_a));
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == MGI_RA)
+    for (uint8_t i = 0; i < sizeof(param_a); i++)
     {
-      for (uint8_t i = 0; i < sizeof(param_a); i++)
-      {
-        guid->concat((char)param_a[i]);
-      }
-      ret_val = ANS_STATUS_SUCCESS;
+      guid->concat((char)param_a[i]);
     }
   }
   return ret_val;
@@ -336,18 +468,12 @@ ans_status_e ASTRONODE::serial_number_read(String *sn)
   uint8_t param_a[16] = {};
 
   // Send request
-  uint8_t reg = MSN_RR;
-  ans_status_e ret_val = encode_send_request(reg, NULL, 0);
-  if (ret_val == ANS_STATUS_DATA_SENT)
+  ans_status_e ret_val = transact(MSN_RR, NULL, 0, param_a);
+  if (ret_val == ANS_STATUS_SUCCESS)
   {
-    ret_val = receive_decode_answer(&reg, param_a, sizeof(param_a));
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == MSN_RA)
+    for (uint8_t i = 0; i < sizeof(param_a); i++)
     {
-      for (uint8_t i = 0; i < sizeof(param_a); i++)
-      {
-        sn->concat((char)param_a[i]);
-      }
-      ret_val = ANS_STATUS_SUCCESS;
+      sn->concat((char)param_a[i]);
     }
   }
   return ret_val;
@@ -364,18 +490,12 @@ ans_status_e ASTRONODE::product_number_read(String *pn)
   uint8_t param_a[16] = {};
 
   // Send request
-  uint8_t reg = MPN_RR;
-  ans_status_e ret_val = encode_send_request(reg, NULL, 0);
-  if (ret_val == ANS_STATUS_DATA_SENT)
+  ans_status_e ret_val = transact(MPN_RR, NULL, 0, param_a);
+  if (ret_val == ANS_STATUS_SUCCESS)
   {
-    ret_val = receive_decode_answer(&reg, param_a, sizeof(param_a));
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == MPN_RA)
+    for (uint8_t i = 0; i < sizeof(param_a); i++)
     {
-      for (uint8_t i = 0; i < sizeof(param_a); i++)
-      {
-        pn->concat((char)param_a[i]);
-      }
-      ret_val = ANS_STATUS_SUCCESS;
+      pn->concat((char)param_a[i]);
     }
   }
   return ret_val;
@@ -392,20 +512,14 @@ ans_status_e ASTRONODE::rtc_read(uint32_t *time)
   uint8_t param_a[4] = {};
 
   // Send request
-  uint8_t reg = RTC_RR;
-  ans_status_e ret_val = encode_send_request(reg, NULL, 0);
-  if (ret_val == ANS_STATUS_DATA_SENT)
+  ans_status_e ret_val = transact(RTC_RR, NULL, 0, param_a);
+  if (ret_val == ANS_STATUS_SUCCESS)
   {
-    ret_val = receive_decode_answer(&reg, param_a, sizeof(param_a));
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == RTC_RA)
-    {
-      uint32_t time_tmp = (((uint32_t)param_a[3]) << 24) +
-                          (((uint32_t)param_a[2]) << 16) +
-                          (((uint32_t)param_a[1]) << 8) +
-                          (((uint32_t)param_a[0]) << 0);
-      *time = time_tmp + ASTROCAST_REF_UNIX_TIME;
-      ret_val = ANS_STATUS_SUCCESS;
-    }
+    uint32_t time_tmp = (((uint32_t)param_a[3]) << 24) +
+                        (((uint32_t)param_a[2]) << 16) +
+                        (((uint32_t)param_a[1]) << 8) +
+                        (((uint32_t)param_a[0]) << 0);
+    *time = time_tmp + ASTROCAST_REF_UNIX_TIME;
   }
   return ret_val;
 }
@@ -421,24 +535,42 @@ ans_status_e ASTRONODE::read_next_contact_opportunity(uint32_t *delay)
   uint8_t param_a[4] = {};
 
   // Send request
-  uint8_t reg = NCO_RR;
-  ans_status_e ret_val = encode_send_request(reg, NULL, 0);
-  if (ret_val == ANS_STATUS_DATA_SENT)
+  ans_status_e ret_val = transact(NCO_RR, NULL, 0, param_a);
+  if (ret_val == ANS_STATUS_SUCCESS)
   {
-    ret_val = receive_decode_answer(&reg, param_a, sizeof(param_a));
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == NCO_RA)
-    {
-      uint32_t delay_tmp = (((uint32_t)param_a[3]) << 24) +
-                           (((uint32_t)param_a[2]) << 16) +
-                           (((uint32_t)param_a[1]) << 8) +
-                           (((uint32_t)param_a[0] << 0));
-      *delay = delay_tmp;
-      ret_val = ANS_STATUS_SUCCESS;
-    }
+    uint32_t delay_tmp = (((uint32_t)param_a[3]) << 24) +
+                         (((uint32_t)param_a[2]) << 16) +
+                         (((uint32_t)param_a[1]) << 8) +
+                         (((uint32_t)param_a[0] << 0));
+    *delay = delay_tmp;
   }
   return ret_val;
 }
 
+// Offset of each counter in ASTRONODE_PER_STRUCT, indexed by PER_INDEX(PER_TYPE_*)
+static const uint8_t per_counter_offset[PER_TYPE_CNT] PROGMEM = {
+    offsetof(ASTRONODE::ASTRONODE_PER_STRUCT, sat_search_phase_cnt),
+    offsetof(ASTRONODE::ASTRONODE_PER_STRUCT, sat_detect_operation_cnt),
+    offsetof(ASTRONODE::ASTRONODE_PER_STRUCT, signal_demod_phase_cnt),
+    offsetof(ASTRONODE::ASTRONODE_PER_STRUCT, signal_demod_attempt_cnt),
+    offsetof(ASTRONODE::ASTRONODE_PER_STRUCT, signal_demod_success_cnt),
+    offsetof(ASTRONODE::ASTRONODE_PER_STRUCT, ack_demod_attempt_cnt),
+    offsetof(ASTRONODE::ASTRONODE_PER_STRUCT, ack_demod_success_cnt),
+    offsetof(ASTRONODE::ASTRONODE_PER_STRUCT, queued_msg_cnt),
+    offsetof(ASTRONODE::ASTRONODE_PER_STRUCT, dequeued_unack_msg_cnt),
+    offsetof(ASTRONODE::ASTRONODE_PER_STRUCT, ack_msg_cnt),
+    offsetof(ASTRONODE::ASTRONODE_PER_STRUCT, sent_fragment_cnt),
+    offsetof(ASTRONODE::ASTRONODE_PER_STRUCT, ack_fragment_cnt),
+    offsetof(ASTRONODE::ASTRONODE_PER_STRUCT, cmd_demod_attempt_cnt),
+    offsetof(ASTRONODE::ASTRONODE_PER_STRUCT, cmd_demod_success_cnt),
+};
+
+uint32_t *ASTRONODE::per_counter(ASTRONODE_PER_STRUCT *per,
+                                 uint8_t index)
+{
+  return (uint32_t *)((uint8_t *)per + pgm_read_byte(&per_counter_offset[index]));
+}
+
 ans_status_e ASTRONODE::read_performance_counter(void)
 {
   if ((_printDebug == true) || (_printFullDebug == true))
@@ -450,80 +582,26 @@ ans_status_e ASTRONODE::read_performance_counter(void)
   uint8_t param_a[PER_CMD_LENGTH] = {};
 
   // Send request
-  uint8_t reg = PER_RR;
-  ans_status_e ret_val = encode_send_request(reg, NULL, 0);
-  if (ret_val == ANS_STATUS_DATA_SENT)
+  ans_status_e ret_val = transact(PER_RR, NULL, 0, param_a);
+  if (ret_val == ANS_STATUS_SUCCESS)
   {
-    ret_val = receive_decode_answer(&reg, param_a, sizeof(param_a));
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == PER_RA)
+    uint8_t i = 0;
+    do
     {
-      uint8_t i = 0;
-      do
+      uint8_t type = param_a[i++];
+      uint8_t length = param_a[i++];
+      if (type >= PER_TYPE_SAT_SEARCH_PHASE_CNT &&
+          type <= PER_TYPE_CMD_DEMOD_SUCCESS_CNT &&
+          length == sizeof(uint32_t))
       {
-        uint8_t type = param_a[i++];
-        uint8_t length = param_a[i++];
-        switch (type)
-        {
-        case PER_TYPE_SAT_SEARCH_PHASE_CNT:
-          if (length == sizeof(per_struct.sat_search_phase_cnt))
-            memcpy(&per_struct.sat_search_phase_cnt, &param_a[i], length);
-          break;
-        case PER_TYPE_SAT_DETECT_OPERATION_CNT:
-          if (length == sizeof(per_struct.sat_detect_operation_cnt))
-            memcpy(&per_struct.sat_detect_operation_cnt, &param_a[i], length);
-          break;
-        case PER_TYPE_SIGNAL_DEMOD_PHASE_CNT:
-          if (length == sizeof(per_struct.signal_demod_phase_cnt))
-            memcpy(&per_struct.signal_demod_phase_cnt, &param_a[i], length);
-          break;
-        case PER_TYPE_SIGNAL_DEMOD_ATTEMPS_CNT:
-          if (length == sizeof(per_struct.signal_demod_attempt_cnt))
-            memcpy(&per_struct.signal_demod_attempt_cnt, &param_a[i], length);
-          break;
-        case PER_TYPE_SIGNAL_DEMOD_SUCCESS_CNT:
-          if (length == sizeof(per_struct.signal_demod_success_cnt))
-            memcpy(&per_struct.signal_demod_success_cnt, &param_a[i], length);
-          break;
-        case PER_TYPE_ACK_DEMOD_ATTEMPT_CNT:
-          if (length == sizeof(per_struct.ack_demod_attempt_cnt))
-            memcpy(&per_struct.ack_demod_attempt_cnt, &param_a[i], length);
-          break;
-        case PER_TYPE_ACK_DEMOD_SUCCESS_CNT:
-          if (length == sizeof(per_struct.ack_demod_success_cnt))
-            memcpy(&per_struct.ack_demod_success_cnt, &param_a[i], length);
-          break;
-        case PER_TYPE_QUEUED_MSG_CNT:
-          if (length == sizeof(per_struct.queued_msg_cnt))
-            memcpy(&per_struct.queued_msg_cnt, &param_a[i], length);
-          break;
-        case PER_TYPE_DEQUEUED_UNACK_MSG_CNT:
-          if (length == sizeof(per_struct.dequeued_unack_msg_cnt))
-            memcpy(&per_struct.dequeued_unack_msg_cnt, &param_a[i], length);
-          break;
-        case PER_TYPE_ACK_MSG_CNT:
-          if (length == sizeof(per_struct.ack_msg_cnt))
-            memcpy(&per_struct.ack_msg_cnt, &param_a[i], length);
-          break;
-        case PER_TYPE_SENT_FRAGMENT_CNT:
-          if (length == sizeof(per_struct.sent_fragment_cnt))
-            memcpy(&per_struct.sent_fragment_cnt, &param_a[i], length);
-          break;
-        case PER_TYPE_ACK_FRAGMENT_CNT:
-          if (length == sizeof(per_struct.ack_fragment_cnt))
-            memcpy(&per_struct.ack_fragment_cnt, &param_a[i], length);
-          break;
-        case PER_TYPE_CMD_DEMOD_ATTEMPT_CNT:
-          if (length == sizeof(per_struct.cmd_demod_attempt_cnt))
-            memcpy(&per_struct.cmd_demod_attempt_cnt, &param_a[i], length);
-          break;
-        case PER_TYPE_CMD_DEMOD_SUCCESS_CNT:
-          if (length == sizeof(per_struct.cmd_demod_success_cnt))
-            memcpy(&per_struct.cmd_demod_success_cnt, &param_a[i], length);
-          break;
-        }
-        i += length;
-      } while (i < PER_CMD_LENGTH);
-      ret_val = ANS_STATUS_SUCCESS;
+        memcpy(per_counter(&per_struct, PER_INDEX(type)), &param_a[i], length);
+      }
+      i += length;
+    } while (i < PER_CMD_LENGTH);
+    snapshot_publish();
+    if (_energy != NULL)
+    {
+      _energy->performance_counters(per_struct.sat_search_phase_cnt, per_struct.sent_fragment_cnt);
     }
   }
   return ret_val;
@@ -540,17 +618,7 @@ ans_status_e ASTRONODE::save_performance_counter(void)
   // None
 
   // Send request
-  uint8_t reg = PER_SR;
-  ans_status_e ret_val = encode_send_request(reg, NULL, 0);
-  if (ret_val == ANS_STATUS_DATA_SENT)
-  {
-    ret_val = receive_decode_answer(&reg, NULL, 0);
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == PER_SA)
-    {
-      ret_val = ANS_STATUS_SUCCESS;
-    }
-  }
-  return ret_val;
+  return transact(PER_SR);
 }
 
 ans_status_e ASTRONODE::clear_performance_counter(void)
@@ -564,15 +632,10 @@ ans_status_e ASTRONODE::clear_performance_counter(void)
   // None
 
   // Send request
-  uint8_t reg = PER_CR;
-  ans_status_e ret_val = encode_send_request(reg, NULL, 0);
-  if (ret_val == ANS_STATUS_DATA_SENT)
+  ans_status_e ret_val = transact(PER_CR);
+  if (ret_val == ANS_STATUS_SUCCESS)
   {
-    ret_val = receive_decode_answer(&reg, NULL, 0);
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == PER_CA)
-    {
-      ret_val = ANS_STATUS_SUCCESS;
-    }
+    _per_clear_cnt++;
   }
   return ret_val;
 }
@@ -588,45 +651,83 @@ ans_status_e ASTRONODE::read_module_state(void)
   uint8_t param_a[MST_CMD_LENGTH] = {};
 
   // Send request
-  uint8_t reg = MST_RR;
-  ans_status_e ret_val = encode_send_request(reg, NULL, 0);
-  if (ret_val == ANS_STATUS_DATA_SENT)
+  ans_status_e ret_val = transact(MST_RR, NULL, 0, param_a);
+  if (ret_val == ANS_STATUS_SUCCESS)
   {
-    ret_val = receive_decode_answer(&reg, param_a, sizeof(param_a));
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == MST_RA)
-    {
-      uint8_t i = 0;
-      do
-      {
-        uint8_t type = param_a[i++];
-        uint8_t length = param_a[i++];
-        switch (type)
-        {
-        case MST_TYPE_MSG_IN_QUEUE:
-          if (length == sizeof(mst_struct.msg_in_queue))
-            memcpy(&mst_struct.msg_in_queue, &param_a[i], length);
-          break;
-        case MST_TYPE_ACK_MSG_QUEUE:
-          if (length == sizeof(mst_struct.ack_msg_in_queue))
-            memcpy(&mst_struct.ack_msg_in_queue, &param_a[i], length);
-          break;
-        case MST_TYPE_LAST_RST:
-          if (length == sizeof(mst_struct.last_rst))
-            memcpy(&mst_struct.last_rst, &param_a[i], length);
-          break;
-        case MST_UPTIME:
-          if (length == sizeof(mst_struct.uptime))
-            memcpy(&mst_struct.uptime, &param_a[i], length);
-          break;
-        }
-        i += length;
-      } while (i < MST_CMD_LENGTH);
-      ret_val = ANS_STATUS_SUCCESS;
-    }
+    decode_module_state(param_a);
   }
   return ret_val;
 }
 
+void ASTRONODE::decode_module_state(uint8_t param[MST_CMD_LENGTH])
+{
+  uint8_t i = 0;
+  do
+  {
+    uint8_t type = param[i++];
+    uint8_t length = param[i++];
+    switch (type)
+    {
+    case MST_TYPE_MSG_IN_QUEUE:
+      if (length == sizeof(mst_struct.msg_in_queue))
+        memcpy(&mst_struct.msg_in_queue, &param[i], length);
+      break;
+    case MST_TYPE_ACK_MSG_QUEUE:
+      if (length == sizeof(mst_struct.ack_msg_in_queue))
+        memcpy(&mst_struct.ack_msg_in_queue, &param[i], length);
+      break;
+    case MST_TYPE_LAST_RST:
+      if (length == sizeof(mst_struct.last_rst))
+        memcpy(&mst_struct.last_rst, &param[i], length);
+      break;
+    case MST_UPTIME:
+      if (length == sizeof(mst_struct.uptime))
+        memcpy(&mst_struct.uptime, &param[i], length);
+      break;
+    }
+    i += length;
+  } while (i < MST_CMD_LENGTH);
+
+  snapshot_publish();
+}
+
+#if defined(ASTRONODE_WITH_SNAPSHOT)
+void ASTRONODE::snapshot_publish(void)
+{
+  // Write the publication into the buffer readers are not using: a reader is only disturbed (and retries) if two
+  // publications complete while it is copying.
+  uint8_t seq = _snapshot_seq;
+  ASTRONODE_SNAPSHOT *snapshot = &_snapshot[((seq >> 1) + 1) & 1];
+
+  _snapshot_seq = seq + 1;
+  ASTRONODE_MEMORY_BARRIER();
+  snapshot->per = per_struct;
+  snapshot->mst = mst_struct;
+  snapshot->end = end_struct;
+  snapshot->lcd = lcd_struct;
+  ASTRONODE_MEMORY_BARRIER();
+  _snapshot_seq = seq + 2;
+}
+
+void ASTRONODE::snapshot_read(ASTRONODE_SNAPSHOT *snapshot)
+{
+  uint8_t seq_begin, seq_end;
+  do
+  {
+    seq_begin = _snapshot_seq;
+    ASTRONODE_MEMORY_BARRIER();
+    memcpy(snapshot, &_snapshot[(seq_begin >> 1) & 1], sizeof(ASTRONODE_SNAPSHOT));
+    ASTRONODE_MEMORY_BARRIER();
+    seq_end = _snapshot_seq;
+  } while ((uint8_t)(seq_end - seq_begin) > 1);
+}
+
+uint8_t ASTRONODE::snapshot_version(void)
+{
+  return _snapshot_seq >> 1;
+}
+#endif
+
 ans_status_e ASTRONODE::read_environment_details(void)
 {
   if ((_printDebug == true) || (_printFullDebug == true))
@@ -638,37 +739,32 @@ ans_status_e ASTRONODE::read_environment_details(void)
   uint8_t param_a[END_CMD_LENGTH] = {};
 
   // Send request
-  uint8_t reg = END_RR;
-  ans_status_e ret_val = encode_send_request(reg, NULL, 0);
-  if (ret_val == ANS_STATUS_DATA_SENT)
+  ans_status_e ret_val = transact(END_RR, NULL, 0, param_a);
+  if (ret_val == ANS_STATUS_SUCCESS)
   {
-    ret_val = receive_decode_answer(&reg, param_a, sizeof(param_a));
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == END_RA)
+    uint8_t i = 0;
+    do
     {
-      uint8_t i = 0;
-      do
+      uint8_t type = param_a[i++];
+      uint8_t length = param_a[i++];
+      switch (type)
       {
-        uint8_t type = param_a[i++];
-        uint8_t length = param_a[i++];
-        switch (type)
-        {
-        case END_TYPE_LAST_MAC_RESULT:
-          if (length == sizeof(end_struct.last_mac_result))
-            memcpy(&end_struct.last_mac_result, &param_a[i], length);
-          break;
-        case END_TYPE_LAST_SAT_SEARCH_PEAK_RSSI:
-          if (length == sizeof(end_struct.last_sat_search_peak_rssi))
-            memcpy(&end_struct.last_sat_search_peak_rssi, &param_a[i], length);
-          break;
-        case END_TYPE_TIME_SINCE_LAST_SAT_SEARCH:
-          if (length == sizeof(end_struct.time_since_last_sat_search))
-            memcpy(&end_struct.time_since_last_sat_search, &param_a[i], length);
-          break;
-        }
-        i += length;
-      } while (i < END_CMD_LENGTH);
-      ret_val = ANS_STATUS_SUCCESS;
-    }
+      case END_TYPE_LAST_MAC_RESULT:
+        if (length == sizeof(end_struct.last_mac_result))
+          memcpy(&end_struct.last_mac_result, &param_a[i], length);
+        break;
+      case END_TYPE_LAST_SAT_SEARCH_PEAK_RSSI:
+        if (length == sizeof(end_struct.last_sat_search_peak_rssi))
+          memcpy(&end_struct.last_sat_search_peak_rssi, &param_a[i], length);
+        break;
+      case END_TYPE_TIME_SINCE_LAST_SAT_SEARCH:
+        if (length == sizeof(end_struct.time_since_last_sat_search))
+          memcpy(&end_struct.time_since_last_sat_search, &param_a[i], length);
+        break;
+      }
+      i += length;
+    } while (i < END_CMD_LENGTH);
+    snapshot_publish();
   }
   return ret_val;
 }
@@ -684,41 +780,36 @@ ans_status_e ASTRONODE::read_last_contact_details(void)
   uint8_t param_a[LCD_CMD_LENGTH] = {};
 
   // Send request
-  uint8_t reg = LCD_RR;
-  ans_status_e ret_val = encode_send_request(reg, NULL, 0);
-  if (ret_val == ANS_STATUS_DATA_SENT)
+  ans_status_e ret_val = transact(LCD_RR, NULL, 0, param_a);
+  if (ret_val == ANS_STATUS_SUCCESS)
   {
-    ret_val = receive_decode_answer(&reg, param_a, sizeof(param_a));
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == LCD_RA)
+    uint8_t i = 0;
+    do
     {
-      uint8_t i = 0;
-      do
+      uint8_t type = param_a[i++];
+      uint8_t length = param_a[i++];
+      switch (type)
       {
-        uint8_t type = param_a[i++];
-        uint8_t length = param_a[i++];
-        switch (type)
-        {
-        case LCD_TYPE_TIME_START_LAST_CONTACT:
-          if (length == sizeof(lcd_struct.time_start_last_contact))
-            memcpy(&lcd_struct.time_start_last_contact, &param_a[i], length);
-          break;
-        case LCD_TYPE_TIME_END_LAST_CONTACT:
-          if (length == sizeof(lcd_struct.time_end_last_contact))
-            memcpy(&lcd_struct.time_end_last_contact, &param_a[i], length);
-          break;
-        case LCD_TYPE_PEAK_RSSI_LAST_CONTACT:
-          if (length == sizeof(lcd_struct.peak_rssi_last_contact))
-            memcpy(&lcd_struct.peak_rssi_last_contact, &param_a[i], length);
-          break;
-        case LCD_TYPE_TIME_PEAK_RSSI_LAST_CONTACT:
-          if (length == sizeof(lcd_struct.time_peak_rssi_last_contact))
-            memcpy(&lcd_struct.time_peak_rssi_last_contact, &param_a[i], length);
-          break;
-        }
-        i += length;
-      } while (i < LCD_CMD_LENGTH);
-      ret_val = ANS_STATUS_SUCCESS;
-    }
+      case LCD_TYPE_TIME_START_LAST_CONTACT:
+        if (length == sizeof(lcd_struct.time_start_last_contact))
+          memcpy(&lcd_struct.time_start_last_contact, &param_a[i], length);
+        break;
+      case LCD_TYPE_TIME_END_LAST_CONTACT:
+        if (length == sizeof(lcd_struct.time_end_last_contact))
+          memcpy(&lcd_struct.time_end_last_contact, &param_a[i], length);
+        break;
+      case LCD_TYPE_PEAK_RSSI_LAST_CONTACT:
+        if (length == sizeof(lcd_struct.peak_rssi_last_contact))
+          memcpy(&lcd_struct.peak_rssi_last_contact, &param_a[i], length);
+        break;
+      case LCD_TYPE_TIME_PEAK_RSSI_LAST_CONTACT:
+        if (length == sizeof(lcd_struct.time_peak_rssi_last_contact))
+          memcpy(&lcd_struct.time_peak_rssi_last_contact, &param_a[i], length);
+        break;
+      }
+      i += length;
+    } while (i < LCD_CMD_LENGTH);
+    snapshot_publish();
   }
   return ret_val;
 }
@@ -748,24 +839,22 @@ ans_status_e ASTRONODE::enqueue_payload(uint8_t *data,
     memcpy(&param_w[2], data, length);
 
     // Send request
-    uint8_t reg = PLD_ER;
-    ret_val = encode_send_request(reg, param_w, length + 2);
-    if (ret_val == ANS_STATUS_DATA_SENT)
+    ret_val = transact(PLD_ER, param_w, length + 2, param_a);
+    if (ret_val == ANS_STATUS_SUCCESS)
     {
-      ret_val = receive_decode_answer(&reg, param_a, sizeof(param_a));
-      if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == PLD_EA)
+      // Check that enqueued payload has the correct ID
+      uint16_t id_check = (((uint16_t)param_a[1]) << 8) + ((uint16_t)param_a[0]);
+      if (id == id_check)
       {
-        // Check that enqueued payload has the correct ID
-        uint16_t id_check = (((uint16_t)param_a[1]) << 8) + ((uint16_t)param_a[0]);
-        if (id == id_check)
-        {
-          ret_val = ANS_STATUS_SUCCESS;
-        }
-        else
+        if (_latency != NULL)
         {
-          ret_val = ANS_STATUS_PAYLOD_ID_CHECK_FAILED;
+          _latency->enqueued(id, millis());
         }
       }
+      else
+      {
+        ret_val = ANS_STATUS_PAYLOD_ID_CHECK_FAILED;
+      }
     }
   }
   else
@@ -776,7 +865,8 @@ ans_status_e ASTRONODE::enqueue_payload(uint8_t *data,
   return ret_val;
 }
 
-ans_status_e ASTRONODE::dequeue_payload(uint16_t *id)
+ans_status_e ASTRONODE::dequeue_payload(uint16_t *id,
+                                        bool requeue)
 {
   if ((_printDebug == true) || (_printFullDebug == true))
   {
@@ -788,15 +878,13 @@ ans_status_e ASTRONODE::dequeue_payload(uint16_t *id)
   uint8_t param_a[2] = {};
 
   // Send request
-  uint8_t reg = PLD_DR;
-  ans_status_e ret_val = encode_send_request(reg, NULL, 0);
-  if (ret_val == ANS_STATUS_DATA_SENT)
+  ans_status_e ret_val = transact(PLD_DR, NULL, 0, param_a);
+  if (ret_val == ANS_STATUS_SUCCESS)
   {
-    ret_val = receive_decode_answer(&reg, param_a, sizeof(param_a));
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == PLD_DA)
+    *id = (((uint16_t)param_a[1]) << 8) + ((uint16_t)param_a[0]);
+    if (_latency != NULL)
     {
-      *id = (((uint16_t)param_a[1]) << 8) + ((uint16_t)param_a[0]);
-      ret_val = ANS_STATUS_SUCCESS;
+      _latency->dequeued(*id, requeue);
     }
   }
   return ret_val;
@@ -813,61 +901,189 @@ ans_status_e ASTRONODE::clear_free_payloads(void)
   // None
 
   // Send request
-  uint8_t reg = PLD_FR;
-  ans_status_e ret_val = encode_send_request(reg, NULL, 0);
-  if (ret_val == ANS_STATUS_DATA_SENT)
+  ans_status_e ret_val = transact(PLD_FR);
+  if (ret_val == ANS_STATUS_SUCCESS)
   {
-    ret_val = receive_decode_answer(&reg, NULL, 0);
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == PLD_FA)
+    if (_latency != NULL)
     {
-      ret_val = ANS_STATUS_SUCCESS;
+      _latency->cleared();
     }
   }
   return ret_val;
 }
 
-ans_status_e ASTRONODE::event_read(uint8_t *event_type)
+ans_status_e ASTRONODE::test_transmit_start(void)
 {
   if ((_printDebug == true) || (_printFullDebug == true))
   {
-    _debugSerial->println(F("ASTRONODE: Read event"));
+    _debugSerial->println(F("ASTRONODE: Start test transmission"));
   }
 
+  // Set parameters
+  // None
+
+  // Send request
+  return transact(TTX_SR);
+}
+
+ans_status_e ASTRONODE::event_register_read(uint8_t *events)
+{
   // Set parameters
   uint8_t param_a;
 
   // Send request
-  uint8_t reg = EVT_RR;
-  ans_status_e ret_val = encode_send_request(reg, NULL, 0);
-  if (ret_val == ANS_STATUS_DATA_SENT)
+  ans_status_e ret_val = transact(EVT_RR, NULL, 0, &param_a);
+  if (ret_val == ANS_STATUS_SUCCESS)
+  {
+    *events = param_a;
+  }
+  return ret_val;
+}
+
+ans_status_e ASTRONODE::event_read(uint8_t *event_type)
+{
+  if ((_printDebug == true) || (_printFullDebug == true))
+  {
+    _debugSerial->println(F("ASTRONODE: Read event"));
+  }
+
+  uint8_t events;
+  ans_status_e ret_val = event_register_read(&events);
+  if (ret_val == ANS_STATUS_SUCCESS)
   {
-    ret_val = receive_decode_answer(&reg, &param_a, sizeof(param_a));
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == EVT_RA)
+    if (events & (1 << 0))
     {
-      if (param_a & (1 << 0))
+      *event_type = EVENT_MSG_ACK;
+    }
+    else if (events & (1 << 1))
+    {
+      *event_type = EVENT_RESET;
+    }
+    else if (events & (1 << 2))
+    {
+      *event_type = EVENT_CMD_RECEIVED;
+    }
+    else if (events & (1 << 3))
+    {
+      *event_type = EVENT_MSG_PENDING;
+    }
+    else
+    {
+      *event_type = EVENT_NO_EVENT;
+    }
+  }
+  return ret_val;
+}
+
+ans_status_e ASTRONODE::process_events(unsigned long timeout)
+{
+  if ((_printDebug == true) || (_printFullDebug == true))
+  {
+    _debugSerial->println(F("ASTRONODE: Process events"));
+  }
+
+  unsigned long start = millis();
+  bool command_pending = false; // Declined or not handled, not dispatched again
+
+  while (millis() - start < timeout)
+  {
+    uint8_t events;
+    ans_status_e ret_val = event_register_read(&events);
+    if (ret_val != ANS_STATUS_SUCCESS)
+    {
+      return ret_val;
+    }
+    if (command_pending)
+    {
+      events &= ~(1 << 2);
+    }
+    if ((events & ((1 << 0) | (1 << 1) | (1 << 2))) == 0)
+    {
+      return ANS_STATUS_SUCCESS; // Message pending is a state, not an event to clear
+    }
+
+    if (events & (1 << 1))
+    {
+      ret_val = clear_reset_event();
+      if (ret_val != ANS_STATUS_SUCCESS)
       {
-        *event_type = EVENT_MSG_ACK;
+        return ret_val;
       }
-      else if (param_a & (1 << 1))
+      if (_reset_cb != NULL)
       {
-        *event_type = EVENT_RESET;
+        _reset_cb();
       }
-      else if (param_a & (1 << 2))
+    }
+
+    if ((events & (1 << 0)) && millis() - start < timeout)
+    {
+      uint16_t id;
+      ret_val = read_satellite_ack(&id);
+      if (ret_val == ANS_STATUS_SUCCESS)
       {
-        *event_type = EVENT_CMD_RECEIVED;
+        ret_val = clear_satellite_ack();
       }
-      else if (param_a & (1 << 3))
+      if (ret_val != ANS_STATUS_SUCCESS)
       {
-        *event_type = EVENT_MSG_PENDING;
+        return ret_val;
       }
-      else
+      if (_ack_cb != NULL)
       {
-        *event_type = EVENT_NO_EVENT;
+        _ack_cb(id);
+      }
+    }
+
+    if ((events & (1 << 2)) && millis() - start < timeout)
+    {
+      command_pending = true;
+      if (_command_cb != NULL)
+      {
+        uint8_t data[DATA_CMD_40B_SIZE] = {};
+        uint32_t createdDate;
+        if (_command_length == DATA_CMD_8B_SIZE)
+        {
+          ret_val = read_command_8B(data, &createdDate);
+        }
+        else
+        {
+          ret_val = read_command_40B(data, &createdDate);
+        }
+        if (ret_val != ANS_STATUS_SUCCESS)
+        {
+          return ret_val;
+        }
+        bool handled;
+        bool stored = true;
+        if (_cmdstore != NULL && _cmdstore->seen(data, _command_length, createdDate))
+        {
+          _cmdstore->duplicate(); // Handled before an asset reset, not cleared
+          handled = true;
+        }
+        else
+        {
+          handled = _command_cb(data, _command_length, createdDate);
+          if (handled && _cmdstore != NULL)
+          {
+            stored = _cmdstore->add(data, _command_length, createdDate); // Before the clear: a reset in between does not handle it twice
+          }
+        }
+        if (handled)
+        {
+          ret_val = clear_command();
+          if (ret_val != ANS_STATUS_SUCCESS)
+          {
+            return ret_val;
+          }
+          command_pending = false; // Next command can be dispatched
+          if (!stored)
+          {
+            return ANS_STATUS_HW_ERR; // Handled and cleared, but not protected against a reset before the clear
+          }
+        }
       }
-      ret_val = ANS_STATUS_SUCCESS;
     }
   }
-  return ret_val;
+  return ANS_STATUS_TIMEOUT;
 }
 
 ans_status_e ASTRONODE::read_satellite_ack(uint16_t *id)
@@ -881,19 +1097,17 @@ ans_status_e ASTRONODE::read_satellite_ack(uint16_t *id)
   uint8_t param_a[2] = {};
 
   // Send request
-  uint8_t reg = SAK_RR;
-  ans_status_e ret_val = encode_send_request(SAK_RR, NULL, 0);
-  if (ret_val == ANS_STATUS_DATA_SENT)
+  ans_status_e ret_val = transact(SAK_RR, NULL, 0, param_a);
+  if (ret_val == ANS_STATUS_SUCCESS)
   {
-    ret_val = receive_decode_answer(&reg, param_a, sizeof(param_a));
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == SAK_RA)
+    *id = (((uint16_t)param_a[1]) << 8) + (uint16_t)(param_a[0]);
+    if ((_printDebug == true) || (_printFullDebug == true))
     {
-      *id = (((uint16_t)param_a[1]) << 8) + (uint16_t)(param_a[0]);
-      if ((_printDebug == true) || (_printFullDebug == true))
-      {
-        _debugSerial->println(*id);
-      }
-      ret_val = ANS_STATUS_SUCCESS;
+      _debugSerial->println(*id);
+    }
+    if (_latency != NULL)
+    {
+      _latency->acked(*id, millis());
     }
   }
   return ret_val;
@@ -910,17 +1124,7 @@ ans_status_e ASTRONODE::clear_satellite_ack(void)
   // None
 
   // Send request
-  uint8_t reg = SAK_CR;
-  ans_status_e ret_val = encode_send_request(reg, NULL, 0);
-  if (ret_val == ANS_STATUS_DATA_SENT)
-  {
-    ret_val = receive_decode_answer(&reg, NULL, 0);
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == SAK_CA)
-    {
-      ret_val = ANS_STATUS_SUCCESS;
-    }
-  }
-  return ret_val;
+  return transact(SAK_CR);
 }
 
 ans_status_e ASTRONODE::clear_reset_event(void)
@@ -934,17 +1138,7 @@ ans_status_e ASTRONODE::clear_reset_event(void)
   // None
 
   // Send request
-  uint8_t reg = RES_CR;
-  ans_status_e ret_val = encode_send_request(reg, NULL, 0);
-  if (ret_val == ANS_STATUS_DATA_SENT)
-  {
-    ret_val = receive_decode_answer(&reg, NULL, 0);
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == RES_CA)
-    {
-      ret_val = ANS_STATUS_SUCCESS;
-    }
-  }
-  return ret_val;
+  return transact(RES_CR);
 }
 
 ans_status_e ASTRONODE::read_command_8B(uint8_t data[DATA_CMD_8B_SIZE],
@@ -959,21 +1153,15 @@ ans_status_e ASTRONODE::read_command_8B(uint8_t data[DATA_CMD_8B_SIZE],
   uint8_t param_a[12] = {};
 
   // Send request
-  uint8_t reg = CMD_RR;
-  ans_status_e ret_val = encode_send_request(reg, NULL, 0);
-  if (ret_val == ANS_STATUS_DATA_SENT)
+  ans_status_e ret_val = transact(CMD_RR, NULL, 0, param_a, sizeof(param_a));
+  if (ret_val == ANS_STATUS_SUCCESS)
   {
-    ret_val = receive_decode_answer(&reg, param_a, sizeof(param_a));
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == CMD_RA)
-    {
-      uint32_t time_tmp = (((uint32_t)param_a[3]) << 24) +
-                          (((uint32_t)param_a[2]) << 16) +
-                          (((uint32_t)param_a[1]) << 8) +
-                          (((uint32_t)param_a[0]) << 0);
-      *createdDate = time_tmp + ASTROCAST_REF_UNIX_TIME;
-      memcpy(data, &param_a[4], DATA_CMD_8B_SIZE);
-      ret_val = ANS_STATUS_SUCCESS;
-    }
+    uint32_t time_tmp = (((uint32_t)param_a[3]) << 24) +
+                        (((uint32_t)param_a[2]) << 16) +
+                        (((uint32_t)param_a[1]) << 8) +
+                        (((uint32_t)param_a[0]) << 0);
+    *createdDate = time_tmp + ASTROCAST_REF_UNIX_TIME;
+    memcpy(data, &param_a[4], DATA_CMD_8B_SIZE);
   }
   return ret_val;
 }
@@ -990,21 +1178,15 @@ ans_status_e ASTRONODE::read_command_40B(uint8_t data[DATA_CMD_40B_SIZE],
   uint8_t param_a[44] = {};
 
   // Send request
-  uint8_t reg = CMD_RR;
-  ans_status_e ret_val = encode_send_request(reg, NULL, 0);
-  if (ret_val == ANS_STATUS_DATA_SENT)
+  ans_status_e ret_val = transact(CMD_RR, NULL, 0, param_a);
+  if (ret_val == ANS_STATUS_SUCCESS)
   {
-    ret_val = receive_decode_answer(&reg, param_a, sizeof(param_a));
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == CMD_RA)
-    {
-      uint32_t time_tmp = (((uint32_t)param_a[3]) << 24) +
-                          (((uint32_t)param_a[2]) << 16) +
-                          (((uint32_t)param_a[1]) << 8) +
-                          (((uint32_t)param_a[0]) << 0);
-      *createdDate = time_tmp + ASTROCAST_REF_UNIX_TIME;
-      memcpy(data, &param_a[4], DATA_CMD_40B_SIZE);
-      ret_val = ANS_STATUS_SUCCESS;
-    }
+    uint32_t time_tmp = (((uint32_t)param_a[3]) << 24) +
+                        (((uint32_t)param_a[2]) << 16) +
+                        (((uint32_t)param_a[1]) << 8) +
+                        (((uint32_t)param_a[0]) << 0);
+    *createdDate = time_tmp + ASTROCAST_REF_UNIX_TIME;
+    memcpy(data, &param_a[4], DATA_CMD_40B_SIZE);
   }
   return ret_val;
 }
@@ -1020,15 +1202,162 @@ ans_status_e ASTRONODE::clear_command(void)
   // None
 
   // Send request
-  uint8_t reg = CMD_CR;
-  ans_status_e ret_val = encode_send_request(reg, NULL, 0);
-  if (ret_val == ANS_STATUS_DATA_SENT)
+  return transact(CMD_CR);
+}
+
+// Sorted by request code
+const ASTRONODE::ASTRONODE_OPCODE ASTRONODE::_opcode_table[] PROGMEM = {
+    {CFG_WR, CFG_WA, 0, TIMEOUT_SERIAL / 100, OPCODE_IDEMPOTENT},
+    {WIF_WR, WIF_WA, 0, TIMEOUT_SERIAL / 100, OPCODE_IDEMPOTENT},
+    {SSC_WR, SSC_WA, 0, TIMEOUT_SERIAL / 100, OPCODE_IDEMPOTENT},
+    {CFG_SR, CFG_SA, 0, TIMEOUT_SERIAL / 100, OPCODE_IDEMPOTENT},
+    {CFG_FR, CFG_FA, 0, TIMEOUT_SERIAL / 100, 0},
+    {CFG_RR, CFG_RA, 8, TIMEOUT_SERIAL / 100, OPCODE_IDEMPOTENT},
+    {RTC_RR, RTC_RA, 4, TIMEOUT_SERIAL / 100, OPCODE_IDEMPOTENT},
+    {NCO_RR, NCO_RA, 4, TIMEOUT_SERIAL / 100, OPCODE_IDEMPOTENT},
+    {MGI_RR, MGI_RA, 36, TIMEOUT_SERIAL / 100, OPCODE_IDEMPOTENT},
+    {MSN_RR, MSN_RA, 16, TIMEOUT_SERIAL / 100, OPCODE_IDEMPOTENT},
+    {MPN_RR, MPN_RA, 16, TIMEOUT_SERIAL / 100, OPCODE_IDEMPOTENT},
+    {PLD_ER, PLD_EA, 2, TIMEOUT_SERIAL / 100, 0},
+    {PLD_DR, PLD_DA, 2, TIMEOUT_SERIAL / 100, 0},
+    {PLD_FR, PLD_FA, 0, TIMEOUT_SERIAL / 100, OPCODE_IDEMPOTENT},
+    {GEO_WR, GEO_WA, 0, TIMEOUT_SERIAL / 100, OPCODE_IDEMPOTENT},
+    {SAK_RR, SAK_RA, 2, TIMEOUT_SERIAL / 100, OPCODE_IDEMPOTENT},
+    {SAK_CR, SAK_CA, 0, TIMEOUT_SERIAL / 100, 0}, // A second clear would drop the next ack
+    {CMD_RR, CMD_RA, 4 + DATA_CMD_40B_SIZE, TIMEOUT_SERIAL / 100, OPCODE_IDEMPOTENT},
+    {CMD_CR, CMD_CA, 0, TIMEOUT_SERIAL / 100, 0}, // A second clear would drop the next command
+    {RES_CR, RES_CA, 0, TIMEOUT_SERIAL / 100, OPCODE_IDEMPOTENT},
+    {TTX_SR, TTX_SA, 0, TIMEOUT_SERIAL / 100, 0},
+    {EVT_RR, EVT_RA, 1, TIMEOUT_SERIAL / 100, OPCODE_IDEMPOTENT},
+    {PER_SR, PER_SA, 0, TIMEOUT_SERIAL / 100, OPCODE_IDEMPOTENT},
+    {PER_RR, PER_RA, PER_CMD_LENGTH, TIMEOUT_SERIAL / 100, OPCODE_IDEMPOTENT},
+    {PER_CR, PER_CA, 0, TIMEOUT_SERIAL / 100, 0},
+    {MST_RR, MST_RA, MST_CMD_LENGTH, TIMEOUT_SERIAL / 100, OPCODE_IDEMPOTENT},
+    {LCD_RR, LCD_RA, LCD_CMD_LENGTH, TIMEOUT_SERIAL / 100, OPCODE_IDEMPOTENT},
+    {END_RR, END_RA, END_CMD_LENGTH, TIMEOUT_SERIAL / 100, OPCODE_IDEMPOTENT},
+};
+
+bool ASTRONODE::opcode_read(uint8_t reg,
+                            ASTRONODE_OPCODE *op)
+{
+  for (uint8_t i = 0; i < sizeof(_opcode_table) / sizeof(_opcode_table[0]); i++)
+  {
+    uint8_t table_reg = pgm_read_byte(&_opcode_table[i].reg);
+    if (table_reg == reg)
+    {
+      memcpy_P(op, &_opcode_table[i], sizeof(ASTRONODE_OPCODE));
+      return true;
+    }
+    if (table_reg > reg)
+    {
+      break;
+    }
+  }
+  return false;
+}
+
+ans_status_e ASTRONODE::transact(uint8_t reg,
+                                 uint8_t *param_w,
+                                 uint8_t param_w_length,
+                                 uint8_t *param_a,
+                                 uint8_t param_a_length)
+{
+  ASTRONODE_OPCODE op;
+  if (opcode_read(reg, &op) == false)
+  {
+    return ANS_STATUS_OPCODE_NOT_VALID;
+  }
+  if (param_a_length == TRANSACT_TABLE_LENGTH)
+  {
+    param_a_length = op.answer_length;
+  }
+
+  unsigned long timeout = (unsigned long)op.timeout * 100;
+  if (timeout != _transport_timeout)
+  {
+    transport_set_timeout(timeout);
+    _transport_timeout = timeout;
+  }
+
+  unsigned long start = micros();
+  uint16_t wire_bytes = 0;
+  uint8_t attempts = (op.flags & OPCODE_IDEMPOTENT) ? _request_retries + 1 : 1;
+  ans_status_e ret_val;
+  while (true)
   {
-    ret_val = receive_decode_answer(&reg, NULL, 0);
-    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == CMD_CA)
+    link_stats.requests++;
+    uint8_t answer_reg = reg;
+    transport_discard_input(); // Late answer to an earlier request
+    ret_val = encode_send_request(reg, param_w, param_w_length);
+    if (ret_val == ANS_STATUS_DATA_SENT)
     {
-      ret_val = ANS_STATUS_SUCCESS;
+      wire_bytes += STX_L + 2 * (REG_L + param_w_length + CRC_L) + ETX_L;
+
+      // Frames which are not the answer (late answer to an earlier request, corrupted frame) are dropped, the
+      // answer can follow them until the end of the answer window
+      unsigned long sent = millis();
+      bool corrupted = false;
+      while (true)
+      {
+        answer_reg = reg;
+        ret_val = receive_decode_answer(&answer_reg, param_a, param_a_length);
+        wire_bytes += _rx_bytes;
+        if (ret_val == ANS_STATUS_HW_ERR)
+        {
+          break;
+        }
+        if (ret_val != ANS_STATUS_TIMEOUT)
+        {
+          if (answer_reg != op.answer_reg && answer_reg != ERR_RA)
+          {
+            link_stats.stale_answers++;
+          }
+          else if (ret_val == ANS_STATUS_CRC_NOT_VALID)
+          {
+            link_stats.crc_errors++;
+            corrupted = true;
+          }
+          else
+          {
+            break;
+          }
+        }
+        if (_rx_bytes == 0 || millis() - sent >= timeout)
+        {
+          ret_val = corrupted ? ANS_STATUS_CRC_NOT_VALID : ANS_STATUS_TIMEOUT;
+          break;
+        }
+      }
+
+      if (ret_val == ANS_STATUS_DATA_RECEIVED && answer_reg == op.answer_reg)
+      {
+        ret_val = ANS_STATUS_SUCCESS;
+        break;
+      }
+    }
+
+    if (ret_val == ANS_STATUS_TIMEOUT)
+    {
+      link_stats.timeouts++;
     }
+    else if (answer_reg == ERR_RA && ret_val != ANS_STATUS_CRC_NOT_VALID)
+    {
+      link_stats.error_answers++;
+      break; // Answered by the module, not retried
+    }
+
+    // Link errors (no answer, CRC) are retried on idempotent requests only, once the answer window is over: the
+    // late answer is discarded before the next frame is sent
+    if (--attempts == 0 || ret_val == ANS_STATUS_HW_ERR)
+    {
+      break;
+    }
+    link_stats.retries++;
+  }
+
+  if (_energy != NULL)
+  {
+    _energy->request(reg, micros() - start, wire_bytes); // Whole request, retries included
   }
   return ret_val;
 }
@@ -1043,6 +1372,7 @@ void ASTRONODE::dummy_cmd(void)
   uint8_t reg = 0x00;
   encode_send_request(reg, NULL, 0);
   receive_decode_answer(&reg, NULL, 0);
+  transport_discard_input(); // Consume remaining bytes in the buffer if any
 }
 
 ans_status_e ASTRONODE::encode_send_request(uint8_t reg,
@@ -1099,7 +1429,7 @@ ans_status_e ASTRONODE::encode_send_request(uint8_t reg,
     }
 
     // Write command
-    if (_serialPort->write(com_buf_astronode_hex, index_buf_cmd_hex) == (size_t)(index_buf_cmd_hex))
+    if (transport_write(com_buf_astronode_hex, index_buf_cmd_hex) == (size_t)(index_buf_cmd_hex))
     {
       ret_val = ANS_STATUS_DATA_SENT;
     }
@@ -1124,6 +1454,7 @@ ans_status_e ASTRONODE::receive_decode_answer(uint8_t *reg,
                                               uint8_t param_length)
 {
   ans_status_e ret_val;
+  _rx_bytes = 0;
 
   // Read answer
   uint16_t max_rx_length = STX_L + 2 * (REG_L + param_length + CRC_L) + ETX_L;
@@ -1142,155 +1473,363 @@ ans_status_e ASTRONODE::receive_decode_answer(uint8_t *reg,
   }
   else
   {
-    uint16_t index_buf_cmd_hex = 0;
+    size_t rx_length = transport_read_until(ETX, com_buf_astronode_hex, max_rx_length);
+    _rx_bytes = (rx_length > 0) ? rx_length + ETX_L : 0;
+
+    ret_val = decode_answer(com_buf_astronode_hex, rx_length, reg, param, param_length);
+
+    free(com_buf_astronode_hex);
+    //_serialPort->flush();  // Not implemented in NeoStream
+  }
+
+  return ret_val;
+}
 
-    size_t rx_length = _serialPort->readBytesUntil(ETX, (char *)com_buf_astronode_hex, max_rx_length);
+ans_status_e ASTRONODE::decode_answer(uint8_t *com_buf_astronode_hex,
+                                      size_t rx_length,
+                                      uint8_t *reg,
+                                      uint8_t *param,
+                                      uint8_t param_length)
+{
+  ans_status_e ret_val;
+  uint16_t index_buf_cmd_hex = 0;
+
+  if (rx_length >= (STX_L + 2 * (REG_L + CRC_L))) // At least STX (1), REG(2), CRC (4) (ETX ignored by function)
+  {
+    if ((_printDebug == true) && (_printFullDebug == true))
+    {
+      _debugSerial->println(F("terminal -> asset (+ CRC + HEX encoding): "));
+      print_array_to_hex(com_buf_astronode_hex, rx_length);
+    }
 
-    if (rx_length >= (STX_L + 2 * (REG_L + CRC_L))) // At least STX (1), REG(2), CRC (4) (ETX ignored by function)
+    // Translate to binary
+    uint16_t cmd_crc_check = 0xFFFF, cmd_crc = 0xFFFF;
+    index_buf_cmd_hex += STX_L;
+
+    // Register extraction
+    hex_array_to_byte_array(&com_buf_astronode_hex[index_buf_cmd_hex], 2 * REG_L, reg); // Skip STX, ETX not in buffer
+    index_buf_cmd_hex += 2 * REG_L;
+
+    // Parameter extraction (handle error cases)
+    if (*reg == ERR_RA)
+    {
+      uint8_t param_err[PERR_L]; // handle case where param = NULL
+      hex_array_to_byte_array(&com_buf_astronode_hex[index_buf_cmd_hex], 2 * PERR_L, param_err);
+      index_buf_cmd_hex += 2 * PERR_L;
+      cmd_crc = crc_compute(*reg, param_err, PERR_L, 0xFFFF);
+      ret_val = (ans_status_e)((((uint16_t)param_err[1]) << 8) + (uint16_t)(param_err[0]));
+    }
+    else
     {
+      hex_array_to_byte_array(&com_buf_astronode_hex[index_buf_cmd_hex], 2 * param_length, param);
+      index_buf_cmd_hex += 2 * param_length;
+      cmd_crc = crc_compute(*reg, param, param_length, 0xFFFF);
+      ret_val = ANS_STATUS_DATA_RECEIVED;
+
       if ((_printDebug == true) && (_printFullDebug == true))
       {
-        _debugSerial->println(F("terminal -> asset (+ CRC + HEX encoding): "));
-        print_array_to_hex(com_buf_astronode_hex, rx_length);
+        _debugSerial->print(F("terminal -> asset (+ CRC): CRC = "));
+        _debugSerial->print(cmd_crc_check, HEX);
+        _debugSerial->print(F("; Length = "));
+        _debugSerial->print(param_length);
+        _debugSerial->println(F(" [bytes]; data = "));
+        print_array_to_hex(param, param_length);
       }
+    }
 
-      // Translate to binary
-      uint16_t cmd_crc_check = 0xFFFF, cmd_crc = 0xFFFF;
-      index_buf_cmd_hex += STX_L;
+    // CRC extraction
+    hex_array_to_byte_array(&com_buf_astronode_hex[index_buf_cmd_hex], 2 * PERR_L, (uint8_t *)&cmd_crc_check);
+    index_buf_cmd_hex += 2 * PERR_L;
 
-      // Register extraction
-      hex_array_to_byte_array(&com_buf_astronode_hex[index_buf_cmd_hex], 2 * REG_L, reg); // Skip STX, ETX not in buffer
-      index_buf_cmd_hex += 2 * REG_L;
+    // Verify CRC
+    if (cmd_crc != cmd_crc_check)
+    {
+      ret_val = ANS_STATUS_CRC_NOT_VALID;
+    }
+  }
+  else
+  {
+    ret_val = ANS_STATUS_TIMEOUT;
+  }
 
-      // Parameter extraction (handle error cases)
-      if (*reg == ERR_RA)
-      {
-        uint8_t param_err[PERR_L]; // handle case where param = NULL
-        hex_array_to_byte_array(&com_buf_astronode_hex[index_buf_cmd_hex], 2 * PERR_L, param_err);
-        index_buf_cmd_hex += 2 * PERR_L;
-        cmd_crc = crc_compute(*reg, param_err, PERR_L, 0xFFFF);
-        ret_val = (ans_status_e)((((uint16_t)param_err[1]) << 8) + (uint16_t)(param_err[0]));
-      }
-      else
-      {
-        hex_array_to_byte_array(&com_buf_astronode_hex[index_buf_cmd_hex], 2 * param_length, param);
-        index_buf_cmd_hex += 2 * param_length;
-        cmd_crc = crc_compute(*reg, param, param_length, 0xFFFF);
-        ret_val = ANS_STATUS_DATA_RECEIVED;
+  if ((_printDebug == true) || (_printFullDebug == true))
+  {
+    print_error_code_string(ret_val);
+  }
 
-        if ((_printDebug == true) && (_printFullDebug == true))
-        {
-          _debugSerial->print(F("terminal -> asset (+ CRC): CRC = "));
-          _debugSerial->print(cmd_crc_check, HEX);
-          _debugSerial->print(F("; Length = "));
-          _debugSerial->print(param_length);
-          _debugSerial->println(F(" [bytes]; data = "));
-          print_array_to_hex(param, param_length);
-        }
-      }
+  return ret_val;
+}
 
-      // CRC extraction
-      hex_array_to_byte_array(&com_buf_astronode_hex[index_buf_cmd_hex], 2 * PERR_L, (uint8_t *)&cmd_crc_check);
-      index_buf_cmd_hex += 2 * PERR_L;
+ans_status_e ASTRONODE::async_request(uint8_t reg,
+                                      uint8_t *param,
+                                      uint8_t param_length,
+                                      uint8_t answer_length,
+                                      unsigned long timeout)
+{
+  if (_async_buf != NULL)
+  {
+    return ANS_STATUS_DEVICE_BUSY;
+  }
 
-      // Verify CRC
-      if (cmd_crc != cmd_crc_check)
-      {
-        ret_val = ANS_STATUS_CRC_NOT_VALID;
-      }
+  // Answer buffer, kept until the answer is complete
+  _async_max_length = STX_L + 2 * (REG_L + answer_length + CRC_L) + ETX_L;
+  if (_async_max_length < (STX_L + 2 * (REG_L + PERR_L + CRC_L) + ETX_L))
+  {
+    _async_max_length = STX_L + 2 * (REG_L + PERR_L + CRC_L) + ETX_L; // Account at least for error code
+  }
+  _async_buf = (uint8_t *)calloc(_async_max_length, sizeof(uint8_t));
+  if (_async_buf == NULL)
+  {
+    if ((_printDebug == true) || (_printFullDebug == true))
+    {
+      _debugSerial->println(F("ASTRONDOE: Not enought memory could be allocated in asset."));
     }
-    else
+    return ANS_STATUS_HW_ERR;
+  }
+  _async_length = 0;
+  _async_reg = reg;
+  _async_tx_bytes = STX_L + 2 * (REG_L + param_length + CRC_L) + ETX_L;
+  _async_start = micros();
+
+  transport_discard_input();
+
+  ans_status_e ret_val = encode_send_request(reg, param, param_length);
+  if (ret_val != ANS_STATUS_DATA_SENT)
+  {
+    free(_async_buf);
+    _async_buf = NULL;
+  }
+  _async_deadline = millis() + timeout;
+  return ret_val;
+}
+
+ans_status_e ASTRONODE::async_poll(uint8_t *reg,
+                                   uint8_t *param,
+                                   uint8_t param_length)
+{
+  if (_async_buf == NULL)
+  {
+    return ANS_STATUS_HW_ERR;
+  }
+
+  // Consume available bytes up to ETX (bytes after ETX are discarded, as in receive_decode_answer)
+  bool complete = false;
+  size_t rx_length = transport_read_available(&_async_buf[_async_length], _async_max_length - _async_length);
+  while (rx_length--)
+  {
+    if (_async_buf[_async_length] == ETX)
     {
-      ret_val = ANS_STATUS_TIMEOUT;
+      complete = true;
+      break;
     }
+    _async_length++;
+  }
+  if (_async_length == _async_max_length)
+  {
+    complete = true;
+  }
 
+  ans_status_e ret_val;
+  if (complete)
+  {
+    ret_val = decode_answer(_async_buf, _async_length, reg, param, param_length);
+  }
+  else if ((long)(millis() - _async_deadline) >= 0)
+  {
+    ret_val = ANS_STATUS_TIMEOUT;
     if ((_printDebug == true) || (_printFullDebug == true))
     {
       print_error_code_string(ret_val);
     }
-    free(com_buf_astronode_hex);
-    //_serialPort->flush();  // Not implemented in NeoStream
-    while (_serialPort->available()) // Consume remaining bytes in the buffer if any
-      _serialPort->read();
+  }
+  else
+  {
+    return ANS_STATUS_PENDING;
   }
 
+  async_end(complete ? _async_length + ETX_L : _async_length);
   return ret_val;
 }
 
+bool ASTRONODE::async_busy(void)
+{
+  return (_async_buf != NULL);
+}
+
+void ASTRONODE::async_cancel(void)
+{
+  if (_async_buf != NULL)
+  {
+    async_end(_async_length); // A late answer is discarded by the next request
+  }
+}
+
+void ASTRONODE::async_end(uint16_t rx_bytes)
+{
+  if (_energy != NULL)
+  {
+    _energy->request(_async_reg, micros() - _async_start, _async_tx_bytes + rx_bytes); // As transact()
+  }
+  free(_async_buf);
+  _async_buf = NULL;
+  transport_discard_input();
+}
+
+void ASTRONODE::transport_set_timeout(unsigned long timeout)
+{
+  _serialPort->setTimeout(timeout);
+}
+
+size_t ASTRONODE::transport_write(uint8_t *data,
+                                  size_t length)
+{
+  return _serialPort->write(data, length);
+}
+
+size_t ASTRONODE::transport_read_until(uint8_t terminator,
+                                       uint8_t *data,
+                                       size_t length)
+{
+  return _serialPort->readBytesUntil(terminator, (char *)data, length);
+}
+
+void ASTRONODE::transport_discard_input(void)
+{
+  while (_serialPort->available() > 0)
+  {
+    _serialPort->read();
+  }
+}
+
+size_t ASTRONODE::transport_read_available(uint8_t *data,
+                                           size_t length)
+{
+  size_t index = 0;
+  while (index < length && _serialPort->available() > 0)
+  {
+    data[index++] = (uint8_t)_serialPort->read();
+  }
+  return index;
+}
+
+// Status messages, one PROGMEM string each, indexed by a table sorted by code
+static const char status_str_crc_not_valid[] PROGMEM = "Discrepancy between provided CRC and expected CRC.";
+static const char status_str_length_not_valid[] PROGMEM = "Message exceeds the maximum length for a frame.";
+static const char status_str_opcode_not_valid[] PROGMEM = "Invalid Operation Code used.";
+static const char status_str_arg_not_valid[] PROGMEM = "Invalid argument used.";
+static const char status_str_flash_writing_failed[] PROGMEM = "Failed to write to the flash.";
+static const char status_str_device_busy[] PROGMEM = "Device is busy.";
+static const char status_str_format_not_valid[] PROGMEM = "At least one of the fields (SSID, password, token) is not composed of exclusively printable standard ASCII characters (0x20 to 0x7E).";
+static const char status_str_period_invalid[] PROGMEM = "The Satellite Search Config period enumeration value is not valid.";
+static const char status_str_buffer_full[] PROGMEM = "Failed to queue the payload because the sending queue is already full.";
+static const char status_str_duplicate_id[] PROGMEM = "Failed to queue the payload because the Payload ID provided by the asset is already in use in the terminal queue.";
+static const char status_str_buffer_empty[] PROGMEM = "Failed to dequeue a payload from the buffer because the buffer is empty.";
+static const char status_str_invalid_pos[] PROGMEM = "Invalid position.";
+static const char status_str_no_ack[] PROGMEM = "No satellite acknowledgement available for any payload.";
+static const char status_str_no_ack_clear[] PROGMEM = "No payload ack to clear, or it was already cleared.";
+static const char status_str_no_command[] PROGMEM = "No command is available.";
+static const char status_str_no_command_clear[] PROGMEM = "No command to clear, or it was already cleared.";
+static const char status_str_max_tx_reached[] PROGMEM = "Failed to test Tx due to the maximum number of transmissions being reached.";
+static const char status_str_success[] PROGMEM = "Success.";
+static const char status_str_timeout[] PROGMEM = "Failed to receive data from astronode before timeout.";
+static const char status_str_hw_err[] PROGMEM = "Failed to send data to the terminal.";
+static const char status_str_data_sent[] PROGMEM = "Data sent.";
+static const char status_str_data_received[] PROGMEM = "Data received.";
+static const char status_str_payload_too_long[] PROGMEM = "Payload exceeds the maximum payload size.";
+static const char status_str_payload_id_check_failed[] PROGMEM = "Enqueued payload ID does not match the requested one.";
+static const char status_str_pending[] PROGMEM = "Request in progress.";
+static const char status_str_unknown[] PROGMEM = "Unknown error code.";
+
+typedef struct
+{
+  uint16_t code;
+  const char *message;
+} ASTRONODE_STATUS_STRING;
+
+static constexpr ASTRONODE_STATUS_STRING status_strings[] PROGMEM = {
+    {ANS_STATUS_CRC_NOT_VALID, status_str_crc_not_valid},
+    {ANS_STATUS_LENGTH_NOT_VALID, status_str_length_not_valid},
+    {ANS_STATUS_OPCODE_NOT_VALID, status_str_opcode_not_valid},
+    {ANS_STATUS_ARG_NOT_VALID, status_str_arg_not_valid},
+    {ANS_STATUS_FLASH_WRITING_FAILED, status_str_flash_writing_failed},
+    {ANS_STATUS_DEVICE_BUSY, status_str_device_busy},
+    {ANS_STATUS_FORMAT_NOT_VALID, status_str_format_not_valid},
+    {ANS_STATUS_PERIOD_INVALID, status_str_period_invalid},
+    {ANS_STATUS_BUFFER_FULL, status_str_buffer_full},
+    {ANS_STATUS_DUPLICATE_ID, status_str_duplicate_id},
+    {ANS_STATUS_BUFFER_EMPTY, status_str_buffer_empty},
+    {ANS_STATUS_INVALID_POS, status_str_invalid_pos},
+    {ANS_STATUS_NO_ACK, status_str_no_ack},
+    {ANS_STATUS_NO_ACK_CLEAR, status_str_no_ack_clear},
+    {ANS_STATUS_NO_COMMAND, status_str_no_command},
+    {ANS_STATUS_NO_COMMAND_CLEAR, status_str_no_command_clear},
+    {ANS_STATUS_MAX_TX_REACHED, status_str_max_tx_reached},
+    {ANS_STATUS_SUCCESS, status_str_success},
+    {ANS_STATUS_TIMEOUT, status_str_timeout},
+    {ANS_STATUS_HW_ERR, status_str_hw_err},
+    {ANS_STATUS_DATA_SENT, status_str_data_sent},
+    {ANS_STATUS_DATA_RECEIVED, status_str_data_received},
+    {ANS_STATUS_PAYLOAD_TOO_LONG, status_str_payload_too_long},
+    {ANS_STATUS_PAYLOD_ID_CHECK_FAILED, status_str_payload_id_check_failed},
+    {ANS_STATUS_PENDING, status_str_pending},
+};
+
+// The binary search needs codes strictly ascending from index i
+static constexpr bool status_strings_ascending(uint8_t i)
+{
+  return ((size_t)i + 1 >= sizeof(status_strings) / sizeof(status_strings[0])) ||
+         ((status_strings[i].code < status_strings[i + 1].code) && status_strings_ascending(i + 1));
+}
+static_assert(status_strings_ascending(0), "status_strings must be sorted by strictly ascending code");
+
+const __FlashStringHelper *ASTRONODE::status_to_string(uint16_t code)
+{
+  // Binary search on the sorted table
+  uint8_t low = 0;
+  uint8_t high = sizeof(status_strings) / sizeof(status_strings[0]);
+  while (low < high)
+  {
+    uint8_t mid = (low + high) / 2;
+    uint16_t mid_code = pgm_read_word(&status_strings[mid].code);
+    if (mid_code == code)
+    {
+      return reinterpret_cast<const __FlashStringHelper *>(pgm_read_ptr(&status_strings[mid].message));
+    }
+    if (mid_code < code)
+    {
+      low = mid + 1;
+    }
+    else
+    {
+      high = mid;
+    }
+  }
+  return reinterpret_cast<const __FlashStringHelper *>(status_str_unknown);
+}
+
+size_t ASTRONODE::status_to_string(uint16_t code,
+                                   char *buffer,
+                                   size_t length)
+{
+  if (length == 0)
+  {
+    return 0;
+  }
+  const char *message = reinterpret_cast<const char *>(status_to_string(code));
+  strncpy_P(buffer, message, length - 1);
+  buffer[length - 1] = '\0';
+  return strlen(buffer);
+}
+
 void ASTRONODE::print_error_code_string(uint16_t code)
 {
-  switch (code)
-  {
-  case ANS_STATUS_CRC_NOT_VALID:
-    _debugSerial->print(F("ASTRONODE: Discrepancy between provided CRC and expected CRC.\n"));
-    break;
-  case ANS_STATUS_LENGTH_NOT_VALID:
-    _debugSerial->print(F("ASTRONODE: Message exceeds the maximum length for a frame.\n"));
-    break;
-  case ANS_STATUS_OPCODE_NOT_VALID:
-    _debugSerial->print(F("ASTRONODE: Invalid Operation Code used.\n"));
-    break;
-  case ANS_STATUS_ARG_NOT_VALID:
-    _debugSerial->print(F("ASTRONODE: Invalid argument used.\n"));
-    break;
-  case ANS_STATUS_FLASH_WRITING_FAILED:
-    _debugSerial->print(F("ASTRONODE: Failed to write to the flash.\n"));
-    break;
-  case ANS_STATUS_DEVICE_BUSY:
-    _debugSerial->print(F("ASTRONODE: Device is busy.\n"));
-    break;
-  case ANS_STATUS_FORMAT_NOT_VALID:
-    _debugSerial->print(F("ASTRONODE: At least one of the fields (SSID, password, token) is not composed of exclusively printable standard ASCII characters (0x20 to 0x7E).\n"));
-    break;
-  case ANS_STATUS_PERIOD_INVALID:
-    _debugSerial->print(F("ASTRONODE: The Satellite Search Config period enumeration value is not valid.\n"));
-    break;
-  case ANS_STATUS_BUFFER_FULL:
-    _debugSerial->print(F("ASTRONODE: Failed to queue the payload because the sending queue is already full.\n"));
-    break;
-  case ANS_STATUS_DUPLICATE_ID:
-    _debugSerial->print(F("ASTRONODE: Failed to queue the payload because the Payload ID provided by the asset is already in use in the terminal queue.\n"));
-    break;
-  case ANS_STATUS_BUFFER_EMPTY:
-    _debugSerial->print(F("ASTRONODE: Failed to dequeue a payload from the buffer because the buffer is empty.\n"));
-    break;
-  case ANS_STATUS_INVALID_POS:
-    _debugSerial->print(F("ASTRONODE: Invalid position.\n"));
-    break;
-  case ANS_STATUS_NO_ACK:
-    _debugSerial->print(F("ASTRONODE: No satellite acknowledgement available for any payload.\n"));
-    break;
-  case ANS_STATUS_NO_ACK_CLEAR:
-    _debugSerial->print(F("ASTRONODE: No payload ack to clear, or it was already cleared.\n"));
-    break;
-  case ANS_STATUS_NO_COMMAND:
-    _debugSerial->print(F("ASTRONODE: No command is available.\n"));
-    break;
-  case ANS_STATUS_NO_COMMAND_CLEAR:
-    _debugSerial->print(F("ASTRONODE: No command to clear, or it was already cleared.\n"));
-    break;
-  case ANS_STATUS_MAX_TX_REACHED:
-    _debugSerial->print(F("ASTRONODE: Failed to test Tx due to the maximum number of transmissions being reached.\n"));
-    break;
-  case ANS_STATUS_TIMEOUT:
-    _debugSerial->print(F("ASTRONODE: Failed to receive data from astronode before timeout.\n"));
-    break;
-  case ANS_STATUS_HW_ERR:
-    _debugSerial->print(F("ASTRONODE: Failed to send data to the terminal.\n"));
-    break;
-  case ANS_STATUS_SUCCESS:
-    _debugSerial->print(F(""));
-    break;
-  case ANS_STATUS_DATA_SENT:
-    _debugSerial->print(F(""));
-    break;
-  case ANS_STATUS_DATA_RECEIVED:
-    _debugSerial->print(F(""));
-    break;
-  default:
-    _debugSerial->print(F("ASTRONODE: Unknown error code.\n"));
-    break;
+  // Intermediate and success states are not printed
+  if (code == ANS_STATUS_SUCCESS || code == ANS_STATUS_DATA_SENT || code == ANS_STATUS_DATA_RECEIVED)
+  {
+    return;
   }
+  _debugSerial->print(F("ASTRONODE: "));
+  _debugSerial->println(status_to_string(code));
 }
 
 uint16_t ASTRONODE::crc_compute(uint8_t reg,
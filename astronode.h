@@ -17,10 +17,27 @@
 
 #if defined(ARDUINO) && ARDUINO >= 100
 #include <Arduino.h>
+#elif defined(ASTRONODE_HOST)
+#include "astronode_host.h"
 #else
 #include "WProgram.h"
 #endif
 
+// Optional features, disabled by default to save RAM on small MCUs (2 KB on the Uno). Uncomment here, or define in
+// the build flags, to enable them.
+//#define ASTRONODE_WITH_SNAPSHOT   // snapshot_read(): double-buffered telemetry snapshots (about 170 bytes of RAM on AVR)
+//#define ASTRONODE_WITH_WARM_START // begin_warm(): cached configuration and GUID (about 45 bytes of RAM on AVR)
+
+// Memory barrier for the lock-free snapshot (seqlock) readers and writer
+#if defined(ESP32) || defined(ESP_PLATFORM) || defined(ASTRONODE_HOST)
+#include <atomic>
+#define ASTRONODE_MEMORY_BARRIER() std::atomic_thread_fence(std::memory_order_seq_cst)
+#elif defined(__arm__)
+#define ASTRONODE_MEMORY_BARRIER() __sync_synchronize()
+#else
+#define ASTRONODE_MEMORY_BARRIER() __asm__ __volatile__("" ::: "memory")
+#endif
+
 // Timeout
 #define TIMEOUT_SERIAL 1500 // ms
 //#define TIMEOUT_FLASH 1400 // ms
@@ -33,6 +50,10 @@
 #define ETX_L 1
 #define PERR_L 2  // Error parameter length
 
+// Request table (see transact())
+#define OPCODE_IDEMPOTENT (1 << 0)   // Request can be sent again after a link error (timeout, CRC)
+#define TRANSACT_TABLE_LENGTH 0xFF // Answer length taken from the request table
+
 // REQUEST (Asset => Terminal)
 #define CFG_WR 0x05 // Write configuration, and store in non-volatile memory
 #define WIF_WR 0x06 // Write Wi-Fi settings, and store non-volatile memory (Wi-Fi only)
@@ -84,6 +105,7 @@
 #define CMD_RA 0xC7 // Answer last CMD_RR with command data
 #define CMD_CA 0xC8 // Answer last CMD_CR
 #define RES_CA 0xD5 // Answer the reset clear request
+#define TTX_SA 0xE1 // Answer confirming Test Transmit Start Request
 #define EVT_RA 0xE5 // Answer indicates which events are currently pending
 #define PER_SA 0xE6 // Answer confirming Context Save Request
 #define PER_RA 0xE7 // Answer with Performance Counters in Type, Length, Value format
@@ -129,6 +151,7 @@ typedef enum
   ANS_STATUS_DATA_RECEIVED,
   ANS_STATUS_PAYLOAD_TOO_LONG,
   ANS_STATUS_PAYLOD_ID_CHECK_FAILED,
+  ANS_STATUS_PENDING,
 } ans_status_e;
 
 // Satellite search period
@@ -156,6 +179,8 @@ typedef enum
 #define PER_TYPE_ACK_FRAGMENT_CNT 0x0C
 #define PER_TYPE_CMD_DEMOD_ATTEMPT_CNT 0x0D
 #define PER_TYPE_CMD_DEMOD_SUCCESS_CNT 0x0E
+#define PER_TYPE_CNT 14
+#define PER_INDEX(type) ((type)-PER_TYPE_SAT_SEARCH_PHASE_CNT) // Index of ASTRONODE::per_counter()
 
 // Module state types
 #define MST_CMD_LENGTH 15
@@ -195,6 +220,11 @@ typedef enum
 // Astrocast time
 #define ASTROCAST_REF_UNIX_TIME 1514764800 // 2018-01-01T00:00:00Z (= Astrocast time)
 
+class ASTRONODE_NVM;
+class ASTRONODE_LATENCY;
+class ASTRONODE_ENERGY;
+class ASTRONODE_CMDSTORE;
+
 class ASTRONODE
 {
 
@@ -206,13 +236,48 @@ private:
   bool _printDebug = false;     // Flag to print the serial commands we are sending to the Serial port for debug
   bool _printFullDebug = false; // Flag to print full debug messages. Useful for UART debugging
 
+  ASTRONODE_LATENCY *_latency = NULL; // Delivery latency tracking if enabled
+  ASTRONODE_ENERGY *_energy = NULL;   // Energy accounting if enabled
+  ASTRONODE_CMDSTORE *_cmdstore = NULL; // Commands already handled, if enabled
+  uint16_t _rx_bytes = 0;             // Bytes received by the last receive_decode_answer()
+
+  // Non-blocking request in progress (see async_request)
+  uint8_t *_async_buf = NULL;
+  uint16_t _async_length = 0;
+  uint16_t _async_max_length = 0;
+  unsigned long _async_deadline = 0; // millis() at which the request times out
+  unsigned long _async_start = 0;    // micros() at which the request was sent, for energy accounting
+  uint8_t _async_reg = 0;
+  uint16_t _async_tx_bytes = 0;
+
+  // Request table entry: request code, answer code, answer length, timeout, flags
+  typedef struct
+  {
+    uint8_t reg;
+    uint8_t answer_reg;
+    uint8_t answer_length;
+    uint8_t timeout; // x 100 ms
+    uint8_t flags;   // OPCODE_*
+  } ASTRONODE_OPCODE;
+  static const ASTRONODE_OPCODE _opcode_table[];
+
+  uint8_t _request_retries = 0;
+  unsigned long _transport_timeout = 0;
+
   // Functions prototype
+  bool opcode_read(uint8_t reg,
+                   ASTRONODE_OPCODE *op);
   ans_status_e encode_send_request(uint8_t reg,
                                    uint8_t *param,
                                    uint8_t param_length);
   ans_status_e receive_decode_answer(uint8_t *reg,
                                      uint8_t *param,
                                      uint8_t param_length);
+  ans_status_e decode_answer(uint8_t *com_buf_astronode_hex,
+                             size_t rx_length,
+                             uint8_t *reg,
+                             uint8_t *param,
+                             uint8_t param_length);
   void byte_array_to_hex_array(uint8_t *in,
                                uint8_t length,
                                uint8_t *out);
@@ -228,6 +293,33 @@ private:
   void print_array_to_hex(uint8_t data[],
                           size_t length);
   void print_error_code_string(uint16_t code);
+  void async_end(uint16_t rx_bytes);
+
+protected:
+  // Transport primitives (default implementation on the Stream given to begin())
+  virtual void transport_set_timeout(unsigned long timeout);
+  virtual size_t transport_write(uint8_t *data,
+                                 size_t length);
+  virtual size_t transport_read_until(uint8_t terminator,
+                                      uint8_t *data,
+                                      size_t length);
+  virtual void transport_discard_input(void);
+  virtual size_t transport_read_available(uint8_t *data,
+                                          size_t length);
+
+  // Single request/answer exchange driven by the request table: sends the request, checks the answer code and
+  // retries idempotent requests on link errors. Returns ANS_STATUS_SUCCESS or the error.
+  ans_status_e transact(uint8_t reg,
+                        uint8_t *param_w = NULL,
+                        uint8_t param_w_length = 0,
+                        uint8_t *param_a = NULL,
+                        uint8_t param_a_length = TRANSACT_TABLE_LENGTH);
+
+  ans_status_e connect(void);
+#if defined(ASTRONODE_WITH_WARM_START)
+  ans_status_e warm_connect(ASTRONODE_NVM *nvm,
+                            uint32_t address);
+#endif
 
 public:
   // Global variables
@@ -244,9 +336,24 @@ public:
     bool with_deep_sleep_en;
     bool with_msg_ack_pin_en;
     bool with_msg_reset_pin_en;
+    bool with_msg_cmd_pin_en;
+    bool with_msg_tx_pend_pin_en;
   } ASTRONODE_CONFIG;
   ASTRONODE_CONFIG config;
 
+  // UART link statistics, updated by each request
+  typedef struct
+  {
+    uint16_t requests; // Frames sent, retries included
+    uint16_t retries;
+    uint16_t timeouts;
+    uint16_t crc_errors;
+    uint16_t error_answers; // Requests answered with an error code by the module
+    uint16_t stale_answers; // Frames dropped because of their answer code (late answer to an earlier request)
+  } ASTRONODE_LINK_STATS;
+  ASTRONODE_LINK_STATS link_stats = {};
+
+  // Counters by name, or by index with per_counter()
   typedef struct
   {
     uint32_t sat_search_phase_cnt;
@@ -264,7 +371,11 @@ public:
     uint32_t cmd_demod_attempt_cnt;
     uint32_t cmd_demod_success_cnt;
   } ASTRONODE_PER_STRUCT;
-  ASTRONODE_PER_STRUCT per_struct;
+  ASTRONODE_PER_STRUCT per_struct = {};
+
+  // Counter of per at index PER_INDEX(PER_TYPE_*), index < PER_TYPE_CNT
+  static uint32_t *per_counter(ASTRONODE_PER_STRUCT *per,
+                               uint8_t index);
 
   typedef struct
   {
@@ -273,7 +384,7 @@ public:
     uint8_t last_rst;
     uint32_t uptime;
   } ASTRONODE_MST_STRUCT;
-  ASTRONODE_MST_STRUCT mst_struct;
+  ASTRONODE_MST_STRUCT mst_struct = {};
 
   typedef struct
   {
@@ -281,7 +392,7 @@ public:
     uint8_t last_sat_search_peak_rssi;
     uint32_t time_since_last_sat_search;
   } ASTRONODE_END_STRUCT;
-  ASTRONODE_END_STRUCT end_struct;
+  ASTRONODE_END_STRUCT end_struct = {};
 
   typedef struct
   {
@@ -290,16 +401,103 @@ public:
     uint8_t peak_rssi_last_contact;
     uint32_t time_peak_rssi_last_contact;
   } ASTRONODE_LCD_STRUCT;
-  ASTRONODE_LCD_STRUCT lcd_struct;
+  ASTRONODE_LCD_STRUCT lcd_struct = {};
+
+  // Consistent copy of the four structures above, see snapshot_read()
+  typedef struct
+  {
+    ASTRONODE_PER_STRUCT per;
+    ASTRONODE_MST_STRUCT mst;
+    ASTRONODE_END_STRUCT end;
+    ASTRONODE_LCD_STRUCT lcd;
+  } ASTRONODE_SNAPSHOT;
+
+private:
+#if defined(ASTRONODE_WITH_SNAPSHOT)
+  // Double-buffered snapshots, versioned by a sequence number (odd while a publication is in progress)
+  ASTRONODE_SNAPSHOT _snapshot[2] = {};
+  volatile uint8_t _snapshot_seq = 0;
+
+  void snapshot_publish(void);
+#else
+  void snapshot_publish(void) {}
+#endif
+
+#if defined(ASTRONODE_WITH_WARM_START)
+  // Warm start record, kept in non-volatile memory across MCU power cycles (see begin_warm)
+  typedef struct
+  {
+    uint8_t version;
+    ASTRONODE_CONFIG config;
+    char guid[36];
+    uint8_t last_rst; // Module state when the record was written
+    uint32_t uptime;
+    uint16_t crc;
+  } ASTRONODE_WARM_RECORD;
+
+  ASTRONODE_NVM *_warm_nvm = NULL;
+  uint32_t _warm_address = 0;
+  bool _warm_valid = false; // _warm_guid was read from the module or the warm start record
+  char _warm_guid[36];
+
+  bool warm_record_load(ASTRONODE_WARM_RECORD *record);
+  bool warm_record_save(void);
+  void warm_record_invalidate(void);
+#endif
+
+  bool _config_valid = false; // config matches the module configuration
+  uint8_t _per_clear_cnt = 0;
+
+public:
+  // Event handlers called by process_events(). A command is only cleared if its handler returns true.
+  typedef void (*ack_cb_t)(uint16_t id);
+  typedef bool (*command_cb_t)(uint8_t *data,
+                               uint8_t length,
+                               uint32_t createdDate);
+  typedef void (*reset_cb_t)(void);
+
+private:
+  ack_cb_t _ack_cb = NULL;
+  command_cb_t _command_cb = NULL;
+  uint8_t _command_length = DATA_CMD_40B_SIZE;
+  reset_cb_t _reset_cb = NULL;
+
+  ans_status_e event_register_read(uint8_t *events);
+
+public:
 
   // Functions prototype
   ans_status_e begin(Stream &serialPort);
+#if defined(ASTRONODE_WITH_WARM_START)
+  // Skip dummy_cmd, configuration_read and guid_read when the record in nvm shows the module was not reset since
+  // it was written (same last_rst, uptime not smaller). Falls back to a full begin otherwise and rewrites the record.
+  // The record uptime is updated on each warm start; configuration_save(), configuration_sync() and factory_reset()
+  // invalidate the record.
+  ans_status_e begin_warm(Stream &serialPort,
+                          ASTRONODE_NVM &nvm,
+                          uint32_t address = 0);
+#endif
   void end();
 
   void enableDebugging(Stream &debugPort,
                        bool printFullDebug);
   void disableDebugging(void);
 
+  // Number of times an idempotent request (reads, configuration writes) is sent again after a timeout or CRC error
+  void set_request_retries(uint8_t retries) { _request_retries = retries; }
+
+  // Track the delay from enqueue_payload() to the satellite ack read with read_satellite_ack()
+  void enableLatencyTracking(ASTRONODE_LATENCY &latency) { _latency = &latency; }
+  void disableLatencyTracking(void) { _latency = NULL; }
+
+  // Account the charge of requests and module activity (see astronode_energy.h)
+  void enableEnergyAccounting(ASTRONODE_ENERGY &energy) { _energy = &energy; }
+  void disableEnergyAccounting(void) { _energy = NULL; }
+
+  // Clear commands already handled without calling the command callback again (see astronode_cmdstore.h)
+  void enableCommandStore(ASTRONODE_CMDSTORE &store) { _cmdstore = &store; }
+  void disableCommandStore(void) { _cmdstore = NULL; }
+
   ans_status_e configuration_write(bool with_pl_ack,
                                    bool with_geoloc,
                                    bool with_ephemeris,
@@ -310,6 +508,15 @@ public:
                                    bool with_tx_pend_event_pin_mask);
   ans_status_e configuration_read(void);
   ans_status_e configuration_save(void);
+  // Read the configuration and only write and save it (flash write) if it differs from the desired one
+  ans_status_e configuration_sync(bool with_pl_ack,
+                                  bool with_geoloc,
+                                  bool with_ephemeris,
+                                  bool with_deep_sleep,
+                                  bool with_ack_event_pin_mask,
+                                  bool with_reset_event_pin_mask,
+                                  bool with_cmd_event_pin_mask,
+                                  bool with_tx_pend_event_pin_mask);
   ans_status_e wifi_configuration_write(const char *wland_ssid,
                                         const char *wland_key,
                                         const char *auth_token);
@@ -328,6 +535,7 @@ public:
   ans_status_e read_performance_counter(void);
   ans_status_e save_performance_counter(void);
   ans_status_e clear_performance_counter(void);
+  uint8_t performance_counter_clear_count(void) { return _per_clear_cnt; } // Incremented on each successful clear
   ans_status_e read_module_state(void);
   ans_status_e read_environment_details(void);
   ans_status_e read_last_contact_details(void);
@@ -335,9 +543,14 @@ public:
   ans_status_e enqueue_payload(uint8_t *data,
                                uint8_t length,
                                uint16_t id);
-  ans_status_e dequeue_payload(uint16_t *id);
+  // requeue: the caller enqueues the payload again with the same id (ASTRONODE_UPLINK), its delivery latency is kept
+  ans_status_e dequeue_payload(uint16_t *id,
+                               bool requeue = false);
   ans_status_e clear_free_payloads(void);
 
+  // Start a test transmission (installation tests), ANS_STATUS_MAX_TX_REACHED once the module limit is reached
+  ans_status_e test_transmit_start(void);
+
   ans_status_e read_command_8B(uint8_t data[DATA_CMD_8B_SIZE],
                                uint32_t *createdDate);
   ans_status_e read_command_40B(uint8_t data[DATA_CMD_40B_SIZE],
@@ -350,7 +563,141 @@ public:
   ans_status_e clear_satellite_ack(void);
   ans_status_e clear_reset_event(void);
 
+  void onAck(ack_cb_t cb) { _ack_cb = cb; }
+  // length: DATA_CMD_8B_SIZE or DATA_CMD_40B_SIZE, depending on the module
+  void onCommand(command_cb_t cb,
+                 uint8_t length = DATA_CMD_40B_SIZE)
+  {
+    _command_cb = cb;
+    _command_length = length;
+  }
+  void onReset(reset_cb_t cb) { _reset_cb = cb; }
+  // Read, dispatch and clear events until none is left (ANS_STATUS_SUCCESS) or the timeout expires
+  // (ANS_STATUS_TIMEOUT). A command is left pending if no handler is registered or the handler declines it.
+  // ANS_STATUS_HW_ERR if a handled command could not be written to the command store (it is cleared anyway).
+  ans_status_e process_events(unsigned long timeout = 2000);
+
   void dummy_cmd(void);
+
+  // Non-blocking requests: async_request() sends the request and returns immediately, async_poll() consumes the
+  // bytes already received and returns ANS_STATUS_PENDING until the answer is complete (ANS_STATUS_DATA_RECEIVED),
+  // failed or timed out (after timeout ms). Only one request can be in progress at a time.
+  ans_status_e async_request(uint8_t reg,
+                             uint8_t *param,
+                             uint8_t param_length,
+                             uint8_t answer_length,
+                             unsigned long timeout = TIMEOUT_SERIAL);
+  ans_status_e async_poll(uint8_t *reg,
+                          uint8_t *param,
+                          uint8_t param_length);
+  bool async_busy(void);
+  void async_cancel(void);
+
+#if defined(ASTRONODE_WITH_SNAPSHOT)
+  // Lock-free consistent read of per_struct, mst_struct, end_struct and lcd_struct, as of the last successful
+  // read_*() call. Safe from another task or an ISR, never blocks the modem I/O path.
+  void snapshot_read(ASTRONODE_SNAPSHOT *snapshot);
+  uint8_t snapshot_version(void);
+#endif
+
+  // Human readable message of a status code (module error codes and library status), kept in flash
+  static const __FlashStringHelper *status_to_string(uint16_t code);
+  // Same, copied into buffer (null terminated, truncated to length - 1 characters). Returns the string length.
+  static size_t status_to_string(uint16_t code,
+                                 char *buffer,
+                                 size_t length);
+
+  // Answer decoding (shared by the blocking requests and the async_poll() users)
+  void decode_module_state(uint8_t param[MST_CMD_LENGTH]);
+};
+
+// Same API as ASTRONODE, but bound at compile time to a concrete transport type (HardwareSerial, ring buffer,
+// host file descriptor, ...). The per-byte transport calls of the framing loops are direct calls the compiler
+// can inline, only the per-frame primitives go through the ASTRONODE vtable.
+// Transport must provide write(const uint8_t *, size_t), available() and read().
+template <class Transport>
+class ASTRONODE_T : public ASTRONODE
+{
+
+private:
+  Transport *_transport;
+  unsigned long _timeout = TIMEOUT_SERIAL;
+
+protected:
+  void transport_set_timeout(unsigned long timeout)
+  {
+    _timeout = timeout;
+  }
+  size_t transport_write(uint8_t *data,
+                         size_t length)
+  {
+    return _transport->write(data, length);
+  }
+  size_t transport_read_until(uint8_t terminator,
+                              uint8_t *data,
+                              size_t length)
+  {
+    // Same semantic as Stream::readBytesUntil (timeout restarted on each byte)
+    size_t index = 0;
+    bool waiting = false;
+    unsigned long start = 0;
+    while (index < length)
+    {
+      if (_transport->available() > 0)
+      {
+        uint8_t c = (uint8_t)_transport->read();
+        if (c == terminator)
+        {
+          break;
+        }
+        data[index++] = c;
+        waiting = false;
+      }
+      else if (!waiting)
+      {
+        start = millis();
+        waiting = true;
+      }
+      else if (millis() - start >= _timeout)
+      {
+        break;
+      }
+    }
+    return index;
+  }
+  void transport_discard_input(void)
+  {
+    while (_transport->available() > 0)
+    {
+      _transport->read();
+    }
+  }
+  size_t transport_read_available(uint8_t *data,
+                                  size_t length)
+  {
+    size_t index = 0;
+    while (index < length && _transport->available() > 0)
+    {
+      data[index++] = (uint8_t)_transport->read();
+    }
+    return index;
+  }
+
+public:
+  ans_status_e begin(Transport &transport)
+  {
+    _transport = &transport;
+    return connect();
+  }
+#if defined(ASTRONODE_WITH_WARM_START)
+  ans_status_e begin_warm(Transport &transport,
+                          ASTRONODE_NVM &nvm,
+                          uint32_t address = 0)
+  {
+    _transport = &transport;
+    return warm_connect(&nvm, address);
+  }
+#endif
 };
 
 #endif
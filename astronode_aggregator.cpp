@@ -0,0 +1,157 @@
+/******************************************************************************************
+ * File:        astronode_aggregator.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+
+#include "astronode_aggregator.h"
+
+ASTRONODE_AGGREGATOR::ASTRONODE_AGGREGATOR(ASTRONODE &modem,
+                                           unsigned long max_age,
+                                           uint32_t nco_lead)
+{
+  _modem = &modem;
+  _max_age = max_age;
+  _nco_lead = nco_lead;
+  _nco_time = 0;
+  reset_buffer(&_buffers[0]);
+  reset_buffer(&_buffers[1]);
+}
+
+void ASTRONODE_AGGREGATOR::reset_buffer(ASTRONODE_AGGREGATOR_BUFFER *buffer)
+{
+  buffer->data[0] = AGGREGATOR_FORMAT;
+  buffer->length = 1;
+  buffer->sealed = false;
+  buffer->first_record_time = 0;
+}
+
+bool ASTRONODE_AGGREGATOR::seal_active(void)
+{
+  ASTRONODE_AGGREGATOR_BUFFER *active = &_buffers[_active];
+  ASTRONODE_AGGREGATOR_BUFFER *other = &_buffers[_active ^ 1];
+
+  if (_reserved != NULL)
+  {
+    return false; // Record being written
+  }
+  if (active->length <= 1)
+  {
+    return true; // Nothing to seal
+  }
+  if (other->sealed)
+  {
+    return false; // Previous payload not enqueued yet
+  }
+
+  active->sealed = true;
+  _active ^= 1;
+  return true;
+}
+
+uint8_t *ASTRONODE_AGGREGATOR::reserve(uint8_t type,
+                                       uint8_t length)
+{
+  _reserved = NULL; // A record reserved and not committed is abandoned
+  if (length > AGGREGATOR_MAX_RECORD_SIZE)
+  {
+    return NULL;
+  }
+
+  ASTRONODE_AGGREGATOR_BUFFER *active = &_buffers[_active];
+  if (active->length + AGGREGATOR_RECORD_HEADER_SIZE + length > ASN_MAX_MSG_SIZE)
+  {
+    if (!seal_active())
+    {
+      _dropped_cnt++;
+      return NULL;
+    }
+    active = &_buffers[_active];
+  }
+
+  uint8_t *record = &active->data[active->length];
+  record[0] = type;
+  record[1] = length;
+  _reserved = record;
+  return &record[AGGREGATOR_RECORD_HEADER_SIZE];
+}
+
+void ASTRONODE_AGGREGATOR::commit(void)
+{
+  if (_reserved == NULL)
+  {
+    return;
+  }
+
+  ASTRONODE_AGGREGATOR_BUFFER *active = &_buffers[_active];
+  if (active->length <= 1)
+  {
+    active->first_record_time = millis();
+  }
+  active->length += AGGREGATOR_RECORD_HEADER_SIZE + _reserved[1];
+  _reserved = NULL;
+
+  // Full: no record fits anymore
+  if (active->length + AGGREGATOR_RECORD_HEADER_SIZE > ASN_MAX_MSG_SIZE)
+  {
+    seal_active();
+  }
+}
+
+bool ASTRONODE_AGGREGATOR::append(uint8_t type,
+                                  const uint8_t *data,
+                                  uint8_t length)
+{
+  uint8_t *record = reserve(type, length);
+  if (record == NULL)
+  {
+    return false;
+  }
+  memcpy(record, data, length);
+  commit();
+  return true;
+}
+
+ans_status_e ASTRONODE_AGGREGATOR::poll(void)
+{
+  ASTRONODE_AGGREGATOR_BUFFER *active = &_buffers[_active];
+  unsigned long now = millis();
+
+  if (active->length > 1 && _reserved == NULL)
+  {
+    // Age
+    if (_max_age != 0 && now - active->first_record_time >= _max_age)
+    {
+      seal_active();
+    }
+    // Upcoming contact
+    else if (_nco_lead != 0 && (!_nco_read || now - _nco_time >= AGGREGATOR_NCO_PERIOD))
+    {
+      uint32_t nco;
+      _nco_read = true;
+      _nco_time = now;
+      if (_modem->read_next_contact_opportunity(&nco) == ANS_STATUS_SUCCESS && nco <= _nco_lead)
+      {
+        seal_active();
+      }
+    }
+  }
+
+  // Enqueue the sealed payload
+  ASTRONODE_AGGREGATOR_BUFFER *sealed = &_buffers[_active ^ 1];
+  if (!sealed->sealed)
+  {
+    return ANS_STATUS_SUCCESS;
+  }
+  ans_status_e ret_val = _modem->enqueue_payload(sealed->data, sealed->length, _next_id);
+  if (ret_val == ANS_STATUS_SUCCESS)
+  {
+    _next_id++;
+    reset_buffer(sealed);
+  }
+  else if (ret_val == ANS_STATUS_DUPLICATE_ID)
+  {
+    _next_id++; // Retried with the next ID
+  }
+  return ret_val;
+}
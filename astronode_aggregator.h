@@ -0,0 +1,89 @@
+/******************************************************************************************
+ * File:        astronode_aggregator.h
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * Coalesces small typed records into full payloads (up to ASN_MAX_MSG_SIZE bytes):
+ *
+ *   [AGGREGATOR_FORMAT] [type][length][data...] [type][length][data...] ...
+ *
+ * Records are written in place: reserve() returns a pointer into the payload buffer and
+ * commit() validates the record, so no copy is made. A payload is sealed when the next
+ * record does not fit, when its first record is older than max_age, or when a contact is
+ * expected (next contact opportunity below nco_lead). poll() enqueues sealed payloads.
+ * Two buffers are used: records are appended to one while the other waits to be enqueued,
+ * so sampling never waits for the module.
+ *
+ * Payloads are split back into records by extras/aggregator_decode.py.
+ ****************************************************************************************/
+
+#ifndef _ASTRONODE_AGGREGATOR_h
+#define _ASTRONODE_AGGREGATOR_h
+
+#include "astronode.h"
+
+#define AGGREGATOR_FORMAT 0x01          // First byte of the payloads
+#define AGGREGATOR_RECORD_HEADER_SIZE 2 // Type and length
+#define AGGREGATOR_MAX_RECORD_SIZE (ASN_MAX_MSG_SIZE - 1 - AGGREGATOR_RECORD_HEADER_SIZE)
+#define AGGREGATOR_NCO_PERIOD 60000 // ms, next contact opportunity read period
+
+class ASTRONODE_AGGREGATOR
+{
+
+private:
+  typedef struct
+  {
+    uint8_t data[ASN_MAX_MSG_SIZE];
+    uint8_t length;
+    bool sealed;
+    unsigned long first_record_time; // millis() of the first record
+  } ASTRONODE_AGGREGATOR_BUFFER;
+
+  ASTRONODE *_modem;
+  ASTRONODE_AGGREGATOR_BUFFER _buffers[2];
+  uint8_t _active = 0; // Buffer records are appended to
+
+  unsigned long _max_age;
+  uint32_t _nco_lead;
+  unsigned long _nco_time;
+  bool _nco_read = false;
+
+  uint8_t *_reserved = NULL; // Record reserved, not committed yet
+  uint16_t _next_id = 0;
+  uint16_t _dropped_cnt = 0;
+
+  void reset_buffer(ASTRONODE_AGGREGATOR_BUFFER *buffer);
+  bool seal_active(void);
+
+public:
+  // max_age [ms]: maximum age of a record before its payload is enqueued, 0 to disable.
+  // nco_lead [s]: enqueue when the next contact opportunity is closer, 0 to disable.
+  ASTRONODE_AGGREGATOR(ASTRONODE &modem,
+                       unsigned long max_age,
+                       uint32_t nco_lead = 0);
+
+  // Zero-copy append: write length bytes at the returned pointer, then commit(). NULL if the record is too long or
+  // both buffers are full (record dropped). A record reserved and not committed is abandoned by the next reserve().
+  uint8_t *reserve(uint8_t type,
+                   uint8_t length);
+  void commit(void);
+  bool append(uint8_t type,
+              const uint8_t *data,
+              uint8_t length);
+
+  // Seal the payload being filled, enqueued by the next poll(). False if a record is reserved and not committed
+  // yet, or the previous payload is not enqueued yet.
+  bool flush(void) { return seal_active(); }
+
+  // Seal on age or upcoming contact and enqueue the sealed payload. Returns the enqueue_payload() status,
+  // ANS_STATUS_SUCCESS if there was nothing to enqueue.
+  ans_status_e poll(void);
+
+  void set_next_id(uint16_t id) { _next_id = id; }
+  uint16_t next_id(void) { return _next_id; }
+  uint16_t dropped_count(void) { return _dropped_cnt; } // Records dropped, both buffers full
+  uint8_t pending_length(void) { return _buffers[_active].length; }
+};
+
+#endif
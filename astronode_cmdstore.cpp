@@ -0,0 +1,160 @@
+/******************************************************************************************
+ * File:        astronode_cmdstore.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+
+#include "astronode_cmdstore.h"
+
+ASTRONODE_CMDSTORE::ASTRONODE_CMDSTORE(ASTRONODE_NVM &nvm,
+                                       uint32_t address)
+{
+  _nvm = &nvm;
+  _address = address;
+  memset(_slots, 0, sizeof(_slots));
+  memset(_buckets, CMDSTORE_NONE, sizeof(_buckets));
+}
+
+void ASTRONODE_CMDSTORE::begin(void)
+{
+  memset(_slots, 0, sizeof(_slots));
+  memset(_buckets, CMDSTORE_NONE, sizeof(_buckets));
+  _head = 0;
+  _seq = 0;
+
+  bool found = false;
+  uint16_t last_seq = 0;
+  for (uint8_t i = 0; i < ASTRONODE_CMDSTORE_SLOTS; i++)
+  {
+    uint8_t record[ASTRONODE_CMDSTORE_RECORD_SIZE];
+    if (!_nvm->read(_address + i * ASTRONODE_CMDSTORE_RECORD_SIZE, record, sizeof(record)) ||
+        (record[10] | (record[11] << 8)) != ASTRONODE_NVM::crc(record, 10))
+    {
+      continue; // Never written, or torn write
+    }
+
+    uint16_t seq = record[0] | (record[1] << 8);
+    memcpy(&_slots[i].created_date, &record[2], sizeof(uint32_t));
+    memcpy(&_slots[i].hash, &record[6], sizeof(uint32_t));
+    _slots[i].used = true;
+    index_insert(i);
+
+    if (!found || (int16_t)(seq - last_seq) > 0)
+    {
+      last_seq = seq;
+      _head = (i + 1) % ASTRONODE_CMDSTORE_SLOTS;
+      found = true;
+    }
+  }
+  _seq = found ? last_seq + 1 : 0;
+}
+
+bool ASTRONODE_CMDSTORE::seen(const uint8_t *data,
+                              uint8_t length,
+                              uint32_t created_date)
+{
+  return lookup(created_date, hash(data, length)) != CMDSTORE_NONE;
+}
+
+bool ASTRONODE_CMDSTORE::add(const uint8_t *data,
+                             uint8_t length,
+                             uint32_t created_date)
+{
+  uint32_t h = hash(data, length);
+  if (lookup(created_date, h) != CMDSTORE_NONE)
+  {
+    return true;
+  }
+
+  uint8_t record[ASTRONODE_CMDSTORE_RECORD_SIZE];
+  record[0] = _seq & 0xFF;
+  record[1] = _seq >> 8;
+  memcpy(&record[2], &created_date, sizeof(created_date));
+  memcpy(&record[6], &h, sizeof(h));
+  uint16_t crc = ASTRONODE_NVM::crc(record, 10);
+  record[10] = crc & 0xFF;
+  record[11] = crc >> 8;
+
+  // Oldest record overwritten
+  uint8_t slot = _head;
+  if (_slots[slot].used)
+  {
+    index_remove(slot);
+    _slots[slot].used = false;
+  }
+  if (!_nvm->write(_address + slot * ASTRONODE_CMDSTORE_RECORD_SIZE, record, sizeof(record)))
+  {
+    return false;
+  }
+
+  _slots[slot].created_date = created_date;
+  _slots[slot].hash = h;
+  _slots[slot].used = true;
+  index_insert(slot);
+  _head = (slot + 1) % ASTRONODE_CMDSTORE_SLOTS;
+  _seq++;
+  return true;
+}
+
+uint8_t ASTRONODE_CMDSTORE::count(void)
+{
+  uint8_t cnt = 0;
+  for (uint8_t i = 0; i < ASTRONODE_CMDSTORE_SLOTS; i++)
+  {
+    if (_slots[i].used)
+    {
+      cnt++;
+    }
+  }
+  return cnt;
+}
+
+uint32_t ASTRONODE_CMDSTORE::hash(const uint8_t *data,
+                                  uint8_t length)
+{
+  // FNV-1a
+  uint32_t h = 2166136261UL;
+  for (uint8_t i = 0; i < length; i++)
+  {
+    h ^= data[i];
+    h *= 16777619UL;
+  }
+  return h;
+}
+
+void ASTRONODE_CMDSTORE::index_insert(uint8_t slot)
+{
+  uint8_t b = (_slots[slot].created_date ^ _slots[slot].hash) & (ASTRONODE_CMDSTORE_BUCKETS - 1);
+  _slots[slot].next = _buckets[b];
+  _buckets[b] = slot;
+}
+
+void ASTRONODE_CMDSTORE::index_remove(uint8_t slot)
+{
+  uint8_t b = (_slots[slot].created_date ^ _slots[slot].hash) & (ASTRONODE_CMDSTORE_BUCKETS - 1);
+  int8_t *link = &_buckets[b];
+  while (*link != CMDSTORE_NONE)
+  {
+    if (*link == slot)
+    {
+      *link = _slots[slot].next;
+      return;
+    }
+    link = &_slots[*link].next;
+  }
+}
+
+int8_t ASTRONODE_CMDSTORE::lookup(uint32_t created_date,
+                                  uint32_t hash)
+{
+  int8_t i = _buckets[(created_date ^ hash) & (ASTRONODE_CMDSTORE_BUCKETS - 1)];
+  while (i != CMDSTORE_NONE)
+  {
+    if (_slots[i].created_date == created_date && _slots[i].hash == hash)
+    {
+      return i;
+    }
+    i = _slots[i].next;
+  }
+  return CMDSTORE_NONE;
+}
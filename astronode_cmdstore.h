@@ -0,0 +1,84 @@
+/******************************************************************************************
+ * File:        astronode_cmdstore.h
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * Store of the last downlink commands handled, on an ASTRONODE_NVM region, so that a
+ * command is handled once even if the asset resets between its handling and
+ * clear_command(). Commands are keyed by createdDate and a hash of their content.
+ *
+ * The store is a ring of ASTRONODE_CMDSTORE_SLOTS records written in turn (one record
+ * written per command handled):
+ *   [seq u16][createdDate u32][hash u32][crc u16]
+ * The ring head is the slot following the highest seq. A RAM hash index (buckets chained
+ * through the slots) gives the duplicate lookup in constant time.
+ *
+ * With ASTRONODE::enableCommandStore(), process_events() clears a command already in the
+ * store without calling the command callback, and adds a command to the store once the
+ * callback returned true, before clearing it.
+ ****************************************************************************************/
+
+#ifndef _ASTRONODE_CMDSTORE_h
+#define _ASTRONODE_CMDSTORE_h
+
+#include "astronode.h"
+#include "astronode_nvm.h"
+
+#define ASTRONODE_CMDSTORE_SLOTS 16
+#define ASTRONODE_CMDSTORE_BUCKETS 16 // Power of 2
+#define ASTRONODE_CMDSTORE_RECORD_SIZE 12
+#define ASTRONODE_CMDSTORE_SIZE (ASTRONODE_CMDSTORE_SLOTS * ASTRONODE_CMDSTORE_RECORD_SIZE) // Bytes of nvm used
+
+#define CMDSTORE_NONE -1
+
+class ASTRONODE_CMDSTORE
+{
+
+private:
+  typedef struct
+  {
+    uint32_t created_date;
+    uint32_t hash;
+    int8_t next; // Next slot in the same bucket, CMDSTORE_NONE at the end
+    bool used;
+  } ASTRONODE_CMDSTORE_SLOT;
+
+  ASTRONODE_NVM *_nvm;
+  uint32_t _address;
+
+  ASTRONODE_CMDSTORE_SLOT _slots[ASTRONODE_CMDSTORE_SLOTS];
+  int8_t _buckets[ASTRONODE_CMDSTORE_BUCKETS];
+  uint8_t _head = 0;
+  uint16_t _seq = 0;
+  uint16_t _duplicates = 0;
+
+  static uint32_t hash(const uint8_t *data,
+                       uint8_t length);
+  void index_insert(uint8_t slot);
+  void index_remove(uint8_t slot);
+  int8_t lookup(uint32_t created_date,
+                uint32_t hash);
+
+public:
+  ASTRONODE_CMDSTORE(ASTRONODE_NVM &nvm,
+                     uint32_t address);
+
+  // Load the records from nvm
+  void begin(void);
+
+  // Command already handled
+  bool seen(const uint8_t *data,
+            uint8_t length,
+            uint32_t created_date);
+  // Record a handled command, evicting the oldest one (false if it could not be written)
+  bool add(const uint8_t *data,
+           uint8_t length,
+           uint32_t created_date);
+  void duplicate(void) { _duplicates++; } // Counted by ASTRONODE::process_events()
+
+  uint8_t count(void);
+  uint16_t duplicates(void) { return _duplicates; }
+};
+
+#endif
@@ -0,0 +1,327 @@
+/******************************************************************************************
+ * File:        astronode_coro.h
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * Optional C++20 coroutine API (host and ESP32 builds), on top of the non-blocking
+ * async_request()/async_poll() of ASTRONODE:
+ *
+ *   ASTRONODE_TASK modem_logic(ASTRONODE_CORO &modem)
+ *   {
+ *     auto t = co_await modem.rtc_read();
+ *     if (t.status == ANS_STATUS_SUCCESS) { ... t.value ... }
+ *   }
+ *
+ * Each operation resumes the coroutine when its answer is decoded or its deadline expires.
+ * The deadline (TIMEOUT_SERIAL by default) covers the wait for the UART and the answer;
+ * longer deadlines suit requests the module answers late.
+ * ASTRONODE_CORO::run() must be called periodically (main loop or modem task). Coroutine
+ * frames are allocated from a fixed pool, never from the heap.
+ ****************************************************************************************/
+
+#ifndef _ASTRONODE_CORO_h
+#define _ASTRONODE_CORO_h
+
+#include "astronode.h"
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+
+#include <coroutine>
+
+#define ASTRONODE_CORO_POOL_SIZE 4     // Coroutine frames alive at the same time
+#define ASTRONODE_CORO_FRAME_SIZE 1024 // Bytes per coroutine frame (an enqueue_payload() awaitable holds a full payload)
+
+// Fixed pool of coroutine frames
+class ASTRONODE_CORO_POOL
+{
+
+private:
+  alignas(max_align_t) static inline uint8_t _frames[ASTRONODE_CORO_POOL_SIZE][ASTRONODE_CORO_FRAME_SIZE];
+  static inline bool _used[ASTRONODE_CORO_POOL_SIZE];
+
+public:
+  static void *allocate(size_t size)
+  {
+    if (size <= ASTRONODE_CORO_FRAME_SIZE)
+    {
+      for (uint8_t i = 0; i < ASTRONODE_CORO_POOL_SIZE; i++)
+      {
+        if (!_used[i])
+        {
+          _used[i] = true;
+          return _frames[i];
+        }
+      }
+    }
+    return nullptr;
+  }
+  static void release(void *frame)
+  {
+    for (uint8_t i = 0; i < ASTRONODE_CORO_POOL_SIZE; i++)
+    {
+      if (frame == _frames[i])
+      {
+        _used[i] = false;
+      }
+    }
+  }
+};
+
+// Fire-and-forget coroutine, started immediately, frame released when it returns
+class ASTRONODE_TASK
+{
+
+public:
+  struct promise_type
+  {
+    static void *operator new(size_t size) noexcept { return ASTRONODE_CORO_POOL::allocate(size); }
+    static void operator delete(void *frame) noexcept { ASTRONODE_CORO_POOL::release(frame); }
+    static ASTRONODE_TASK get_return_object_on_allocation_failure() noexcept { return ASTRONODE_TASK(false); }
+
+    ASTRONODE_TASK get_return_object() noexcept { return ASTRONODE_TASK(true); }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept {}
+  };
+
+  // False if no coroutine frame could be allocated from the pool
+  bool started(void) const { return _started; }
+
+private:
+  bool _started;
+  explicit ASTRONODE_TASK(bool started) : _started(started) {}
+};
+
+template <typename T>
+struct ASTRONODE_CORO_RESULT
+{
+  ans_status_e status;
+  T value;
+};
+
+class ASTRONODE_CORO;
+
+// One request/answer exchange, living in the awaiting coroutine frame
+class ASTRONODE_CORO_OP
+{
+  friend class ASTRONODE_CORO;
+
+protected:
+  ASTRONODE_CORO *_coro;
+  uint8_t _reg;
+  uint8_t _answer_reg;
+  uint8_t *_param_w = nullptr;
+  uint8_t _param_w_length = 0;
+  uint8_t _param_a[MST_CMD_LENGTH] = {};
+  uint8_t _param_a_length;
+  unsigned long _start;
+  unsigned long _timeout;
+  ans_status_e _status = ANS_STATUS_PENDING;
+  std::coroutine_handle<> _handle;
+  ASTRONODE_CORO_OP *_next = nullptr;
+
+  ASTRONODE_CORO_OP(ASTRONODE_CORO *coro,
+                    uint8_t reg,
+                    uint8_t answer_reg,
+                    uint8_t param_a_length,
+                    unsigned long timeout)
+      : _coro(coro), _reg(reg), _answer_reg(answer_reg), _param_a_length(param_a_length), _start(millis()),
+        _timeout(timeout) {}
+
+  uint32_t answer_u32(void)
+  {
+    return (((uint32_t)_param_a[3]) << 24) +
+           (((uint32_t)_param_a[2]) << 16) +
+           (((uint32_t)_param_a[1]) << 8) +
+           (((uint32_t)_param_a[0]) << 0);
+  }
+  uint16_t answer_u16(void)
+  {
+    return (((uint16_t)_param_a[1]) << 8) + ((uint16_t)_param_a[0]);
+  }
+
+public:
+  bool await_ready(void) const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> handle) noexcept;
+};
+
+class ASTRONODE_CORO
+{
+  friend class ASTRONODE_CORO_OP;
+
+private:
+  ASTRONODE *_modem;
+  ASTRONODE_CORO_OP *_head = nullptr; // Operations waiting for the UART, FIFO
+  ASTRONODE_CORO_OP *_tail = nullptr;
+  ASTRONODE_CORO_OP *_active = nullptr;
+
+  void complete(ASTRONODE_CORO_OP *op,
+                ans_status_e status)
+  {
+    op->_status = status;
+    op->_handle.resume();
+  }
+
+public:
+  // Awaitable operations
+  struct RTC_READ : ASTRONODE_CORO_OP
+  {
+    RTC_READ(ASTRONODE_CORO *coro, unsigned long timeout) : ASTRONODE_CORO_OP(coro, RTC_RR, RTC_RA, 4, timeout) {}
+    ASTRONODE_CORO_RESULT<uint32_t> await_resume(void)
+    {
+      return {_status, (_status == ANS_STATUS_SUCCESS) ? answer_u32() + ASTROCAST_REF_UNIX_TIME : 0};
+    }
+  };
+  struct NCO_READ : ASTRONODE_CORO_OP
+  {
+    NCO_READ(ASTRONODE_CORO *coro, unsigned long timeout) : ASTRONODE_CORO_OP(coro, NCO_RR, NCO_RA, 4, timeout) {}
+    ASTRONODE_CORO_RESULT<uint32_t> await_resume(void)
+    {
+      return {_status, (_status == ANS_STATUS_SUCCESS) ? answer_u32() : 0};
+    }
+  };
+  struct MST_READ : ASTRONODE_CORO_OP
+  {
+    MST_READ(ASTRONODE_CORO *coro, unsigned long timeout)
+        : ASTRONODE_CORO_OP(coro, MST_RR, MST_RA, MST_CMD_LENGTH, timeout) {}
+    ans_status_e await_resume(void)
+    {
+      if (_status == ANS_STATUS_SUCCESS)
+      {
+        _coro->_modem->decode_module_state(_param_a);
+      }
+      return _status;
+    }
+  };
+  struct ENQUEUE : ASTRONODE_CORO_OP
+  {
+    uint8_t _payload[ASN_MAX_MSG_SIZE + 2];
+
+    ENQUEUE(ASTRONODE_CORO *coro, uint8_t *data, uint8_t length, uint16_t id, unsigned long timeout)
+        : ASTRONODE_CORO_OP(coro, PLD_ER, PLD_EA, 2, timeout)
+    {
+      _payload[0] = (uint8_t)id;
+      _payload[1] = (uint8_t)(id >> 8);
+      memcpy(&_payload[2], data, length);
+      _param_w = _payload;
+      _param_w_length = length + 2;
+    }
+    ans_status_e await_resume(void)
+    {
+      if (_status == ANS_STATUS_SUCCESS &&
+          answer_u16() != ((((uint16_t)_payload[1]) << 8) + ((uint16_t)_payload[0])))
+      {
+        return ANS_STATUS_PAYLOD_ID_CHECK_FAILED;
+      }
+      return _status;
+    }
+  };
+  struct SAT_ACK_READ : ASTRONODE_CORO_OP
+  {
+    SAT_ACK_READ(ASTRONODE_CORO *coro, unsigned long timeout) : ASTRONODE_CORO_OP(coro, SAK_RR, SAK_RA, 2, timeout) {}
+    ASTRONODE_CORO_RESULT<uint16_t> await_resume(void)
+    {
+      return {_status, (_status == ANS_STATUS_SUCCESS) ? answer_u16() : (uint16_t)0};
+    }
+  };
+  struct SIMPLE : ASTRONODE_CORO_OP
+  {
+    SIMPLE(ASTRONODE_CORO *coro, uint8_t reg, uint8_t answer_reg, unsigned long timeout)
+        : ASTRONODE_CORO_OP(coro, reg, answer_reg, 0, timeout) {}
+    ans_status_e await_resume(void) { return _status; }
+  };
+
+  ASTRONODE_CORO(ASTRONODE &modem) : _modem(&modem) {}
+
+  RTC_READ rtc_read(unsigned long timeout = TIMEOUT_SERIAL) { return RTC_READ(this, timeout); }
+  NCO_READ read_next_contact_opportunity(unsigned long timeout = TIMEOUT_SERIAL) { return NCO_READ(this, timeout); }
+  MST_READ read_module_state(unsigned long timeout = TIMEOUT_SERIAL) { return MST_READ(this, timeout); }
+  ENQUEUE enqueue_payload(uint8_t *data,
+                          uint8_t length,
+                          uint16_t id,
+                          unsigned long timeout = TIMEOUT_SERIAL)
+  {
+    return ENQUEUE(this, data, (length <= ASN_MAX_MSG_SIZE) ? length : ASN_MAX_MSG_SIZE, id, timeout);
+  }
+  SAT_ACK_READ read_satellite_ack(unsigned long timeout = TIMEOUT_SERIAL) { return SAT_ACK_READ(this, timeout); }
+  SIMPLE clear_satellite_ack(unsigned long timeout = TIMEOUT_SERIAL) { return SIMPLE(this, SAK_CR, SAK_CA, timeout); }
+
+  bool idle(void) const { return _active == nullptr && _head == nullptr; }
+
+  // Progress the operation in flight, start the next one and resume the coroutines whose operation completed.
+  void run(void)
+  {
+    if (_active != nullptr)
+    {
+      ASTRONODE_CORO_OP *op = _active;
+      uint8_t reg;
+      ans_status_e ret_val = _modem->async_poll(&reg, op->_param_a, op->_param_a_length);
+      if (ret_val == ANS_STATUS_PENDING)
+      {
+        if (millis() - op->_start < op->_timeout)
+        {
+          return;
+        }
+        _modem->async_cancel();
+        ret_val = ANS_STATUS_TIMEOUT;
+      }
+      else if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == op->_answer_reg)
+      {
+        ret_val = ANS_STATUS_SUCCESS;
+      }
+      _active = nullptr;
+      complete(op, ret_val);
+    }
+
+    while (_active == nullptr && _head != nullptr)
+    {
+      ASTRONODE_CORO_OP *op = _head;
+      _head = op->_next;
+      if (_head == nullptr)
+      {
+        _tail = nullptr;
+      }
+
+      if (millis() - op->_start >= op->_timeout)
+      {
+        complete(op, ANS_STATUS_TIMEOUT); // Deadline expired while waiting for the UART
+        continue;
+      }
+      // The answer is awaited until the deadline of the operation, not only TIMEOUT_SERIAL
+      unsigned long remaining = op->_timeout - (millis() - op->_start);
+      ans_status_e ret_val = _modem->async_request(op->_reg, op->_param_w, op->_param_w_length, op->_param_a_length,
+                                                   remaining);
+      if (ret_val == ANS_STATUS_DATA_SENT)
+      {
+        _active = op;
+      }
+      else
+      {
+        complete(op, ret_val);
+      }
+    }
+  }
+};
+
+inline void ASTRONODE_CORO_OP::await_suspend(std::coroutine_handle<> handle) noexcept
+{
+  _handle = handle;
+  _next = nullptr;
+  if (_coro->_tail != nullptr)
+  {
+    _coro->_tail->_next = this;
+  }
+  else
+  {
+    _coro->_head = this;
+  }
+  _coro->_tail = this;
+}
+
+#endif
+#endif
+
+#endif
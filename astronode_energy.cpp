@@ -0,0 +1,132 @@
+/******************************************************************************************
+ * File:        astronode_energy.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+
+#include "astronode_energy.h"
+
+ASTRONODE_ENERGY::ASTRONODE_ENERGY_OPCODE *ASTRONODE_ENERGY::opcode_find(uint8_t reg)
+{
+  for (uint8_t i = 0; i < _opcode_count; i++)
+  {
+    if (_opcodes[i].reg == reg)
+    {
+      return &_opcodes[i];
+    }
+  }
+  if (_opcode_count < ASTRONODE_ENERGY_OPCODES - 1)
+  {
+    _opcodes[_opcode_count].reg = reg;
+    return &_opcodes[_opcode_count++];
+  }
+
+  // Table full, the last slot sums the other request codes
+  _opcode_count = ASTRONODE_ENERGY_OPCODES;
+  _opcodes[ASTRONODE_ENERGY_OPCODES - 1].reg = 0x00;
+  return &_opcodes[ASTRONODE_ENERGY_OPCODES - 1];
+}
+
+uint64_t ASTRONODE_ENERGY::cycle_charge(const ASTRONODE_ENERGY_CYCLE &cycle)
+{
+  return cycle.mcu + cycle.uart + cycle.module + cycle.sd;
+}
+
+void ASTRONODE_ENERGY::request(uint8_t reg,
+                               uint32_t duration_us,
+                               uint16_t wire_bytes)
+{
+  uint64_t mcu = (uint64_t)_config.mcu_awake_ua * duration_us;
+  uint64_t uart = 0;
+  if (_config.baudrate > 0)
+  {
+    uart = (uint64_t)_config.uart_active_ua * wire_bytes * ASTRONODE_ENERGY_UART_BITS * 1000000UL / _config.baudrate;
+  }
+
+  _cycle.mcu += mcu;
+  _cycle.uart += uart;
+  _cycle.requests++;
+  _request_us += duration_us;
+
+  ASTRONODE_ENERGY_OPCODE *op = opcode_find(reg);
+  op->count++;
+  op->charge += mcu + uart;
+}
+
+void ASTRONODE_ENERGY::performance_counters(uint32_t search_phase_cnt,
+                                            uint32_t sent_fragment_cnt)
+{
+  if (_counters_valid)
+  {
+    // Counters cleared (or module reset) since the last read: count from zero
+    uint32_t searches = (search_phase_cnt >= _search_cnt) ? search_phase_cnt - _search_cnt : search_phase_cnt;
+    uint32_t fragments = (sent_fragment_cnt >= _fragment_cnt) ? sent_fragment_cnt - _fragment_cnt : sent_fragment_cnt;
+
+    if (_config.module_search_ua > _config.module_idle_ua)
+    {
+      _cycle.module += (uint64_t)(_config.module_search_ua - _config.module_idle_ua) * searches * _config.search_phase_ms * 1000;
+    }
+    if (_config.module_tx_ua > _config.module_idle_ua)
+    {
+      _cycle.module += (uint64_t)(_config.module_tx_ua - _config.module_idle_ua) * fragments * _config.fragment_tx_ms * 1000;
+    }
+  }
+  _search_cnt = search_phase_cnt;
+  _fragment_cnt = sent_fragment_cnt;
+  _counters_valid = true;
+}
+
+void ASTRONODE_ENERGY::sd_write(uint32_t duration_us)
+{
+  _cycle.sd += (uint64_t)_config.sd_write_ua * duration_us;
+}
+
+void ASTRONODE_ENERGY::begin_cycle(void)
+{
+  _cycle_start = micros();
+  _request_us = 0;
+}
+
+void ASTRONODE_ENERGY::end_cycle(uint32_t sleep_ms)
+{
+  uint32_t awake_us = micros() - _cycle_start;
+  if (awake_us > _request_us)
+  {
+    _cycle.mcu += (uint64_t)_config.mcu_awake_ua * (awake_us - _request_us); // Requests already accounted
+  }
+  _cycle.mcu += (uint64_t)_config.mcu_sleep_ua * sleep_ms * 1000;
+  _cycle.module += (uint64_t)_config.module_idle_ua * ((uint64_t)awake_us + (uint64_t)sleep_ms * 1000);
+  _cycle.awake_ms = awake_us / 1000;
+  _cycle.sleep_ms = sleep_ms;
+
+  _total += cycle_charge(_cycle);
+  _last_cycle = _cycle;
+  memset(&_cycle, 0, sizeof(_cycle));
+  begin_cycle();
+}
+
+void ASTRONODE_ENERGY::clear(void)
+{
+  memset(_opcodes, 0, sizeof(_opcodes));
+  _opcode_count = 0;
+  memset(&_cycle, 0, sizeof(_cycle));
+  memset(&_last_cycle, 0, sizeof(_last_cycle));
+  _total = 0;
+  _counters_valid = false;
+  begin_cycle();
+}
+
+bool ASTRONODE_ENERGY::opcode(uint8_t index,
+                              uint8_t *reg,
+                              uint16_t *count,
+                              float *mah)
+{
+  if (index >= _opcode_count)
+  {
+    return false;
+  }
+  *reg = _opcodes[index].reg;
+  *count = _opcodes[index].count;
+  *mah = to_mah(_opcodes[index].charge);
+  return true;
+}
@@ -0,0 +1,112 @@
+/******************************************************************************************
+ * File:        astronode_energy.h
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * Energy accounting, enabled with ASTRONODE::enableEnergyAccounting(). Charge is integrated
+ * from the configured current draws (uA) and measured durations:
+ *   - each request: MCU awake during the exchange, UART active for the bytes on the wire
+ *     at the configured baudrate, accumulated per request code. Blocking requests and
+ *     async_request() (ASTRONODE_MANAGER, ASTRONODE_CORO) alike, from the request to the
+ *     answer, timeout or async_cancel(),
+ *   - satellite search and transmission: the module search / TX current over the idle one,
+ *     for the search phases and fragments counted by read_performance_counter(),
+ *   - SD writes reported by the application with sd_write(),
+ *   - cycles (begin_cycle() / end_cycle()): MCU awake outside requests, MCU asleep and the
+ *     module idle over the whole cycle.
+ * Charges are kept in pC (uA x us), results are given in mAh.
+ ****************************************************************************************/
+
+#ifndef _ASTRONODE_ENERGY_h
+#define _ASTRONODE_ENERGY_h
+
+#include "astronode.h"
+
+#define ASTRONODE_ENERGY_OPCODES 16          // Request codes accounted separately, others are summed in slot 0x00
+#define ASTRONODE_ENERGY_UART_BITS 10        // 8N1 frame
+#define ASTRONODE_ENERGY_PC_PER_MAH 3.6e12   // 1 mAh = 3.6 C
+
+typedef struct
+{
+  uint32_t mcu_awake_ua;
+  uint32_t mcu_sleep_ua;
+  uint32_t uart_active_ua;
+  uint32_t module_idle_ua;
+  uint32_t module_search_ua;
+  uint32_t module_tx_ua;
+  uint32_t sd_write_ua;
+  uint16_t search_phase_ms; // Duration of one satellite search phase
+  uint16_t fragment_tx_ms;  // Duration of one fragment transmission
+  uint32_t baudrate;        // Asset - module UART
+} ASTRONODE_ENERGY_CONFIG;
+
+typedef struct
+{
+  uint64_t mcu;    // [pC]
+  uint64_t uart;   // [pC]
+  uint64_t module; // [pC]
+  uint64_t sd;     // [pC]
+  uint32_t awake_ms;
+  uint32_t sleep_ms;
+  uint16_t requests;
+} ASTRONODE_ENERGY_CYCLE;
+
+class ASTRONODE_ENERGY
+{
+
+private:
+  typedef struct
+  {
+    uint8_t reg;
+    uint16_t count;
+    uint64_t charge; // [pC]
+  } ASTRONODE_ENERGY_OPCODE;
+
+  ASTRONODE_ENERGY_CONFIG _config;
+  ASTRONODE_ENERGY_OPCODE _opcodes[ASTRONODE_ENERGY_OPCODES] = {};
+  uint8_t _opcode_count = 0;
+
+  ASTRONODE_ENERGY_CYCLE _cycle = {};
+  ASTRONODE_ENERGY_CYCLE _last_cycle = {};
+  uint64_t _total = 0; // Closed cycles [pC]
+
+  unsigned long _cycle_start = 0; // micros()
+  uint32_t _request_us = 0;       // Spent in requests during the cycle
+  bool _counters_valid = false;
+  uint32_t _search_cnt = 0;
+  uint32_t _fragment_cnt = 0;
+
+  ASTRONODE_ENERGY_OPCODE *opcode_find(uint8_t reg);
+  static uint64_t cycle_charge(const ASTRONODE_ENERGY_CYCLE &cycle);
+
+public:
+  ASTRONODE_ENERGY(const ASTRONODE_ENERGY_CONFIG &config) : _config(config) {}
+
+  // Called by ASTRONODE
+  void request(uint8_t reg,
+               uint32_t duration_us,
+               uint16_t wire_bytes);
+  void performance_counters(uint32_t search_phase_cnt,
+                            uint32_t sent_fragment_cnt);
+
+  // Called by the application
+  void sd_write(uint32_t duration_us);
+  void begin_cycle(void);
+  void end_cycle(uint32_t sleep_ms); // Closes the cycle, sleep_ms is the sleep that follows (e.g. Watchdog.sleep() result)
+  void clear(void);
+
+  const ASTRONODE_ENERGY_CYCLE &last_cycle(void) { return _last_cycle; }
+  float last_cycle_mah(void) { return to_mah(cycle_charge(_last_cycle)); }
+  float total_mah(void) { return to_mah(_total + cycle_charge(_cycle)); }
+
+  uint8_t opcode_count(void) { return _opcode_count; }
+  bool opcode(uint8_t index,
+              uint8_t *reg,
+              uint16_t *count,
+              float *mah);
+
+  static float to_mah(uint64_t charge) { return (float)(charge / ASTRONODE_ENERGY_PC_PER_MAH); }
+};
+
+#endif
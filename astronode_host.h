@@ -0,0 +1,226 @@
+/******************************************************************************************
+ * File:        astronode_host.h
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * Minimal subset of the Arduino core (Print, Stream, String, millis, PROGMEM helpers)
+ * used by the library, so that it can be built on a POSIX host (e.g. Linux gateway).
+ *
+ * Only used when the library is compiled with -DASTRONODE_HOST.
+ ****************************************************************************************/
+
+#ifndef _ASTRONODE_HOST_h
+#define _ASTRONODE_HOST_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// Program memory (flat address space on host)
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr) (*(void *const *)(addr))
+#define memcpy_P memcpy
+#define strncpy_P strncpy
+#define strlen_P strlen
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+// Time
+inline unsigned long micros(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long)((uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL);
+}
+
+inline unsigned long millis(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long)((uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL);
+}
+
+inline void delay(unsigned long ms)
+{
+  struct timespec ts;
+  ts.tv_sec = ms / 1000;
+  ts.tv_nsec = (ms % 1000) * 1000000L;
+  nanosleep(&ts, NULL);
+}
+
+class String
+{
+private:
+  std::string _str;
+
+public:
+  String(void) {}
+  String(const char *str) : _str(str) {}
+
+  bool concat(char c)
+  {
+    _str += c;
+    return true;
+  }
+  bool concat(const char *str)
+  {
+    _str += str;
+    return true;
+  }
+  unsigned int length(void) const { return (unsigned int)_str.length(); }
+  const char *c_str(void) const { return _str.c_str(); }
+  char operator[](unsigned int index) const { return _str[index]; }
+  bool operator==(const String &rhs) const { return _str == rhs._str; }
+  bool operator!=(const String &rhs) const { return _str != rhs._str; }
+  String &operator+=(char c)
+  {
+    _str += c;
+    return *this;
+  }
+  String &operator+=(const char *str)
+  {
+    _str += str;
+    return *this;
+  }
+};
+
+class Print
+{
+private:
+  size_t print_number(unsigned long n, uint8_t base)
+  {
+    char buf[8 * sizeof(long) + 1];
+    char *str = &buf[sizeof(buf) - 1];
+    *str = '\0';
+    if (base < 2)
+      base = 10;
+    do
+    {
+      char c = n % base;
+      n /= base;
+      *--str = c < 10 ? c + '0' : c + 'A' - 10;
+    } while (n);
+    return write(str);
+  }
+
+public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size)
+  {
+    size_t n = 0;
+    while (size--)
+    {
+      if (write(*buffer++))
+        n++;
+      else
+        break;
+    }
+    return n;
+  }
+  size_t write(const char *str)
+  {
+    return (str == NULL) ? 0 : write((const uint8_t *)str, strlen(str));
+  }
+
+  size_t print(const __FlashStringHelper *str) { return write(reinterpret_cast<const char *>(str)); }
+  size_t print(const char *str) { return write(str); }
+  size_t print(const String &str) { return write(str.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char n, int base = DEC) { return print_number(n, base); }
+  size_t print(int n, int base = DEC) { return print((long)n, base); }
+  size_t print(unsigned int n, int base = DEC) { return print_number(n, base); }
+  size_t print(long n, int base = DEC)
+  {
+    if (base == DEC && n < 0)
+      return write((uint8_t)'-') + print_number((unsigned long)(-n), DEC);
+    return print_number((unsigned long)n, base);
+  }
+  size_t print(unsigned long n, int base = DEC) { return print_number(n, base); }
+  size_t print(double n, int digits = 2)
+  {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*f", digits, n);
+    return write(buf);
+  }
+
+  size_t println(void) { return write("\r\n"); }
+  template <typename T>
+  size_t println(const T &value) { return print(value) + println(); }
+  template <typename T>
+  size_t println(const T &value, int format) { return print(value, format) + println(); }
+};
+
+class Stream : public Print
+{
+protected:
+  unsigned long _timeout = 1000; // ms
+
+  // Read a byte, waiting at most _timeout ms. Transports can override it to block on the OS instead of spinning.
+  virtual int timedRead(void)
+  {
+    unsigned long start = millis();
+    do
+    {
+      int c = read();
+      if (c >= 0)
+        return c;
+    } while (millis() - start < _timeout);
+    return -1;
+  }
+
+public:
+  virtual int available(void) = 0;
+  virtual int read(void) = 0;
+  virtual int peek(void) = 0;
+  virtual void flush(void) {}
+
+  void setTimeout(unsigned long timeout) { _timeout = timeout; }
+  unsigned long getTimeout(void) { return _timeout; }
+
+  size_t readBytes(char *buffer, size_t length)
+  {
+    size_t count = 0;
+    while (count < length)
+    {
+      int c = timedRead();
+      if (c < 0)
+        break;
+      *buffer++ = (char)c;
+      count++;
+    }
+    return count;
+  }
+
+  size_t readBytesUntil(char terminator, char *buffer, size_t length)
+  {
+    size_t index = 0;
+    while (index < length)
+    {
+      int c = timedRead();
+      if (c < 0 || c == terminator)
+        break;
+      *buffer++ = (char)c;
+      index++;
+    }
+    return index;
+  }
+};
+
+#endif
@@ -0,0 +1,650 @@
+/******************************************************************************************
+ * File:        astronode_journal.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+
+#include "astronode_journal.h"
+
+ASTRONODE_JOURNAL::ASTRONODE_JOURNAL(ASTRONODE &modem,
+                                     ASTRONODE_NVM &nvm,
+                                     uint32_t address,
+                                     uint16_t size)
+{
+  _modem = &modem;
+  _nvm = &nvm;
+  _address = address;
+  _half_size = size / 2;
+  memset(_entries, 0, sizeof(_entries));
+}
+
+ans_status_e ASTRONODE_JOURNAL::begin(void)
+{
+  _loaded = false;
+  if (_half_size < JOURNAL_HEADER_SIZE + 2 * JOURNAL_RECORD_MAX_SIZE)
+  {
+    return ANS_STATUS_ARG_NOT_VALID;
+  }
+
+  // Active half: committed, with the highest generation
+  uint32_t generation[2];
+  bool valid[2];
+  _max_generation = 0;
+  for (uint8_t h = 0; h < 2; h++)
+  {
+    valid[h] = header_read(h, &generation[h]);
+    if (valid[h] && generation[h] > _max_generation)
+    {
+      _max_generation = generation[h];
+    }
+  }
+  uint8_t first = (valid[1] && (!valid[0] || generation[1] > generation[0])) ? 1 : 0;
+  for (uint8_t k = 0; k < 2 && !_loaded; k++)
+  {
+    uint8_t h = first ^ k;
+    if (valid[h])
+    {
+      _loaded = scan(h, generation[h]);
+    }
+  }
+
+  if (!_loaded)
+  {
+    // Empty journal (or none committed): start a new one
+    memset(_entries, 0, sizeof(_entries));
+    _seq = 0;
+    _module_seq = 0;
+    _half = 1;
+    if (!compact())
+    {
+      return ANS_STATUS_HW_ERR;
+    }
+    _loaded = true;
+  }
+
+  ans_status_e ret_val = _modem->read_module_state();
+  if (ret_val != ANS_STATUS_SUCCESS)
+  {
+    return ret_val;
+  }
+
+  // Module uptime lower than when a payload was queued: the module was reset
+  bool module_reset = false;
+  for (uint8_t i = 0; i < ASTRONODE_JOURNAL_ENTRIES; i++)
+  {
+    if (_entries[i].state == JOURNAL_ENTRY_QUEUED && _entries[i].uptime > _modem->mst_struct.uptime)
+    {
+      module_reset = true;
+    }
+  }
+  if (module_reset)
+  {
+    // The module queue is kept across a reset: the newest msg_in_queue payloads are still queued. The older ones
+    // were sent before the reset, or lost with the queue (e.g. cleared): enqueued again.
+    uint8_t queued = queued_count();
+    while (queued > _modem->mst_struct.msg_in_queue)
+    {
+      _entries[oldest_queued()].state = JOURNAL_ENTRY_PENDING;
+      queued--;
+    }
+    for (uint8_t i = 0; i < ASTRONODE_JOURNAL_ENTRIES; i++)
+    {
+      if (_entries[i].state == JOURNAL_ENTRY_QUEUED)
+      {
+        _entries[i].uptime = _modem->mst_struct.uptime; // Queued since the reset, as far as the next one is concerned
+      }
+    }
+    if (!compact()) // Rewrites the QUEUED records
+    {
+      return ANS_STATUS_HW_ERR;
+    }
+  }
+
+  return reconcile();
+}
+
+ans_status_e ASTRONODE_JOURNAL::enqueue_payload(uint8_t *data,
+                                                uint8_t length,
+                                                uint16_t id)
+{
+  if (!_loaded)
+  {
+    return ANS_STATUS_HW_ERR;
+  }
+  if (length > ASN_MAX_MSG_SIZE)
+  {
+    return ANS_STATUS_PAYLOAD_TOO_LONG;
+  }
+  if (find(id) >= 0)
+  {
+    return ANS_STATUS_DUPLICATE_ID;
+  }
+  int8_t i = -1;
+  for (uint8_t k = 0; k < ASTRONODE_JOURNAL_ENTRIES; k++)
+  {
+    if (_entries[k].state == JOURNAL_ENTRY_FREE)
+    {
+      i = k;
+      break;
+    }
+  }
+  if (i < 0)
+  {
+    return ANS_STATUS_BUFFER_FULL;
+  }
+
+  // Journaled before being sent to the module
+  uint8_t body[1 + ASN_MAX_MSG_SIZE];
+  body[0] = length;
+  memcpy(&body[1], data, length);
+  uint16_t offset;
+  if (!append(JOURNAL_REC_PAYLOAD, id, body, 1 + length, &offset))
+  {
+    return ANS_STATUS_HW_ERR;
+  }
+  _entries[i].state = JOURNAL_ENTRY_PENDING;
+  _entries[i].id = id;
+  _entries[i].length = length;
+  _entries[i].offset = offset;
+  _entries[i].seq = _seq++;
+
+  // Current module uptime for the QUEUED record: the one of the last service() may be far behind, and a module reset
+  // after the uptime passed it would not be seen by begin()
+  ans_status_e ret_val = _modem->read_module_state();
+  if (ret_val == ANS_STATUS_SUCCESS)
+  {
+    ret_val = fill();
+  }
+  if (ret_val == ANS_STATUS_SUCCESS && _entries[i].state == JOURNAL_ENTRY_PENDING)
+  {
+    ret_val = ANS_STATUS_PENDING;
+  }
+  return ret_val;
+}
+
+ans_status_e ASTRONODE_JOURNAL::acknowledged(uint16_t id)
+{
+  int8_t i = find(id);
+  if (i < 0)
+  {
+    return ANS_STATUS_ARG_NOT_VALID;
+  }
+  return release(i) ? ANS_STATUS_SUCCESS : ANS_STATUS_HW_ERR;
+}
+
+ans_status_e ASTRONODE_JOURNAL::service(void)
+{
+  if (!_loaded)
+  {
+    return ANS_STATUS_HW_ERR;
+  }
+  ans_status_e ret_val = _modem->read_module_state();
+  if (ret_val != ANS_STATUS_SUCCESS)
+  {
+    return ret_val;
+  }
+  return reconcile();
+}
+
+ans_status_e ASTRONODE_JOURNAL::reconcile(void)
+{
+  // Payloads leave the module queue in order: release the oldest ones
+  uint8_t queued = queued_count();
+  while (queued > _modem->mst_struct.msg_in_queue)
+  {
+    if (!release(oldest_queued()))
+    {
+      return ANS_STATUS_HW_ERR;
+    }
+    queued--;
+  }
+  return fill();
+}
+
+ans_status_e ASTRONODE_JOURNAL::fill(void)
+{
+  // Enqueue pending payloads in journal order, as long as the module accepts them
+  uint8_t record[JOURNAL_RECORD_MAX_SIZE];
+  while (true)
+  {
+    int8_t i = next_pending();
+    if (i < 0)
+    {
+      return ANS_STATUS_SUCCESS;
+    }
+    if (!payload_read(i, record))
+    {
+      return ANS_STATUS_HW_ERR;
+    }
+
+    ASTRONODE_JOURNAL_ENTRY *e = &_entries[i];
+    ans_status_e ret_val = _modem->enqueue_payload(&record[4], e->length, e->id);
+    if (ret_val == ANS_STATUS_BUFFER_FULL)
+    {
+      return ANS_STATUS_SUCCESS; // Wait for room
+    }
+    // Duplicate: already in the module queue (queued before an asset or module reset, QUEUED record not written)
+    if (ret_val != ANS_STATUS_SUCCESS && ret_val != ANS_STATUS_DUPLICATE_ID)
+    {
+      return ret_val;
+    }
+
+    uint32_t uptime = _modem->mst_struct.uptime; // Read before the enqueue, not later than it
+    uint8_t body[4];
+    memcpy(body, &uptime, sizeof(uptime));
+    if (!append(JOURNAL_REC_QUEUED, e->id, body, sizeof(body)))
+    {
+      return ANS_STATUS_HW_ERR;
+    }
+    e->state = JOURNAL_ENTRY_QUEUED;
+    e->module_seq = _module_seq++;
+    e->uptime = uptime;
+  }
+}
+
+bool ASTRONODE_JOURNAL::release(int8_t i)
+{
+  if (!append(JOURNAL_REC_DONE, _entries[i].id, NULL, 0))
+  {
+    return false;
+  }
+  _entries[i].state = JOURNAL_ENTRY_FREE;
+  return true;
+}
+
+uint16_t ASTRONODE_JOURNAL::record_crc(const uint8_t *record,
+                                       uint16_t length,
+                                       uint32_t generation)
+{
+  return ASTRONODE_NVM::crc(record, length, 0xFFFF ^ (uint16_t)generation ^ (uint16_t)(generation >> 16));
+}
+
+bool ASTRONODE_JOURNAL::header_read(uint8_t half,
+                                    uint32_t *generation)
+{
+  uint8_t header[JOURNAL_HEADER_SIZE];
+  if (!_nvm->read(half_address(half), header, sizeof(header)))
+  {
+    return false;
+  }
+  uint16_t magic = header[0] | (header[1] << 8);
+  uint16_t crc = header[6] | (header[7] << 8);
+  memcpy(generation, &header[2], sizeof(*generation));
+  return magic == JOURNAL_MAGIC && crc == ASTRONODE_NVM::crc(header, 6) && *generation != 0;
+}
+
+bool ASTRONODE_JOURNAL::header_write(uint8_t half,
+                                     uint32_t generation)
+{
+  uint8_t header[JOURNAL_HEADER_SIZE];
+  header[0] = JOURNAL_MAGIC & 0xFF;
+  header[1] = JOURNAL_MAGIC >> 8;
+  memcpy(&header[2], &generation, sizeof(generation));
+  uint16_t crc = ASTRONODE_NVM::crc(header, 6);
+  header[6] = crc & 0xFF;
+  header[7] = crc >> 8;
+  _bytes_written += sizeof(header);
+  return _nvm->write(half_address(half), header, sizeof(header));
+}
+
+bool ASTRONODE_JOURNAL::scan(uint8_t half,
+                             uint32_t generation)
+{
+  memset(_entries, 0, sizeof(_entries));
+  _seq = 0;
+  _module_seq = 0;
+
+  // Apply the records up to the first one not valid (end of the log, or torn write)
+  bool committed = false;
+  uint8_t record[JOURNAL_RECORD_MAX_SIZE];
+  uint16_t offset = JOURNAL_HEADER_SIZE;
+  while (offset + JOURNAL_RECORD_OVERHEAD <= _half_size)
+  {
+    if (!_nvm->read(half_address(half) + offset, record, 4))
+    {
+      break; // Storage end (e.g. file never written that far)
+    }
+    uint16_t length = JOURNAL_RECORD_OVERHEAD;
+    if (record[0] == JOURNAL_REC_PAYLOAD)
+    {
+      length += 1 + record[3];
+    }
+    else if (record[0] == JOURNAL_REC_QUEUED)
+    {
+      length += 4;
+    }
+    else if (record[0] != JOURNAL_REC_COMMIT && record[0] != JOURNAL_REC_DONE)
+    {
+      break;
+    }
+    if (length > JOURNAL_RECORD_MAX_SIZE || offset + length > _half_size ||
+        !_nvm->read(half_address(half) + offset, record, length))
+    {
+      break;
+    }
+    uint16_t crc = record[length - 2] | (record[length - 1] << 8);
+    if (crc != record_crc(record, length - 2, generation))
+    {
+      break;
+    }
+
+    if (record[0] == JOURNAL_REC_COMMIT)
+    {
+      committed = true;
+    }
+    else
+    {
+      apply(record, offset);
+    }
+    offset += length;
+  }
+
+  _half = half;
+  _generation = generation;
+  _end = offset;
+  return committed;
+}
+
+void ASTRONODE_JOURNAL::apply(const uint8_t *record,
+                              uint16_t offset)
+{
+  uint16_t id = record[1] | (record[2] << 8);
+  int8_t i = find(id);
+
+  switch (record[0])
+  {
+  case JOURNAL_REC_PAYLOAD:
+    if (i < 0)
+    {
+      for (uint8_t k = 0; k < ASTRONODE_JOURNAL_ENTRIES; k++)
+      {
+        if (_entries[k].state == JOURNAL_ENTRY_FREE)
+        {
+          i = k;
+          break;
+        }
+      }
+    }
+    if (i >= 0)
+    {
+      _entries[i].state = JOURNAL_ENTRY_PENDING;
+      _entries[i].id = id;
+      _entries[i].length = record[3];
+      _entries[i].offset = offset;
+      _entries[i].seq = _seq++;
+    }
+    break;
+  case JOURNAL_REC_QUEUED:
+    if (i >= 0)
+    {
+      _entries[i].state = JOURNAL_ENTRY_QUEUED;
+      _entries[i].module_seq = _module_seq++;
+      memcpy(&_entries[i].uptime, &record[3], sizeof(_entries[i].uptime));
+    }
+    break;
+  case JOURNAL_REC_DONE:
+    if (i >= 0)
+    {
+      _entries[i].state = JOURNAL_ENTRY_FREE;
+    }
+    break;
+  }
+}
+
+bool ASTRONODE_JOURNAL::record_write(uint8_t half,
+                                     uint16_t offset,
+                                     uint32_t generation,
+                                     uint8_t *record,
+                                     uint16_t length)
+{
+  uint16_t crc = record_crc(record, length - 2, generation);
+  record[length - 2] = crc & 0xFF;
+  record[length - 1] = crc >> 8;
+  _bytes_written += length;
+  return _nvm->write(half_address(half) + offset, record, length);
+}
+
+bool ASTRONODE_JOURNAL::append(uint8_t type,
+                               uint16_t id,
+                               const uint8_t *body,
+                               uint8_t body_length,
+                               uint16_t *offset)
+{
+  uint16_t length = JOURNAL_RECORD_OVERHEAD + body_length;
+  if (_end + length > _half_size)
+  {
+    // Active half full: copy the live entries to the other half
+    if (!compact() || _end + length > _half_size)
+    {
+      return false;
+    }
+  }
+
+  uint8_t record[JOURNAL_RECORD_MAX_SIZE];
+  record[0] = type;
+  record[1] = id & 0xFF;
+  record[2] = id >> 8;
+  if (body_length > 0)
+  {
+    memcpy(&record[3], body, body_length);
+  }
+  if (!record_write(_half, _end, _generation, record, length))
+  {
+    return false;
+  }
+  if (offset != NULL)
+  {
+    *offset = _end;
+  }
+  _end += length;
+  return true;
+}
+
+bool ASTRONODE_JOURNAL::payload_read(int8_t i,
+                                     uint8_t *record)
+{
+  return _nvm->read(half_address(_half) + _entries[i].offset,
+                    record,
+                    JOURNAL_RECORD_OVERHEAD + 1 + _entries[i].length);
+}
+
+bool ASTRONODE_JOURNAL::compact(void)
+{
+  uint8_t half = _half ^ 1;
+  uint32_t generation = ++_max_generation; // Never reuse the generation of an uncommitted copy
+  if (!header_write(half, generation))
+  {
+    return false;
+  }
+
+  // Payloads in journal order, then the QUEUED records in module queue order. Both orders are renumbered from 0,
+  // as scan() does when the copy is loaded.
+  uint8_t record[JOURNAL_RECORD_MAX_SIZE];
+  uint16_t offsets[ASTRONODE_JOURNAL_ENTRIES] = {}; // Applied once committed
+  uint8_t order[ASTRONODE_JOURNAL_ENTRIES];
+  uint8_t module_order[ASTRONODE_JOURNAL_ENTRIES];
+  memset(order, 0xFF, sizeof(order));
+  memset(module_order, 0xFF, sizeof(module_order));
+  uint16_t offset = JOURNAL_HEADER_SIZE;
+  uint8_t count = 0;
+  while (true)
+  {
+    int8_t next = -1;
+    for (uint8_t i = 0; i < ASTRONODE_JOURNAL_ENTRIES; i++)
+    {
+      if (_entries[i].state != JOURNAL_ENTRY_FREE && order[i] == 0xFF &&
+          (next < 0 || (int16_t)(_entries[i].seq - _entries[next].seq) < 0))
+      {
+        next = i;
+      }
+    }
+    if (next < 0)
+    {
+      break;
+    }
+    order[next] = count++;
+
+    uint16_t length = JOURNAL_RECORD_OVERHEAD + 1 + _entries[next].length;
+    if (offset + length > _half_size ||
+        !payload_read(next, record) ||
+        !record_write(half, offset, generation, record, length))
+    {
+      return false;
+    }
+    offsets[next] = offset;
+    offset += length;
+  }
+
+  uint8_t module_count = 0;
+  while (true)
+  {
+    int8_t next = -1;
+    for (uint8_t i = 0; i < ASTRONODE_JOURNAL_ENTRIES; i++)
+    {
+      if (_entries[i].state == JOURNAL_ENTRY_QUEUED && module_order[i] == 0xFF &&
+          (next < 0 || (int16_t)(_entries[i].module_seq - _entries[next].module_seq) < 0))
+      {
+        next = i;
+      }
+    }
+    if (next < 0)
+    {
+      break;
+    }
+    module_order[next] = module_count++;
+
+    uint16_t length = JOURNAL_RECORD_OVERHEAD + 4;
+    record[0] = JOURNAL_REC_QUEUED;
+    record[1] = _entries[next].id & 0xFF;
+    record[2] = _entries[next].id >> 8;
+    memcpy(&record[3], &_entries[next].uptime, sizeof(_entries[next].uptime));
+    if (offset + length > _half_size ||
+        !record_write(half, offset, generation, record, length))
+    {
+      return false;
+    }
+    offset += length;
+  }
+
+  record[0] = JOURNAL_REC_COMMIT;
+  record[1] = 0;
+  record[2] = 0;
+  if (offset + JOURNAL_RECORD_OVERHEAD > _half_size ||
+      !record_write(half, offset, generation, record, JOURNAL_RECORD_OVERHEAD))
+  {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < ASTRONODE_JOURNAL_ENTRIES; i++)
+  {
+    if (_entries[i].state != JOURNAL_ENTRY_FREE)
+    {
+      _entries[i].offset = offsets[i];
+      _entries[i].seq = order[i];
+    }
+    if (_entries[i].state == JOURNAL_ENTRY_QUEUED)
+    {
+      _entries[i].module_seq = module_order[i];
+    }
+  }
+  _seq = count;
+  _module_seq = module_count;
+  _half = half;
+  _generation = generation;
+  _end = offset + JOURNAL_RECORD_OVERHEAD;
+  _compactions++;
+  return true;
+}
+
+int8_t ASTRONODE_JOURNAL::find(uint16_t id)
+{
+  for (uint8_t i = 0; i < ASTRONODE_JOURNAL_ENTRIES; i++)
+  {
+    if (_entries[i].state != JOURNAL_ENTRY_FREE && _entries[i].id == id)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int8_t ASTRONODE_JOURNAL::next_pending(void)
+{
+  int8_t best = -1;
+  for (uint8_t i = 0; i < ASTRONODE_JOURNAL_ENTRIES; i++)
+  {
+    if (_entries[i].state == JOURNAL_ENTRY_PENDING &&
+        (best < 0 || (int16_t)(_entries[i].seq - _entries[best].seq) < 0))
+    {
+      best = i;
+    }
+  }
+  return best;
+}
+
+int8_t ASTRONODE_JOURNAL::oldest_queued(void)
+{
+  int8_t head = -1;
+  for (uint8_t i = 0; i < ASTRONODE_JOURNAL_ENTRIES; i++)
+  {
+    if (_entries[i].state == JOURNAL_ENTRY_QUEUED &&
+        (head < 0 || (int16_t)(_entries[i].module_seq - _entries[head].module_seq) < 0))
+    {
+      head = i;
+    }
+  }
+  return head;
+}
+
+uint8_t ASTRONODE_JOURNAL::pending_count(void)
+{
+  uint8_t cnt = 0;
+  for (uint8_t i = 0; i < ASTRONODE_JOURNAL_ENTRIES; i++)
+  {
+    if (_entries[i].state == JOURNAL_ENTRY_PENDING)
+    {
+      cnt++;
+    }
+  }
+  return cnt;
+}
+
+uint8_t ASTRONODE_JOURNAL::queued_count(void)
+{
+  uint8_t cnt = 0;
+  for (uint8_t i = 0; i < ASTRONODE_JOURNAL_ENTRIES; i++)
+  {
+    if (_entries[i].state == JOURNAL_ENTRY_QUEUED)
+    {
+      cnt++;
+    }
+  }
+  return cnt;
+}
+
+uint8_t ASTRONODE_JOURNAL::queued_ids(uint16_t *ids,
+                                      uint8_t max_ids)
+{
+  uint8_t cnt = 0;
+  uint16_t module_seq = 0;
+  while (cnt < max_ids)
+  {
+    int8_t next = -1;
+    for (uint8_t i = 0; i < ASTRONODE_JOURNAL_ENTRIES; i++)
+    {
+      if (_entries[i].state == JOURNAL_ENTRY_QUEUED &&
+          (cnt == 0 || (int16_t)(_entries[i].module_seq - module_seq) >= 0) &&
+          (next < 0 || (int16_t)(_entries[i].module_seq - _entries[next].module_seq) < 0))
+      {
+        next = i;
+      }
+    }
+    if (next < 0)
+    {
+      break;
+    }
+    module_seq = _entries[next].module_seq + 1;
+    ids[cnt++] = _entries[next].id;
+  }
+  return cnt;
+}
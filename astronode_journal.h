@@ -0,0 +1,154 @@
+/******************************************************************************************
+ * File:        astronode_journal.h
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * Power-loss safe uplink journal on an ASTRONODE_NVM region (EEPROM, flash, FRAM, file).
+ * Each payload is written to the journal before it is enqueued in the module, so payloads
+ * not enqueued yet survive an asset reset, and the payload IDs queued in the module are
+ * known after it.
+ *
+ * The region is split in two halves, used one at a time as an append-only log:
+ *   [header: magic u16, generation u32, crc u16]
+ *   records: [type u8][id u16][body][crc u16]
+ *     JOURNAL_REC_COMMIT   end of the copy of the live entries (no id, no body)
+ *     JOURNAL_REC_PAYLOAD  payload to send: [length u8][data]
+ *     JOURNAL_REC_QUEUED   payload enqueued in the module: [module uptime u32]
+ *     JOURNAL_REC_DONE     payload left the module queue (acknowledged)
+ * Record CRCs are seeded with the generation, so records of a previous use of the half are
+ * not valid. When a half is full, the live entries are copied to the other one under a new
+ * generation: header first, records, then COMMIT. A half is only used once committed, the
+ * committed half with the highest generation is the active one. Each byte is written once
+ * per generation and the halves alternate; recovery reads at most both halves. A half must
+ * hold the copy of the live payloads (up to 15 + length bytes each), larger halves are
+ * copied less often.
+ *
+ * begin() reconciles the journal with the module queue (MST): queued payloads beyond
+ * msg_in_queue left the queue (oldest first) and are done. If the module uptime is lower
+ * than at the time a payload was queued, the module was reset. Its queue is kept across
+ * the reset, so the newest msg_in_queue payloads stay queued; the older ones may have been
+ * sent or lost with the queue and are enqueued again. A payload enqueued again while it is
+ * still in the module queue is answered with DUPLICATE_ID and taken as queued. Delivery is
+ * at least once.
+ ****************************************************************************************/
+
+#ifndef _ASTRONODE_JOURNAL_h
+#define _ASTRONODE_JOURNAL_h
+
+#include "astronode.h"
+#include "astronode_nvm.h"
+
+#define ASTRONODE_JOURNAL_ENTRIES (ASN_MSG_QUEUE_SIZE + 8) // Payloads queued in the module and pending
+
+#define JOURNAL_MAGIC 0x4A41 // "AJ"
+#define JOURNAL_HEADER_SIZE 8
+#define JOURNAL_RECORD_OVERHEAD 5 // type, id, crc
+#define JOURNAL_RECORD_MAX_SIZE (JOURNAL_RECORD_OVERHEAD + 1 + ASN_MAX_MSG_SIZE)
+
+// Record types
+#define JOURNAL_REC_COMMIT 0x01
+#define JOURNAL_REC_PAYLOAD 0x02
+#define JOURNAL_REC_QUEUED 0x03
+#define JOURNAL_REC_DONE 0x04
+
+// Entry states
+#define JOURNAL_ENTRY_FREE 0
+#define JOURNAL_ENTRY_PENDING 1 // Not enqueued in the module yet
+#define JOURNAL_ENTRY_QUEUED 2
+
+class ASTRONODE_JOURNAL
+{
+
+private:
+  typedef struct
+  {
+    uint8_t state; // JOURNAL_ENTRY_*
+    uint16_t id;
+    uint8_t length;
+    uint16_t offset;     // PAYLOAD record in the active half
+    uint16_t seq;        // Journal order
+    uint16_t module_seq; // Order in the module queue
+    uint32_t uptime;     // Module uptime when enqueued [s]
+  } ASTRONODE_JOURNAL_ENTRY;
+
+  ASTRONODE *_modem;
+  ASTRONODE_NVM *_nvm;
+  uint32_t _address;
+  uint16_t _half_size;
+
+  uint8_t _half = 0;
+  uint32_t _generation = 0;
+  uint32_t _max_generation = 0; // Highest generation seen, committed or not
+  uint16_t _end = 0;            // Next record offset in the active half
+  bool _loaded = false;
+
+  ASTRONODE_JOURNAL_ENTRY _entries[ASTRONODE_JOURNAL_ENTRIES];
+  uint16_t _seq = 0;
+  uint16_t _module_seq = 0;
+
+  uint16_t _compactions = 0;
+  uint32_t _bytes_written = 0;
+
+  uint32_t half_address(uint8_t half) { return _address + (uint32_t)half * _half_size; }
+  uint16_t record_crc(const uint8_t *record,
+                      uint16_t length,
+                      uint32_t generation);
+  bool header_read(uint8_t half,
+                   uint32_t *generation);
+  bool header_write(uint8_t half,
+                    uint32_t generation);
+  bool scan(uint8_t half,
+            uint32_t generation);
+  void apply(const uint8_t *record,
+             uint16_t offset);
+  bool record_write(uint8_t half,
+                    uint16_t offset,
+                    uint32_t generation,
+                    uint8_t *record,
+                    uint16_t length);
+  bool append(uint8_t type,
+              uint16_t id,
+              const uint8_t *body,
+              uint8_t body_length,
+              uint16_t *offset = NULL);
+  bool payload_read(int8_t i,
+                    uint8_t *record);
+  bool compact(void);
+  bool release(int8_t i);
+  ans_status_e reconcile(void);
+
+  int8_t find(uint16_t id);
+  int8_t next_pending(void);
+  int8_t oldest_queued(void);
+  ans_status_e fill(void);
+
+public:
+  // size: bytes of nvm used from address, split in two halves
+  ASTRONODE_JOURNAL(ASTRONODE &modem,
+                    ASTRONODE_NVM &nvm,
+                    uint32_t address,
+                    uint16_t size);
+
+  // Load the journal and reconcile it with the module queue. Call after ASTRONODE::begin().
+  ans_status_e begin(void);
+
+  // ANS_STATUS_SUCCESS once the payload is enqueued in the module, ANS_STATUS_PENDING if it waits for room. Reads
+  // the module state first, for the uptime of the QUEUED record.
+  ans_status_e enqueue_payload(uint8_t *data,
+                               uint8_t length,
+                               uint16_t id);
+  // Payload acknowledged by the satellite (read_satellite_ack())
+  ans_status_e acknowledged(uint16_t id);
+  // Release the payloads which left the module queue and enqueue the pending ones
+  ans_status_e service(void);
+
+  uint8_t pending_count(void);
+  uint8_t queued_count(void);
+  uint8_t queued_ids(uint16_t *ids,
+                     uint8_t max_ids); // IDs in the module queue, oldest first
+  uint16_t compactions(void) { return _compactions; }
+  uint32_t bytes_written(void) { return _bytes_written; }
+};
+
+#endif
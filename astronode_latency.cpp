@@ -0,0 +1,216 @@
+/******************************************************************************************
+ * File:        astronode_latency.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+
+#include "astronode_latency.h"
+
+// Upper bound of each bin [s]
+static const uint32_t latency_bins[ASTRONODE_LATENCY_BINS] PROGMEM = {
+    60, 120, 300, 600, 1200, 1800, 3600, 7200,
+    14400, 28800, 43200, 86400, 172800, 345600, 604800, 0xFFFFFFFF};
+
+int8_t ASTRONODE_LATENCY::find(uint16_t id)
+{
+  for (uint8_t i = 0; i < ASTRONODE_LATENCY_SLOTS; i++)
+  {
+    if (_slots[i].state != LATENCY_SLOT_FREE && _slots[i].id == id)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int8_t ASTRONODE_LATENCY::allocate(uint32_t now)
+{
+  // Free slot first, then the oldest dequeued one, then the oldest queued one
+  int8_t dequeued = -1;
+  int8_t queued = -1;
+  for (uint8_t i = 0; i < ASTRONODE_LATENCY_SLOTS; i++)
+  {
+    if (_slots[i].state == LATENCY_SLOT_FREE)
+    {
+      return i;
+    }
+    if (_slots[i].state == LATENCY_SLOT_DEQUEUED)
+    {
+      if (dequeued < 0 || now - _slots[i].enqueued > now - _slots[dequeued].enqueued)
+      {
+        dequeued = i;
+      }
+    }
+    else if (queued < 0 || now - _slots[i].enqueued > now - _slots[queued].enqueued)
+    {
+      queued = i;
+    }
+  }
+  if (dequeued >= 0)
+  {
+    return dequeued;
+  }
+  if (_lost_cnt < 0xFFFF)
+  {
+    _lost_cnt++;
+  }
+  return queued;
+}
+
+void ASTRONODE_LATENCY::enqueued(uint16_t id,
+                                 uint32_t now)
+{
+  int8_t index = find(id);
+  if (index >= 0 && _slots[index].state == LATENCY_SLOT_DISPLACED)
+  {
+    // Enqueued again by the library: same payload, same enqueue time
+    _slots[index].state = LATENCY_SLOT_QUEUED;
+    return;
+  }
+  if (index < 0) // Otherwise a new payload reusing the id
+  {
+    index = allocate(now);
+  }
+  _slots[index].state = LATENCY_SLOT_QUEUED;
+  _slots[index].id = id;
+  _slots[index].enqueued = now;
+}
+
+void ASTRONODE_LATENCY::acked(uint16_t id,
+                              uint32_t now)
+{
+  int8_t index = find(id);
+  if (index < 0 || (_slots[index].state != LATENCY_SLOT_QUEUED && _slots[index].state != LATENCY_SLOT_DISPLACED))
+  {
+    return; // Not tracked, or ack read again before being cleared
+  }
+  _slots[index].state = LATENCY_SLOT_FREE;
+
+  uint32_t latency = (now - _slots[index].enqueued) / 1000;
+  uint8_t bin = 0;
+  while (bin < ASTRONODE_LATENCY_BINS - 1 && latency > pgm_read_dword(&latency_bins[bin]))
+  {
+    bin++;
+  }
+  if (_hist[bin] < 0xFFFF)
+  {
+    _hist[bin]++;
+  }
+  if (_acked_cnt < 0xFFFF)
+  {
+    _acked_cnt++;
+  }
+  if (latency > _max)
+  {
+    _max = latency;
+  }
+}
+
+void ASTRONODE_LATENCY::dequeued(uint16_t id,
+                                 bool requeue)
+{
+  int8_t index = find(id);
+  if (index < 0 || _slots[index].state != LATENCY_SLOT_QUEUED)
+  {
+    return;
+  }
+  if (requeue)
+  {
+    _slots[index].state = LATENCY_SLOT_DISPLACED;
+  }
+  else
+  {
+    _slots[index].state = LATENCY_SLOT_DEQUEUED;
+    if (_unacked_cnt < 0xFFFF)
+    {
+      _unacked_cnt++;
+    }
+  }
+}
+
+void ASTRONODE_LATENCY::cleared(void)
+{
+  for (uint8_t i = 0; i < ASTRONODE_LATENCY_SLOTS; i++)
+  {
+    if (_slots[i].state == LATENCY_SLOT_QUEUED)
+    {
+      dequeued(_slots[i].id);
+    }
+  }
+}
+
+void ASTRONODE_LATENCY::clear(void)
+{
+  memset(_hist, 0, sizeof(_hist));
+  _acked_cnt = 0;
+  _unacked_cnt = 0;
+  _lost_cnt = 0;
+  _max = 0;
+}
+
+uint8_t ASTRONODE_LATENCY::in_flight(void)
+{
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < ASTRONODE_LATENCY_SLOTS; i++)
+  {
+    if (_slots[i].state == LATENCY_SLOT_QUEUED || _slots[i].state == LATENCY_SLOT_DISPLACED)
+    {
+      count++;
+    }
+  }
+  return count;
+}
+
+uint32_t ASTRONODE_LATENCY::bin_bound(uint8_t bin)
+{
+  return (bin < ASTRONODE_LATENCY_BINS) ? pgm_read_dword(&latency_bins[bin]) : 0;
+}
+
+uint32_t ASTRONODE_LATENCY::percentile(uint8_t percent)
+{
+  uint32_t total = 0;
+  for (uint8_t i = 0; i < ASTRONODE_LATENCY_BINS; i++)
+  {
+    total += _hist[i];
+  }
+
+  uint32_t cumulated = 0;
+  for (uint8_t i = 0; i < ASTRONODE_LATENCY_BINS; i++)
+  {
+    cumulated += _hist[i];
+    if (total > 0 && cumulated * 100 >= total * percent)
+    {
+      // The open-ended bin is bounded by the maximum seen
+      return (i == ASTRONODE_LATENCY_BINS - 1) ? _max : pgm_read_dword(&latency_bins[i]);
+    }
+  }
+  return 0;
+}
+
+uint8_t ASTRONODE_LATENCY::serialize(uint8_t *buffer,
+                                     uint8_t length)
+{
+  if (length < ASTRONODE_LATENCY_SERIALIZED_SIZE)
+  {
+    return 0;
+  }
+
+  uint8_t index = 0;
+  buffer[index++] = ASTRONODE_LATENCY_FORMAT;
+  buffer[index++] = (uint8_t)_acked_cnt;
+  buffer[index++] = (uint8_t)(_acked_cnt >> 8);
+  buffer[index++] = (uint8_t)_unacked_cnt;
+  buffer[index++] = (uint8_t)(_unacked_cnt >> 8);
+  buffer[index++] = (uint8_t)_lost_cnt;
+  buffer[index++] = (uint8_t)(_lost_cnt >> 8);
+  buffer[index++] = (uint8_t)_max;
+  buffer[index++] = (uint8_t)(_max >> 8);
+  buffer[index++] = (uint8_t)(_max >> 16);
+  buffer[index++] = (uint8_t)(_max >> 24);
+  for (uint8_t i = 0; i < ASTRONODE_LATENCY_BINS; i++)
+  {
+    buffer[index++] = (uint8_t)_hist[i];
+    buffer[index++] = (uint8_t)(_hist[i] >> 8);
+  }
+  return index;
+}
@@ -0,0 +1,81 @@
+/******************************************************************************************
+ * File:        astronode_latency.h
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * Delivery latency from enqueue_payload() to the satellite ack read with read_satellite_ack(),
+ * enabled with ASTRONODE::enableLatencyTracking(). Latencies are counted in a fixed histogram
+ * (bins from 1 min to 1 week, the last one open-ended), payloads dequeued or cleared before
+ * their ack are counted as unacked. A payload dequeued by the library to be enqueued again
+ * with the same id (ASTRONODE_UPLINK preemption and supersede) keeps its first enqueue time
+ * and is not counted unacked. An id enqueued again after any other dequeue is a new payload.
+ * Only the blocking ASTRONODE calls are tracked: payloads enqueued and acks read through
+ * async_request() (ASTRONODE_MANAGER, ASTRONODE_CORO) are not.
+ *
+ * Binary form (serialize(), ASTRONODE_LATENCY_SERIALIZED_SIZE bytes, little endian):
+ *   [format 0x01][acked u16][unacked u16][lost u16][max s u32][ASTRONODE_LATENCY_BINS x count u16]
+ ****************************************************************************************/
+
+#ifndef _ASTRONODE_LATENCY_h
+#define _ASTRONODE_LATENCY_h
+
+#include "astronode.h"
+
+#define ASTRONODE_LATENCY_SLOTS (ASN_MSG_QUEUE_SIZE + 4) // Payloads tracked between enqueue and ack
+#define ASTRONODE_LATENCY_BINS 16
+#define ASTRONODE_LATENCY_FORMAT 0x01
+#define ASTRONODE_LATENCY_SERIALIZED_SIZE (1 + 2 + 2 + 2 + 4 + 2 * ASTRONODE_LATENCY_BINS)
+
+#define LATENCY_SLOT_FREE 0
+#define LATENCY_SLOT_QUEUED 1
+#define LATENCY_SLOT_DEQUEUED 2  // Dequeued before its ack, slot reused first
+#define LATENCY_SLOT_DISPLACED 3 // Dequeued to be enqueued again with the same id
+
+class ASTRONODE_LATENCY
+{
+
+private:
+  typedef struct
+  {
+    uint8_t state; // LATENCY_SLOT_*
+    uint16_t id;
+    uint32_t enqueued; // millis()
+  } ASTRONODE_LATENCY_SLOT;
+
+  ASTRONODE_LATENCY_SLOT _slots[ASTRONODE_LATENCY_SLOTS] = {};
+  uint16_t _hist[ASTRONODE_LATENCY_BINS] = {};
+  uint16_t _acked_cnt = 0;
+  uint16_t _unacked_cnt = 0; // Dequeued or cleared before their ack
+  uint16_t _lost_cnt = 0;    // Evicted from the table before their ack (e.g. module reset)
+  uint32_t _max = 0;
+
+  int8_t find(uint16_t id);
+  int8_t allocate(uint32_t now);
+
+public:
+  // Called by ASTRONODE on successful requests
+  void enqueued(uint16_t id,
+                uint32_t now);
+  void acked(uint16_t id,
+             uint32_t now);
+  void dequeued(uint16_t id,
+                bool requeue = false);
+  void cleared(void);
+
+  void clear(void); // Statistics only, payloads in flight stay tracked
+
+  uint16_t acked_count(void) { return _acked_cnt; }
+  uint16_t unacked_count(void) { return _unacked_cnt; }
+  uint16_t lost_count(void) { return _lost_cnt; }
+  uint8_t in_flight(void);
+  uint16_t histogram(uint8_t bin) { return (bin < ASTRONODE_LATENCY_BINS) ? _hist[bin] : 0; }
+  uint32_t bin_bound(uint8_t bin); // Upper bound [s] of a bin, 0xFFFFFFFF for the last one
+  uint32_t percentile(uint8_t percent); // Upper bound [s] of the bin reached by percent of the acked payloads
+  uint32_t max(void) { return _max; }  // s
+
+  uint8_t serialize(uint8_t *buffer,
+                    uint8_t length); // Bytes written, 0 if buffer too small
+};
+
+#endif
@@ -0,0 +1,151 @@
+/******************************************************************************************
+ * File:        astronode_linktest.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+
+#include "astronode_linktest.h"
+
+ans_status_e ASTRONODE_LINK_TEST::start(unsigned long duration,
+                                        uint8_t transmissions,
+                                        unsigned long tx_interval)
+{
+  // Baselines
+  ans_status_e ret_val = _modem->read_performance_counter();
+  if (ret_val == ANS_STATUS_SUCCESS)
+  {
+    ret_val = _modem->read_last_contact_details();
+  }
+  if (ret_val != ANS_STATUS_SUCCESS)
+  {
+    return ret_val;
+  }
+
+  memset(&_summary, 0, sizeof(_summary));
+  _per_start = _modem->per_struct;
+  _last_contact_end = _modem->lcd_struct.time_end_last_contact;
+  _duration = duration;
+  _transmissions = transmissions;
+  _tx_interval = tx_interval;
+  _start = millis();
+  _last_sample = _start;
+  _running = true;
+
+  return poll();
+}
+
+ans_status_e ASTRONODE_LINK_TEST::poll(void)
+{
+  if (!_running)
+  {
+    return ANS_STATUS_SUCCESS;
+  }
+
+  unsigned long now = millis();
+  ans_status_e ret_val;
+
+  // Test transmissions
+  if (!_summary.max_tx_reached &&
+      _summary.tx_requested < _transmissions &&
+      (_summary.tx_requested == 0 || now - _last_tx >= _tx_interval))
+  {
+    _summary.tx_requested++;
+    _last_tx = now;
+    ret_val = _modem->test_transmit_start();
+    if (ret_val == ANS_STATUS_SUCCESS)
+    {
+      _summary.tx_started++;
+    }
+    else if (ret_val == ANS_STATUS_MAX_TX_REACHED)
+    {
+      _summary.max_tx_reached = true;
+    }
+    else
+    {
+      _running = false;
+      return ret_val;
+    }
+  }
+
+  if (now - _last_sample >= LINK_TEST_SAMPLE_PERIOD)
+  {
+    _last_sample = now;
+    ret_val = sample();
+    if (ret_val != ANS_STATUS_SUCCESS)
+    {
+      _running = false;
+      return ret_val;
+    }
+  }
+
+  if (now - _start >= _duration)
+  {
+    _running = false;
+    return finish();
+  }
+  return ANS_STATUS_PENDING;
+}
+
+ans_status_e ASTRONODE_LINK_TEST::sample(void)
+{
+  ans_status_e ret_val = _modem->read_environment_details();
+  if (ret_val == ANS_STATUS_SUCCESS)
+  {
+    ret_val = _modem->read_last_contact_details();
+  }
+  if (ret_val != ANS_STATUS_SUCCESS)
+  {
+    return ret_val;
+  }
+
+  uint8_t rssi = _modem->end_struct.last_sat_search_peak_rssi;
+  _summary.samples++;
+  if (rssi >= LINK_TEST_RSSI_DETECT)
+  {
+    _summary.detections++;
+  }
+  if (rssi > _summary.peak_search_rssi)
+  {
+    _summary.peak_search_rssi = rssi;
+  }
+
+  // New contact: the end of the last contact increases (it goes back to 0 after a module reset)
+  if (_modem->lcd_struct.time_end_last_contact > _last_contact_end)
+  {
+    _summary.contacts++;
+    if (_modem->lcd_struct.peak_rssi_last_contact > _summary.peak_contact_rssi)
+    {
+      _summary.peak_contact_rssi = _modem->lcd_struct.peak_rssi_last_contact;
+    }
+  }
+  _last_contact_end = _modem->lcd_struct.time_end_last_contact;
+  return ANS_STATUS_SUCCESS;
+}
+
+ans_status_e ASTRONODE_LINK_TEST::finish(void)
+{
+  ans_status_e ret_val = sample();
+  if (ret_val == ANS_STATUS_SUCCESS)
+  {
+    ret_val = _modem->read_performance_counter();
+  }
+  if (ret_val != ANS_STATUS_SUCCESS)
+  {
+    return ret_val;
+  }
+
+  _summary.duration = millis() - _start;
+  _summary.sat_detect_cnt = per_delta(PER_TYPE_SAT_DETECT_OPERATION_CNT);
+  _summary.signal_demod_attempts = per_delta(PER_TYPE_SIGNAL_DEMOD_ATTEMPS_CNT);
+  _summary.signal_demod_success = per_delta(PER_TYPE_SIGNAL_DEMOD_SUCCESS_CNT);
+  _summary.ack_demod_attempts = per_delta(PER_TYPE_ACK_DEMOD_ATTEMPT_CNT);
+  _summary.ack_demod_success = per_delta(PER_TYPE_ACK_DEMOD_SUCCESS_CNT);
+  return ANS_STATUS_SUCCESS;
+}
+
+uint32_t ASTRONODE_LINK_TEST::per_delta(uint8_t type)
+{
+  uint32_t end = *ASTRONODE::per_counter(&_modem->per_struct, PER_INDEX(type));
+  uint32_t begin = *ASTRONODE::per_counter(&_per_start, PER_INDEX(type));
+  return (end >= begin) ? end - begin : end; // Counters cleared during the test
+}
@@ -0,0 +1,81 @@
+/******************************************************************************************
+ * File:        astronode_linktest.h
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * RF link test for installation: starts test transmissions (TTX_SR) at a fixed interval,
+ * samples the environment and last contact details, and summarizes the site:
+ *   - satellite search peak RSSI and number of samples with a detection
+ *   - contacts seen (end of the last contact increased) and their peak RSSI
+ *   - performance counter deltas (detections, signal and ack demodulation)
+ *   - test transmissions requested, started, and whether the module limit was reached
+ *
+ * Non-blocking: start(), then poll() from the main loop until it returns something else
+ * than ANS_STATUS_PENDING.
+ ****************************************************************************************/
+
+#ifndef _ASTRONODE_LINKTEST_h
+#define _ASTRONODE_LINKTEST_h
+
+#include "astronode.h"
+
+#define LINK_TEST_SAMPLE_PERIOD 10000 // ms between environment and contact samples
+#define LINK_TEST_RSSI_DETECT 4       // Search peak RSSI from which a satellite is detected
+
+class ASTRONODE_LINK_TEST
+{
+
+public:
+  typedef struct
+  {
+    uint32_t duration; // ms
+    uint8_t tx_requested;
+    uint8_t tx_started;
+    bool max_tx_reached;
+    uint16_t samples;
+    uint16_t detections; // Samples with a satellite search peak RSSI at or above LINK_TEST_RSSI_DETECT
+    uint8_t peak_search_rssi;
+    uint8_t contacts;
+    uint8_t peak_contact_rssi;
+    uint32_t sat_detect_cnt; // Performance counter deltas over the test
+    uint32_t signal_demod_attempts;
+    uint32_t signal_demod_success;
+    uint32_t ack_demod_attempts;
+    uint32_t ack_demod_success;
+  } ASTRONODE_LINK_TEST_SUMMARY;
+
+private:
+  ASTRONODE *_modem;
+  ASTRONODE_LINK_TEST_SUMMARY _summary = {};
+  ASTRONODE::ASTRONODE_PER_STRUCT _per_start = {};
+
+  bool _running = false;
+  unsigned long _start = 0;
+  unsigned long _duration = 0;
+  uint8_t _transmissions = 0;
+  unsigned long _tx_interval = 0;
+  unsigned long _last_tx = 0;
+  unsigned long _last_sample = 0;
+  uint32_t _last_contact_end = 0;
+
+  ans_status_e sample(void);
+  ans_status_e finish(void);
+  uint32_t per_delta(uint8_t type);
+
+public:
+  ASTRONODE_LINK_TEST(ASTRONODE &modem) : _modem(&modem) {}
+
+  // Run for duration [ms], with up to transmissions test transmissions every tx_interval [ms] (the first one at start)
+  ans_status_e start(unsigned long duration,
+                     uint8_t transmissions,
+                     unsigned long tx_interval);
+  // ANS_STATUS_PENDING while running, ANS_STATUS_SUCCESS when the summary is complete, or a module error
+  ans_status_e poll(void);
+  void abort(void) { _running = false; }
+
+  bool running(void) { return _running; }
+  const ASTRONODE_LINK_TEST_SUMMARY &summary(void) { return _summary; }
+};
+
+#endif
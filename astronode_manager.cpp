@@ -0,0 +1,371 @@
+/******************************************************************************************
+ * File:        astronode_manager.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+
+#include "astronode_manager.h"
+
+#if defined(ASTRONODE_HOST)
+#include <poll.h>
+#endif
+
+ASTRONODE_MANAGER::ASTRONODE_MANAGER()
+{
+  memset(_modems, 0, sizeof(_modems));
+  memset(_uplinks, 0, sizeof(_uplinks));
+  memset(_uplink_seq, 0, sizeof(_uplink_seq));
+}
+
+bool ASTRONODE_MANAGER::add_modem(ASTRONODE &modem,
+                                  int fd)
+{
+  if (_modem_cnt >= ASTRONODE_MANAGER_MAX_MODEMS)
+  {
+    return false;
+  }
+
+  ASTRONODE_MANAGER_MODEM *m = &_modems[_modem_cnt++];
+  memset(m, 0, sizeof(*m));
+  m->modem = &modem;
+  m->fd = fd;
+  m->state = MODEM_STATE_IDLE;
+  m->valid = false;
+  m->refresh_time = millis() - ASTRONODE_MANAGER_REFRESH_PERIOD; // Refresh on first poll
+  m->uplink = -1;
+  return true;
+}
+
+const ASTRONODE_MANAGER::ASTRONODE_MANAGER_MODEM *ASTRONODE_MANAGER::modem_info(uint8_t index)
+{
+  return (index < _modem_cnt) ? &_modems[index] : NULL;
+}
+
+ans_status_e ASTRONODE_MANAGER::enqueue_payload(uint8_t *data,
+                                                uint8_t length,
+                                                uint16_t id)
+{
+  if (length > ASN_MAX_MSG_SIZE)
+  {
+    return ANS_STATUS_PAYLOAD_TOO_LONG;
+  }
+
+  for (uint8_t i = 0; i < ASTRONODE_MANAGER_QUEUE_SIZE; i++)
+  {
+    if (!_uplinks[i].used)
+    {
+      _uplinks[i].used = true;
+      _uplinks[i].assigned = false;
+      _uplinks[i].id = id;
+      _uplinks[i].length = length;
+      memcpy(_uplinks[i].data, data, length);
+      _uplink_seq[i] = _seq++;
+      return ANS_STATUS_PENDING; // Result reported through onUplinkDone()
+    }
+  }
+  return ANS_STATUS_BUFFER_FULL;
+}
+
+uint8_t ASTRONODE_MANAGER::pending_uplinks(void)
+{
+  uint8_t cnt = 0;
+  for (uint8_t i = 0; i < ASTRONODE_MANAGER_QUEUE_SIZE; i++)
+  {
+    if (_uplinks[i].used)
+    {
+      cnt++;
+    }
+  }
+  return cnt;
+}
+
+void ASTRONODE_MANAGER::poll(void)
+{
+  // Round-robin, starting from a different module on each call
+  for (uint8_t k = 0; k < _modem_cnt; k++)
+  {
+    poll_modem((_next_modem + k) % _modem_cnt);
+  }
+  if (_modem_cnt > 0)
+  {
+    _next_modem = (_next_modem + 1) % _modem_cnt;
+  }
+
+  dispatch_uplinks();
+}
+
+void ASTRONODE_MANAGER::wait(unsigned long timeout_ms)
+{
+#if defined(ASTRONODE_HOST)
+  struct pollfd pfds[ASTRONODE_MANAGER_MAX_MODEMS];
+  nfds_t nfds = 0;
+  unsigned long now = millis();
+
+  for (uint8_t i = 0; i < _modem_cnt; i++)
+  {
+    ASTRONODE_MANAGER_MODEM *m = &_modems[i];
+    if (m->state != MODEM_STATE_IDLE)
+    {
+      if (m->fd >= 0)
+      {
+        pfds[nfds].fd = m->fd;
+        pfds[nfds].events = POLLIN;
+        pfds[nfds].revents = 0;
+        nfds++;
+      }
+      else
+      {
+        timeout_ms = 1; // Answer can only be polled
+      }
+      if (timeout_ms > TIMEOUT_SERIAL)
+      {
+        timeout_ms = TIMEOUT_SERIAL;
+      }
+    }
+    else
+    {
+      // Wake-up for the next refresh
+      unsigned long period = m->valid ? ASTRONODE_MANAGER_REFRESH_PERIOD : ASTRONODE_MANAGER_RETRY_PERIOD;
+      unsigned long elapsed = now - m->refresh_time;
+      unsigned long due = (elapsed >= period) ? 0 : period - elapsed;
+      if (timeout_ms > due)
+      {
+        timeout_ms = due;
+      }
+    }
+  }
+
+  ::poll(pfds, nfds, (int)timeout_ms);
+#else
+  (void)timeout_ms; // Nothing to multiplex on MCU, poll() is called round-robin from the main loop
+#endif
+}
+
+void ASTRONODE_MANAGER::poll_modem(uint8_t index)
+{
+  ASTRONODE_MANAGER_MODEM *m = &_modems[index];
+  unsigned long now = millis();
+  uint8_t reg;
+  ans_status_e ret_val;
+
+  switch (m->state)
+  {
+  case MODEM_STATE_IDLE:
+  {
+    unsigned long period = m->valid ? ASTRONODE_MANAGER_REFRESH_PERIOD : ASTRONODE_MANAGER_RETRY_PERIOD;
+    if (now - m->refresh_time >= period)
+    {
+      if (m->modem->async_request(MST_RR, NULL, 0, MST_CMD_LENGTH) == ANS_STATUS_DATA_SENT)
+      {
+        m->state = MODEM_STATE_WAIT_MST;
+      }
+      else
+      {
+        m->valid = false;
+        m->refresh_time = now;
+        m->error_cnt++;
+      }
+    }
+    break;
+  }
+  case MODEM_STATE_WAIT_MST:
+  {
+    uint8_t param_a[MST_CMD_LENGTH] = {};
+    ret_val = m->modem->async_poll(&reg, param_a, sizeof(param_a));
+    if (ret_val == ANS_STATUS_PENDING)
+    {
+      break;
+    }
+    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == MST_RA)
+    {
+      m->modem->decode_module_state(param_a);
+      m->msg_in_queue = m->modem->mst_struct.msg_in_queue;
+      if (m->modem->async_request(NCO_RR, NULL, 0, 4) == ANS_STATUS_DATA_SENT)
+      {
+        m->state = MODEM_STATE_WAIT_NCO;
+        break;
+      }
+    }
+    m->valid = false;
+    m->refresh_time = now;
+    m->error_cnt++;
+    m->state = MODEM_STATE_IDLE;
+    break;
+  }
+  case MODEM_STATE_WAIT_NCO:
+  {
+    uint8_t param_a[4] = {};
+    ret_val = m->modem->async_poll(&reg, param_a, sizeof(param_a));
+    if (ret_val == ANS_STATUS_PENDING)
+    {
+      break;
+    }
+    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == NCO_RA)
+    {
+      m->nco = (((uint32_t)param_a[3]) << 24) +
+               (((uint32_t)param_a[2]) << 16) +
+               (((uint32_t)param_a[1]) << 8) +
+               (((uint32_t)param_a[0]) << 0);
+      m->valid = true;
+    }
+    else
+    {
+      m->valid = false;
+      m->error_cnt++;
+    }
+    m->refresh_time = now;
+    m->state = MODEM_STATE_IDLE;
+    break;
+  }
+  case MODEM_STATE_WAIT_PLD:
+  {
+    uint8_t param_a[2] = {};
+    ret_val = m->modem->async_poll(&reg, param_a, sizeof(param_a));
+    if (ret_val == ANS_STATUS_PENDING)
+    {
+      break;
+    }
+    if (ret_val == ANS_STATUS_DATA_RECEIVED && reg == PLD_EA)
+    {
+      // Check that enqueued payload has the correct ID
+      uint16_t id_check = (((uint16_t)param_a[1]) << 8) + ((uint16_t)param_a[0]);
+      ret_val = (id_check == _uplinks[m->uplink].id) ? ANS_STATUS_SUCCESS : ANS_STATUS_PAYLOD_ID_CHECK_FAILED;
+    }
+    m->state = MODEM_STATE_IDLE;
+    uplink_done(index, ret_val);
+    break;
+  }
+  }
+}
+
+void ASTRONODE_MANAGER::uplink_done(uint8_t modem_index,
+                                    ans_status_e status)
+{
+  ASTRONODE_MANAGER_MODEM *m = &_modems[modem_index];
+  ASTRONODE_MANAGER_UPLINK *u = &_uplinks[m->uplink];
+  m->uplink = -1;
+
+  switch (status)
+  {
+  case ANS_STATUS_BUFFER_FULL:
+    // Module queue is full, try another module
+    m->msg_in_queue = ASN_MSG_QUEUE_SIZE;
+    u->assigned = false;
+    return;
+  case ANS_STATUS_TIMEOUT:
+  case ANS_STATUS_CRC_NOT_VALID:
+    // Answer lost: the payload may be queued in the module already, it is reported and not sent again (to this
+    // module or another one, it could be uplinked twice). The module state is refreshed before using it again.
+    m->valid = false;
+    m->refresh_time = millis();
+    m->error_cnt++;
+    break;
+  case ANS_STATUS_HW_ERR:
+  case ANS_STATUS_DEVICE_BUSY:
+    // Not queued: refresh the module state before using it again, and try another module
+    m->valid = false;
+    m->refresh_time = millis();
+    m->error_cnt++;
+    u->assigned = false;
+    return;
+  case ANS_STATUS_SUCCESS:
+    m->msg_in_queue++;
+    m->enqueued_cnt++;
+    break;
+  default:
+    m->error_cnt++;
+    break;
+  }
+
+  u->used = false;
+  u->assigned = false;
+  if (_uplink_done_cb != NULL)
+  {
+    _uplink_done_cb(u->id, modem_index, status);
+  }
+}
+
+void ASTRONODE_MANAGER::dispatch_uplinks(void)
+{
+  while (true)
+  {
+    int8_t u = oldest_uplink();
+    if (u < 0)
+    {
+      return;
+    }
+    int8_t i = select_modem();
+    if (i < 0)
+    {
+      return;
+    }
+
+    ASTRONODE_MANAGER_MODEM *m = &_modems[i];
+    uint8_t param_w[ASN_MAX_MSG_SIZE + 2] = {};
+    param_w[0] = (uint8_t)_uplinks[u].id;
+    param_w[1] = (uint8_t)(_uplinks[u].id >> 8);
+    memcpy(&param_w[2], _uplinks[u].data, _uplinks[u].length);
+
+    if (m->modem->async_request(PLD_ER, param_w, _uplinks[u].length + 2, 2) == ANS_STATUS_DATA_SENT)
+    {
+      _uplinks[u].assigned = true;
+      m->uplink = u;
+      m->state = MODEM_STATE_WAIT_PLD;
+    }
+    else
+    {
+      m->valid = false;
+      m->refresh_time = millis();
+      m->error_cnt++;
+    }
+  }
+}
+
+int8_t ASTRONODE_MANAGER::select_modem(void)
+{
+  // Least loaded module first, earliest next contact opportunity on equal load
+  int8_t best = -1;
+  uint32_t best_nco = 0;
+  for (uint8_t i = 0; i < _modem_cnt; i++)
+  {
+    ASTRONODE_MANAGER_MODEM *m = &_modems[i];
+    if (m->state != MODEM_STATE_IDLE || !m->valid || m->msg_in_queue >= ASN_MSG_QUEUE_SIZE)
+    {
+      continue;
+    }
+    uint32_t nco = nco_remaining(m);
+    if (best < 0 ||
+        m->msg_in_queue < _modems[best].msg_in_queue ||
+        (m->msg_in_queue == _modems[best].msg_in_queue && nco < best_nco))
+    {
+      best = i;
+      best_nco = nco;
+    }
+  }
+  return best;
+}
+
+int8_t ASTRONODE_MANAGER::oldest_uplink(void)
+{
+  int8_t oldest = -1;
+  uint16_t oldest_age = 0;
+  for (uint8_t i = 0; i < ASTRONODE_MANAGER_QUEUE_SIZE; i++)
+  {
+    if (_uplinks[i].used && !_uplinks[i].assigned)
+    {
+      uint16_t age = _seq - _uplink_seq[i];
+      if (oldest < 0 || age > oldest_age)
+      {
+        oldest = i;
+        oldest_age = age;
+      }
+    }
+  }
+  return oldest;
+}
+
+uint32_t ASTRONODE_MANAGER::nco_remaining(ASTRONODE_MANAGER_MODEM *m)
+{
+  uint32_t elapsed = (millis() - m->refresh_time) / 1000;
+  return (m->nco > elapsed) ? m->nco - elapsed : 0;
+}
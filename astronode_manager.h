@@ -0,0 +1,101 @@
+/******************************************************************************************
+ * File:        astronode_manager.h
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * Drives several Astronode modules (one ASTRONODE instance each, on separate transports)
+ * concurrently with non-blocking requests, and load-balances uplink payloads across them
+ * by queue depth (msg_in_queue) and next contact opportunity. An uplink whose PLD_ER answer
+ * is lost (timeout, CRC) is reported as such and not sent again: it may be queued already.
+ *
+ * On MCU, call poll() from the main loop (round-robin over the modules). On a host build
+ * (-DASTRONODE_HOST), wait() multiplexes the modules file descriptors with poll().
+ ****************************************************************************************/
+
+#ifndef _ASTRONODE_MANAGER_h
+#define _ASTRONODE_MANAGER_h
+
+#include "astronode.h"
+
+#define ASTRONODE_MANAGER_MAX_MODEMS 4
+#define ASTRONODE_MANAGER_QUEUE_SIZE 8
+#define ASTRONODE_MANAGER_REFRESH_PERIOD 60000 // ms, module state and next contact opportunity refresh period
+#define ASTRONODE_MANAGER_RETRY_PERIOD 5000    // ms, delay before retrying a module which failed to answer
+
+// Modem states
+#define MODEM_STATE_IDLE 0
+#define MODEM_STATE_WAIT_MST 1
+#define MODEM_STATE_WAIT_NCO 2
+#define MODEM_STATE_WAIT_PLD 3
+
+class ASTRONODE_MANAGER
+{
+
+public:
+  typedef void (*uplink_done_cb_t)(uint16_t id,
+                                   uint8_t modem_index,
+                                   ans_status_e status);
+
+  typedef struct
+  {
+    ASTRONODE *modem;
+    int fd;                     // File descriptor of the transport (host only, -1 if unknown)
+    uint8_t state;              // MODEM_STATE_*
+    bool valid;                 // Module state and next contact opportunity are known
+    uint8_t msg_in_queue;       // Payloads in the module queue (last read + enqueued since)
+    uint32_t nco;               // Next contact opportunity when read [s]
+    unsigned long refresh_time; // millis() of the last refresh (or failed attempt)
+    int8_t uplink;              // Index of the uplink being enqueued, -1 if none
+    uint16_t enqueued_cnt;
+    uint16_t error_cnt;
+  } ASTRONODE_MANAGER_MODEM;
+
+  typedef struct
+  {
+    bool used;
+    bool assigned;
+    uint16_t id;
+    uint8_t length;
+    uint8_t data[ASN_MAX_MSG_SIZE];
+  } ASTRONODE_MANAGER_UPLINK;
+
+private:
+  ASTRONODE_MANAGER_MODEM _modems[ASTRONODE_MANAGER_MAX_MODEMS];
+  uint8_t _modem_cnt = 0;
+  uint8_t _next_modem = 0;
+
+  ASTRONODE_MANAGER_UPLINK _uplinks[ASTRONODE_MANAGER_QUEUE_SIZE];
+  uint16_t _uplink_seq[ASTRONODE_MANAGER_QUEUE_SIZE]; // FIFO order of the uplinks
+  uint16_t _seq = 0;
+
+  uplink_done_cb_t _uplink_done_cb = NULL;
+
+  void poll_modem(uint8_t index);
+  void dispatch_uplinks(void);
+  int8_t select_modem(void);
+  int8_t oldest_uplink(void);
+  uint32_t nco_remaining(ASTRONODE_MANAGER_MODEM *m);
+  void uplink_done(uint8_t modem_index,
+                   ans_status_e status);
+
+public:
+  ASTRONODE_MANAGER();
+
+  bool add_modem(ASTRONODE &modem,
+                 int fd = -1);
+  uint8_t modem_count(void) { return _modem_cnt; }
+  const ASTRONODE_MANAGER_MODEM *modem_info(uint8_t index);
+
+  void onUplinkDone(uplink_done_cb_t cb) { _uplink_done_cb = cb; }
+
+  ans_status_e enqueue_payload(uint8_t *data,
+                               uint8_t length,
+                               uint16_t id);
+  uint8_t pending_uplinks(void);
+
+  void poll(void);
+  void wait(unsigned long timeout_ms);
+};
+
+#endif
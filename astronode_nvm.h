@@ -0,0 +1,47 @@
+/******************************************************************************************
+ * File:        astronode_nvm.h
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * Non-volatile storage used by the library to keep small records across MCU power cycles
+ * (warm start record, ...). Implement read() and write() on the storage available on the
+ * board (EEPROM, flash page, FRAM, file on a host). See astronode_nvm_eeprom.h for the
+ * Arduino EEPROM library and ASTRONODE_NVM_FILE (astronode_posix.h) for host builds.
+ ****************************************************************************************/
+
+#ifndef _ASTRONODE_NVM_h
+#define _ASTRONODE_NVM_h
+
+#include "astronode.h"
+
+class ASTRONODE_NVM
+{
+
+public:
+  // Return false if the storage could not be accessed (or the address range is invalid)
+  virtual bool read(uint32_t address,
+                    uint8_t *data,
+                    uint16_t length) = 0;
+  virtual bool write(uint32_t address,
+                     const uint8_t *data,
+                     uint16_t length) = 0;
+
+  // CRC-16/CCITT (same as the module frames), to validate records
+  static uint16_t crc(const uint8_t *data,
+                      uint16_t length,
+                      uint16_t init = 0xFFFF)
+  {
+    uint16_t x;
+    uint16_t crc = init;
+    for (uint16_t i = 0; i < length; i++)
+    {
+      x = crc >> 8 ^ data[i];
+      x ^= x >> 4;
+      crc = (crc << 8) ^ (x << 12) ^ (x << 5) ^ (x);
+    }
+    return crc;
+  }
+};
+
+#endif
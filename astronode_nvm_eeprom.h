@@ -0,0 +1,59 @@
+/******************************************************************************************
+ * File:        astronode_nvm_eeprom.h
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * ASTRONODE_NVM on the Arduino EEPROM library (AVR, ESP32, ESP8266, ...). Only the bytes
+ * which differ are written. On ESP32/ESP8266, call EEPROM.begin(size) in setup() first.
+ ****************************************************************************************/
+
+#ifndef _ASTRONODE_NVM_EEPROM_h
+#define _ASTRONODE_NVM_EEPROM_h
+
+#include <EEPROM.h>
+#include "astronode_nvm.h"
+
+class ASTRONODE_NVM_EEPROM : public ASTRONODE_NVM
+{
+
+public:
+  bool read(uint32_t address,
+            uint8_t *data,
+            uint16_t length)
+  {
+    if (address + length > EEPROM.length())
+    {
+      return false;
+    }
+    for (uint16_t i = 0; i < length; i++)
+    {
+      data[i] = EEPROM.read(address + i);
+    }
+    return true;
+  }
+
+  bool write(uint32_t address,
+             const uint8_t *data,
+             uint16_t length)
+  {
+    if (address + length > EEPROM.length())
+    {
+      return false;
+    }
+    for (uint16_t i = 0; i < length; i++)
+    {
+      if (EEPROM.read(address + i) != data[i])
+      {
+        EEPROM.write(address + i, data[i]);
+      }
+    }
+#if defined(ESP32) || defined(ESP8266)
+    return EEPROM.commit();
+#else
+    return true;
+#endif
+  }
+};
+
+#endif
@@ -0,0 +1,120 @@
+/******************************************************************************************
+ * File:        astronode_per.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+
+#include "astronode_per.h"
+
+ans_status_e ASTRONODE_PER_DELTA::update(void)
+{
+  ans_status_e ret_val = _modem->read_module_state();
+  if (ret_val == ANS_STATUS_SUCCESS)
+  {
+    ret_val = _modem->read_performance_counter();
+  }
+  if (ret_val != ANS_STATUS_SUCCESS)
+  {
+    return ret_val;
+  }
+
+  const ASTRONODE::ASTRONODE_MST_STRUCT *mst = &_modem->mst_struct;
+  ASTRONODE::ASTRONODE_PER_STRUCT *per = &_modem->per_struct;
+
+  _reset_detected = _primed && (mst->last_rst != _last_rst || mst->uptime < _last_uptime);
+  if (!_primed || _reset_detected)
+  {
+    set_baseline();
+    return ANS_STATUS_SUCCESS;
+  }
+
+  bool cleared = (_modem->performance_counter_clear_count() != _last_clear_cnt);
+
+  ASTRONODE_PER_INTERVAL *interval = &_window[_head];
+  interval->duration = mst->uptime - _last_uptime;
+  for (uint8_t k = 0; k < PER_TYPE_CNT; k++)
+  {
+    // Counted from 0 after a clear, modulo 2^32 otherwise
+    uint32_t counter = *ASTRONODE::per_counter(per, k);
+    uint32_t d = cleared ? counter : counter - _last[k];
+    interval->delta[k] = (d > 0xFFFF) ? 0xFFFF : (uint16_t)d;
+  }
+  _head = (_head + 1) % ASTRONODE_PER_WINDOW_SIZE;
+  if (_count < ASTRONODE_PER_WINDOW_SIZE)
+  {
+    _count++;
+  }
+
+  set_baseline();
+  return ANS_STATUS_SUCCESS;
+}
+
+void ASTRONODE_PER_DELTA::set_baseline(void)
+{
+  for (uint8_t k = 0; k < PER_TYPE_CNT; k++)
+  {
+    _last[k] = *ASTRONODE::per_counter(&_modem->per_struct, k);
+  }
+  _last_rst = _modem->mst_struct.last_rst;
+  _last_uptime = _modem->mst_struct.uptime;
+  _last_clear_cnt = _modem->performance_counter_clear_count();
+  _primed = true;
+}
+
+void ASTRONODE_PER_DELTA::clear(void)
+{
+  _primed = false;
+  _reset_detected = false;
+  _head = 0;
+  _count = 0;
+}
+
+const ASTRONODE_PER_INTERVAL *ASTRONODE_PER_DELTA::interval(uint8_t age)
+{
+  if (age >= _count)
+  {
+    return NULL;
+  }
+  return &_window[(_head + ASTRONODE_PER_WINDOW_SIZE - 1 - age) % ASTRONODE_PER_WINDOW_SIZE];
+}
+
+uint32_t ASTRONODE_PER_DELTA::delta(uint8_t type,
+                                    uint8_t intervals)
+{
+  if (type < PER_TYPE_SAT_SEARCH_PHASE_CNT || type > PER_TYPE_CMD_DEMOD_SUCCESS_CNT)
+  {
+    return 0;
+  }
+
+  uint32_t sum = 0;
+  for (uint8_t age = 0; age < intervals && age < _count; age++)
+  {
+    sum += interval(age)->delta[PER_INDEX(type)];
+  }
+  return sum;
+}
+
+uint32_t ASTRONODE_PER_DELTA::duration(uint8_t intervals)
+{
+  uint32_t sum = 0;
+  for (uint8_t age = 0; age < intervals && age < _count; age++)
+  {
+    sum += interval(age)->duration;
+  }
+  return sum;
+}
+
+uint16_t ASTRONODE_PER_DELTA::ratio(uint8_t type_num,
+                                   uint8_t type_den,
+                                   uint8_t intervals)
+{
+  uint32_t num = delta(type_num, intervals);
+  uint32_t den = delta(type_den, intervals);
+  if (den == 0)
+  {
+    return PER_RATIO_UNDEFINED;
+  }
+  // num <= ASTRONODE_PER_WINDOW_SIZE * 0xFFFF: num * 1000 fits in 32 bits
+  uint32_t per_mille = (num * 1000) / den;
+  return (per_mille > 1000) ? 1000 : (uint16_t)per_mille; // More successes than attempts (saturated or cleared counters)
+}
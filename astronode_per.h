@@ -0,0 +1,95 @@
+/******************************************************************************************
+ * File:        astronode_per.h
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * Performance counter delta engine. The module counters are cumulative: update() reads
+ * them with the module state and keeps the per-interval increments in a rolling window,
+ * from which deltas and ratios (demodulation success, acknowledged fragments, ...) are
+ * computed.
+ *
+ * Counter wraparound is handled by modulo arithmetic. A clear_performance_counter() call
+ * restarts the counters from 0. A module reset (last_rst changed or uptime went back) may
+ * restore counters saved in flash, so no interval is computed across it: the baseline is
+ * taken again and reset_detected() is set.
+ ****************************************************************************************/
+
+#ifndef _ASTRONODE_PER_h
+#define _ASTRONODE_PER_h
+
+#include "astronode.h"
+
+#define ASTRONODE_PER_WINDOW_SIZE 8 // Intervals kept in the rolling window
+
+// Ratios are given in per mille, 1000 at most
+#define PER_RATIO_UNDEFINED 0xFFFF // Denominator delta is 0
+
+typedef struct
+{
+  uint32_t duration;            // s, module uptime elapsed during the interval
+  uint16_t delta[PER_TYPE_CNT]; // Counter increments, indexed by PER_INDEX(PER_TYPE_*), saturated
+} ASTRONODE_PER_INTERVAL;
+
+class ASTRONODE_PER_DELTA
+{
+
+private:
+  ASTRONODE *_modem;
+
+  // Baseline
+  bool _primed = false;
+  uint32_t _last[PER_TYPE_CNT];
+  uint8_t _last_rst = 0;
+  uint32_t _last_uptime = 0;
+  uint8_t _last_clear_cnt = 0;
+  bool _reset_detected = false;
+
+  // Rolling window, _head is the next slot written
+  ASTRONODE_PER_INTERVAL _window[ASTRONODE_PER_WINDOW_SIZE];
+  uint8_t _head = 0;
+  uint8_t _count = 0;
+
+  void set_baseline(void);
+
+public:
+  ASTRONODE_PER_DELTA(ASTRONODE &modem) : _modem(&modem) {}
+
+  // Read the module state and performance counters, and append the interval since the previous call to the window.
+  // The first call (and the first call after a module reset) only takes the baseline.
+  ans_status_e update(void);
+  bool reset_detected(void) { return _reset_detected; } // The last update() saw a module reset
+  void clear(void);
+
+  uint8_t count(void) { return _count; }
+  // age 0 is the latest interval, NULL if age >= count()
+  const ASTRONODE_PER_INTERVAL *interval(uint8_t age);
+
+  // Sums over the latest intervals (all the window if intervals >= count())
+  uint32_t delta(uint8_t type,
+                 uint8_t intervals);
+  uint32_t duration(uint8_t intervals);
+  uint16_t ratio(uint8_t type_num,
+                 uint8_t type_den,
+                 uint8_t intervals);
+
+  // Common ratios, per mille
+  uint16_t signal_demod_success_ratio(uint8_t intervals)
+  {
+    return ratio(PER_TYPE_SIGNAL_DEMOD_SUCCESS_CNT, PER_TYPE_SIGNAL_DEMOD_ATTEMPS_CNT, intervals);
+  }
+  uint16_t ack_demod_success_ratio(uint8_t intervals)
+  {
+    return ratio(PER_TYPE_ACK_DEMOD_SUCCESS_CNT, PER_TYPE_ACK_DEMOD_ATTEMPT_CNT, intervals);
+  }
+  uint16_t fragment_ack_ratio(uint8_t intervals)
+  {
+    return ratio(PER_TYPE_ACK_FRAGMENT_CNT, PER_TYPE_SENT_FRAGMENT_CNT, intervals);
+  }
+  uint16_t cmd_demod_success_ratio(uint8_t intervals)
+  {
+    return ratio(PER_TYPE_CMD_DEMOD_SUCCESS_CNT, PER_TYPE_CMD_DEMOD_ATTEMPT_CNT, intervals);
+  }
+};
+
+#endif
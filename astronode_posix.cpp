@@ -0,0 +1,302 @@
+/******************************************************************************************
+ * File:        astronode_posix.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+
+#include "astronode_posix.h"
+
+#if defined(ASTRONODE_HOST)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+static speed_t baudrate_to_speed(uint32_t baudrate)
+{
+  switch (baudrate)
+  {
+  case 1200:
+    return B1200;
+  case 2400:
+    return B2400;
+  case 4800:
+    return B4800;
+  case 9600:
+    return B9600;
+  case 19200:
+    return B19200;
+  case 38400:
+    return B38400;
+  case 57600:
+    return B57600;
+  case 115200:
+    return B115200;
+  default:
+    return B0;
+  }
+}
+
+ASTRONODE_POSIX_SERIAL::~ASTRONODE_POSIX_SERIAL()
+{
+  close();
+}
+
+bool ASTRONODE_POSIX_SERIAL::open(const char *device,
+                                  uint32_t baudrate)
+{
+  speed_t speed = baudrate_to_speed(baudrate);
+  if (speed == B0)
+  {
+    return false;
+  }
+
+  close();
+
+  int fd = ::open(device, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  // Raw mode, 8N1, no flow control
+  struct termios tio;
+  if (tcgetattr(fd, &tio) != 0)
+  {
+    ::close(fd);
+    return false;
+  }
+  cfmakeraw(&tio);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tio.c_cflag &= ~(CSTOPB | PARENB | CRTSCTS);
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+  cfsetispeed(&tio, speed);
+  cfsetospeed(&tio, speed);
+  if (tcsetattr(fd, TCSANOW, &tio) != 0)
+  {
+    ::close(fd);
+    return false;
+  }
+  tcflush(fd, TCIOFLUSH);
+
+  _fd = fd;
+  _owns_fd = true;
+  _hangup = false;
+  return true;
+}
+
+bool ASTRONODE_POSIX_SERIAL::attach(int fd)
+{
+  // Use an already configured descriptor (e.g. the slave side of an openpty() pair)
+  close();
+
+  int flags = fcntl(fd, F_GETFL);
+  if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0)
+  {
+    return false;
+  }
+
+  _fd = fd;
+  _owns_fd = false;
+  _hangup = false;
+  return true;
+}
+
+void ASTRONODE_POSIX_SERIAL::close(void)
+{
+  if (_fd >= 0 && _owns_fd)
+  {
+    ::close(_fd);
+  }
+  _fd = -1;
+  _owns_fd = false;
+  _hangup = false;
+  _rx_head = 0;
+  _rx_tail = 0;
+}
+
+bool ASTRONODE_POSIX_SERIAL::fill_rx_buffer(int timeout_ms)
+{
+  if (_fd < 0)
+  {
+    return false;
+  }
+
+  if (_rx_head == _rx_tail)
+  {
+    _rx_head = 0;
+    _rx_tail = 0;
+  }
+  if (_rx_tail == sizeof(_rx_buf))
+  {
+    return true;
+  }
+
+  if (timeout_ms != 0)
+  {
+    struct pollfd pfd = {_fd, POLLIN, 0};
+    int ret;
+    do
+    {
+      ret = poll(&pfd, 1, timeout_ms);
+    } while (ret < 0 && errno == EINTR);
+    if (ret <= 0)
+    {
+      return false;
+    }
+    if (pfd.revents & POLLNVAL)
+    {
+      _hangup = true;
+      return false;
+    }
+  }
+
+  ssize_t n = ::read(_fd, &_rx_buf[_rx_tail], sizeof(_rx_buf) - _rx_tail);
+  if (n <= 0)
+  {
+    // 0: end of file, EIO: pty master closed. EAGAIN only means no data yet.
+    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+    {
+      _hangup = true;
+    }
+    return false;
+  }
+  _rx_tail += (size_t)n;
+  return true;
+}
+
+int ASTRONODE_POSIX_SERIAL::timedRead(void)
+{
+  unsigned long start = millis();
+  while (_rx_head == _rx_tail)
+  {
+    unsigned long elapsed = millis() - start;
+    if (elapsed >= _timeout)
+    {
+      return -1;
+    }
+    if (!fill_rx_buffer((int)(_timeout - elapsed)) && (_fd < 0 || _hangup))
+    {
+      return -1; // No more data will come, do not spin until the timeout
+    }
+  }
+  return _rx_buf[_rx_head++];
+}
+
+int ASTRONODE_POSIX_SERIAL::available(void)
+{
+  fill_rx_buffer(0);
+  return (int)(_rx_tail - _rx_head);
+}
+
+int ASTRONODE_POSIX_SERIAL::read(void)
+{
+  if (_rx_head == _rx_tail && !fill_rx_buffer(0))
+  {
+    return -1;
+  }
+  return _rx_buf[_rx_head++];
+}
+
+int ASTRONODE_POSIX_SERIAL::peek(void)
+{
+  if (_rx_head == _rx_tail && !fill_rx_buffer(0))
+  {
+    return -1;
+  }
+  return _rx_buf[_rx_head];
+}
+
+size_t ASTRONODE_POSIX_SERIAL::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t ASTRONODE_POSIX_SERIAL::write(const uint8_t *buffer,
+                                     size_t size)
+{
+  if (_fd < 0)
+  {
+    return 0;
+  }
+
+  size_t written = 0;
+  unsigned long start = millis();
+  while (written < size)
+  {
+    ssize_t n = ::write(_fd, &buffer[written], size - written);
+    if (n > 0)
+    {
+      written += (size_t)n;
+    }
+    else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    {
+      unsigned long elapsed = millis() - start;
+      if (elapsed >= _timeout)
+      {
+        break;
+      }
+      struct pollfd pfd = {_fd, POLLOUT, 0};
+      poll(&pfd, 1, (int)(_timeout - elapsed));
+    }
+    else
+    {
+      break;
+    }
+  }
+  return written;
+}
+
+void ASTRONODE_POSIX_SERIAL::flush(void)
+{
+  if (_fd >= 0 && isatty(_fd))
+  {
+    tcdrain(_fd);
+  }
+}
+
+ASTRONODE_NVM_FILE::~ASTRONODE_NVM_FILE()
+{
+  close();
+}
+
+bool ASTRONODE_NVM_FILE::open(const char *path)
+{
+  close();
+  _fd = ::open(path, O_RDWR | O_CREAT, 0644);
+  return _fd >= 0;
+}
+
+void ASTRONODE_NVM_FILE::close(void)
+{
+  if (_fd >= 0)
+  {
+    ::close(_fd);
+  }
+  _fd = -1;
+}
+
+bool ASTRONODE_NVM_FILE::read(uint32_t address,
+                              uint8_t *data,
+                              uint16_t length)
+{
+  // Short read: the record was never written
+  return _fd >= 0 && pread(_fd, data, length, (off_t)address) == (ssize_t)length;
+}
+
+bool ASTRONODE_NVM_FILE::write(uint32_t address,
+                               const uint8_t *data,
+                               uint16_t length)
+{
+  if (_fd < 0 || pwrite(_fd, data, length, (off_t)address) != (ssize_t)length)
+  {
+    return false;
+  }
+  return fsync(_fd) == 0;
+}
+
+#endif
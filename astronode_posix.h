@@ -0,0 +1,85 @@
+/******************************************************************************************
+ * File:        astronode_posix.h
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * Serial transport on a POSIX file descriptor (termios), for Linux gateways with the
+ * Astronode on /dev/ttyUSB* or /dev/ttyACM*. Timeouts are handled with poll() instead of
+ * busy waiting.
+ *
+ * ASTRONODE_NVM_FILE keeps the library non-volatile records in a file.
+ *
+ * Only available when the library is compiled with -DASTRONODE_HOST.
+ ****************************************************************************************/
+
+#ifndef _ASTRONODE_POSIX_h
+#define _ASTRONODE_POSIX_h
+
+#include "astronode.h"
+#include "astronode_nvm.h"
+
+#if defined(ASTRONODE_HOST)
+
+#define ASTRONODE_POSIX_RX_BUFFER_SIZE 256
+
+class ASTRONODE_POSIX_SERIAL : public Stream
+{
+
+private:
+  int _fd = -1;
+  bool _owns_fd = false;
+
+  uint8_t _rx_buf[ASTRONODE_POSIX_RX_BUFFER_SIZE];
+  size_t _rx_head = 0;
+  size_t _rx_tail = 0;
+  bool _hangup = false; // End of file or error on the descriptor (e.g. device unplugged, pty closed)
+
+  bool fill_rx_buffer(int timeout_ms);
+
+protected:
+  int timedRead(void) override;
+
+public:
+  ~ASTRONODE_POSIX_SERIAL();
+
+  bool open(const char *device,
+            uint32_t baudrate);
+  bool attach(int fd);
+  void close(void);
+  int fd(void) const { return _fd; }
+
+  int available(void) override;
+  int read(void) override;
+  int peek(void) override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer,
+               size_t size) override;
+  void flush(void) override;
+
+  using Print::write;
+};
+
+class ASTRONODE_NVM_FILE : public ASTRONODE_NVM
+{
+
+private:
+  int _fd = -1;
+
+public:
+  ~ASTRONODE_NVM_FILE();
+
+  bool open(const char *path);
+  void close(void);
+
+  bool read(uint32_t address,
+            uint8_t *data,
+            uint16_t length) override;
+  bool write(uint32_t address,
+             const uint8_t *data,
+             uint16_t length) override;
+};
+
+#endif
+
+#endif
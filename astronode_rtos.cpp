@@ -0,0 +1,162 @@
+/******************************************************************************************
+ * File:        astronode_rtos.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+
+#include "astronode_rtos.h"
+
+#if defined(ESP32) || defined(ESP_PLATFORM) || defined(ASTRONODE_HOST)
+
+int8_t ASTRONODE_RTOS::register_client(void)
+{
+  if (_client_cnt >= ASTRONODE_RTOS_MAX_CLIENTS)
+  {
+    return -1;
+  }
+  return _client_cnt++;
+}
+
+bool ASTRONODE_RTOS::submit(uint8_t client,
+                            uint8_t op,
+                            uint32_t tag)
+{
+  if (client >= _client_cnt)
+  {
+    return false;
+  }
+
+  ASTRONODE_RTOS_REQUEST req;
+  req.op = op;
+  req.tag = tag;
+  req.id = 0;
+  req.length = 0;
+  return _clients[client].requests.push(req);
+}
+
+bool ASTRONODE_RTOS::submit_enqueue_payload(uint8_t client,
+                                            uint8_t *data,
+                                            uint8_t length,
+                                            uint16_t id,
+                                            uint32_t tag)
+{
+  if (client >= _client_cnt || length > ASN_MAX_MSG_SIZE)
+  {
+    return false;
+  }
+
+  ASTRONODE_RTOS_REQUEST req;
+  req.op = RTOS_OP_ENQUEUE_PAYLOAD;
+  req.tag = tag;
+  req.id = id;
+  req.length = length;
+  memcpy(req.data, data, length);
+  return _clients[client].requests.push(req);
+}
+
+bool ASTRONODE_RTOS::poll_completion(uint8_t client,
+                                     ASTRONODE_RTOS_COMPLETION *completion)
+{
+  if (client >= _client_cnt)
+  {
+    return false;
+  }
+  return _clients[client].completions.pop(completion);
+}
+
+bool ASTRONODE_RTOS::service(void)
+{
+  bool busy = false;
+
+  for (uint8_t k = 0; k < _client_cnt; k++)
+  {
+    ASTRONODE_RTOS_CLIENT *client = &_clients[(_next_client + k) % _client_cnt];
+
+    // Only take a request if its completion can be delivered
+    if (client->completions.full())
+    {
+      continue;
+    }
+
+    ASTRONODE_RTOS_REQUEST req;
+    if (client->requests.pop(&req))
+    {
+      ASTRONODE_RTOS_COMPLETION c;
+      memset(&c, 0, sizeof(c));
+      c.op = req.op;
+      c.tag = req.tag;
+      execute(req, &c);
+      client->completions.push(c);
+      busy = true;
+    }
+  }
+
+  if (_client_cnt > 0)
+  {
+    _next_client = (_next_client + 1) % _client_cnt;
+  }
+  return busy;
+}
+
+void ASTRONODE_RTOS::execute(const ASTRONODE_RTOS_REQUEST &req,
+                             ASTRONODE_RTOS_COMPLETION *c)
+{
+  switch (req.op)
+  {
+  case RTOS_OP_ENQUEUE_PAYLOAD:
+    c->status = _modem->enqueue_payload((uint8_t *)req.data, req.length, req.id);
+    c->id = req.id;
+    break;
+  case RTOS_OP_DEQUEUE_PAYLOAD:
+    c->status = _modem->dequeue_payload(&c->id);
+    break;
+  case RTOS_OP_CLEAR_FREE_PAYLOADS:
+    c->status = _modem->clear_free_payloads();
+    break;
+  case RTOS_OP_RTC_READ:
+    c->status = _modem->rtc_read(&c->value);
+    break;
+  case RTOS_OP_READ_NEXT_CONTACT_OPPORTUNITY:
+    c->status = _modem->read_next_contact_opportunity(&c->value);
+    break;
+  case RTOS_OP_READ_PERFORMANCE_COUNTER:
+    c->status = _modem->read_performance_counter();
+    c->per = _modem->per_struct;
+    break;
+  case RTOS_OP_READ_MODULE_STATE:
+    c->status = _modem->read_module_state();
+    c->mst = _modem->mst_struct;
+    break;
+  case RTOS_OP_READ_ENVIRONMENT_DETAILS:
+    c->status = _modem->read_environment_details();
+    c->end = _modem->end_struct;
+    break;
+  case RTOS_OP_READ_LAST_CONTACT_DETAILS:
+    c->status = _modem->read_last_contact_details();
+    c->lcd = _modem->lcd_struct;
+    break;
+  case RTOS_OP_EVENT_READ:
+    c->status = _modem->event_read(&c->event_type);
+    break;
+  case RTOS_OP_READ_SATELLITE_ACK:
+    c->status = _modem->read_satellite_ack(&c->id);
+    break;
+  case RTOS_OP_CLEAR_SATELLITE_ACK:
+    c->status = _modem->clear_satellite_ack();
+    break;
+  case RTOS_OP_CLEAR_RESET_EVENT:
+    c->status = _modem->clear_reset_event();
+    break;
+  case RTOS_OP_READ_COMMAND_40B:
+    c->status = _modem->read_command_40B(c->command.data, &c->command.created_date);
+    break;
+  case RTOS_OP_CLEAR_COMMAND:
+    c->status = _modem->clear_command();
+    break;
+  default:
+    c->status = ANS_STATUS_OPCODE_NOT_VALID;
+    break;
+  }
+}
+
+#endif
@@ -0,0 +1,166 @@
+/******************************************************************************************
+ * File:        astronode_rtos.h
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * RTOS front end: ASTRONODE is not reentrant, so a single modem task owns the UART and
+ * the ASTRONODE instance, and serves requests posted by the application tasks.
+ *
+ * Each client task gets a lock-free single-producer/single-consumer request queue (client
+ * -> modem task) and completion queue (modem task -> client), so no mutex is taken on the
+ * fast path. Clients must be registered before the tasks are started.
+ *
+ * Requires <atomic>: available on ESP32 (FreeRTOS) and host builds (std::thread).
+ ****************************************************************************************/
+
+#ifndef _ASTRONODE_RTOS_h
+#define _ASTRONODE_RTOS_h
+
+#include "astronode.h"
+
+#if defined(ESP32) || defined(ESP_PLATFORM) || defined(ASTRONODE_HOST)
+
+#include <atomic>
+
+#define ASTRONODE_RTOS_MAX_CLIENTS 4
+#define ASTRONODE_RTOS_QUEUE_SIZE 4 // Per client and direction, power of 2
+
+// Request operations
+#define RTOS_OP_ENQUEUE_PAYLOAD 1
+#define RTOS_OP_DEQUEUE_PAYLOAD 2
+#define RTOS_OP_CLEAR_FREE_PAYLOADS 3
+#define RTOS_OP_RTC_READ 4
+#define RTOS_OP_READ_NEXT_CONTACT_OPPORTUNITY 5
+#define RTOS_OP_READ_PERFORMANCE_COUNTER 6
+#define RTOS_OP_READ_MODULE_STATE 7
+#define RTOS_OP_READ_ENVIRONMENT_DETAILS 8
+#define RTOS_OP_READ_LAST_CONTACT_DETAILS 9
+#define RTOS_OP_EVENT_READ 10
+#define RTOS_OP_READ_SATELLITE_ACK 11
+#define RTOS_OP_CLEAR_SATELLITE_ACK 12
+#define RTOS_OP_CLEAR_RESET_EVENT 13
+#define RTOS_OP_READ_COMMAND_40B 14
+#define RTOS_OP_CLEAR_COMMAND 15
+
+// Lock-free single-producer/single-consumer ring. Head and tail are free-running 8-bit indexes.
+template <typename T, uint8_t N>
+class ASTRONODE_SPSC_QUEUE
+{
+  static_assert(N > 0 && N <= 128 && (N & (N - 1)) == 0, "Queue size must be a power of 2, at most 128");
+
+private:
+  T _items[N];
+  std::atomic<uint8_t> _head{0}; // Written by the consumer only
+  std::atomic<uint8_t> _tail{0}; // Written by the producer only
+
+public:
+  // Producer side
+  bool push(const T &item)
+  {
+    uint8_t tail = _tail.load(std::memory_order_relaxed);
+    if ((uint8_t)(tail - _head.load(std::memory_order_acquire)) >= N)
+    {
+      return false;
+    }
+    _items[tail & (N - 1)] = item;
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+  bool full(void) const
+  {
+    return (uint8_t)(_tail.load(std::memory_order_relaxed) - _head.load(std::memory_order_acquire)) >= N;
+  }
+
+  // Consumer side
+  bool pop(T *item)
+  {
+    uint8_t head = _head.load(std::memory_order_relaxed);
+    if (head == _tail.load(std::memory_order_acquire))
+    {
+      return false;
+    }
+    *item = _items[head & (N - 1)];
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+  bool empty(void) const
+  {
+    return _head.load(std::memory_order_relaxed) == _tail.load(std::memory_order_acquire);
+  }
+};
+
+typedef struct
+{
+  uint8_t op;   // RTOS_OP_*
+  uint32_t tag; // Returned unchanged in the completion
+  uint16_t id;  // Payload ID (enqueue)
+  uint8_t length;
+  uint8_t data[ASN_MAX_MSG_SIZE];
+} ASTRONODE_RTOS_REQUEST;
+
+typedef struct
+{
+  uint8_t op;
+  uint32_t tag;
+  ans_status_e status;
+  union
+  {
+    uint32_t value; // RTC time, next contact opportunity delay
+    uint16_t id;    // Dequeued or acknowledged payload ID
+    uint8_t event_type;
+    ASTRONODE::ASTRONODE_PER_STRUCT per;
+    ASTRONODE::ASTRONODE_MST_STRUCT mst;
+    ASTRONODE::ASTRONODE_END_STRUCT end;
+    ASTRONODE::ASTRONODE_LCD_STRUCT lcd;
+    struct
+    {
+      uint32_t created_date;
+      uint8_t data[DATA_CMD_40B_SIZE];
+    } command;
+  };
+} ASTRONODE_RTOS_COMPLETION;
+
+class ASTRONODE_RTOS
+{
+
+private:
+  typedef struct
+  {
+    ASTRONODE_SPSC_QUEUE<ASTRONODE_RTOS_REQUEST, ASTRONODE_RTOS_QUEUE_SIZE> requests;
+    ASTRONODE_SPSC_QUEUE<ASTRONODE_RTOS_COMPLETION, ASTRONODE_RTOS_QUEUE_SIZE> completions;
+  } ASTRONODE_RTOS_CLIENT;
+
+  ASTRONODE *_modem;
+  ASTRONODE_RTOS_CLIENT _clients[ASTRONODE_RTOS_MAX_CLIENTS];
+  uint8_t _client_cnt = 0;
+  uint8_t _next_client = 0;
+
+  void execute(const ASTRONODE_RTOS_REQUEST &req,
+               ASTRONODE_RTOS_COMPLETION *c);
+
+public:
+  ASTRONODE_RTOS(ASTRONODE &modem) : _modem(&modem) {}
+
+  // Setup (before the tasks are started)
+  int8_t register_client(void);
+
+  // Client task side
+  bool submit(uint8_t client,
+              uint8_t op,
+              uint32_t tag);
+  bool submit_enqueue_payload(uint8_t client,
+                              uint8_t *data,
+                              uint8_t length,
+                              uint16_t id,
+                              uint32_t tag);
+  bool poll_completion(uint8_t client,
+                       ASTRONODE_RTOS_COMPLETION *completion);
+
+  // Modem task side: serves at most one request per client, round-robin. Returns false if there was nothing to do.
+  bool service(void);
+};
+
+#endif
+
+#endif
@@ -0,0 +1,104 @@
+/******************************************************************************************
+ * File:        astronode_search.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+
+#include "astronode_search.h"
+
+ASTRONODE_SEARCH_CTRL::ASTRONODE_SEARCH_CTRL(ASTRONODE &modem,
+                                             uint8_t min_period,
+                                             uint8_t max_period)
+{
+  _modem = &modem;
+  _min_period = constrain(min_period, SAT_SEARCH_1377_MS, SAT_SEARCH_23414_MS);
+  _max_period = constrain(max_period, _min_period, SAT_SEARCH_23414_MS);
+}
+
+ans_status_e ASTRONODE_SEARCH_CTRL::update(void)
+{
+  uint32_t nco;
+  ans_status_e ret_val = _modem->read_next_contact_opportunity(&nco);
+  if (ret_val == ANS_STATUS_SUCCESS)
+  {
+    ret_val = _modem->read_environment_details();
+  }
+  if (ret_val == ANS_STATUS_SUCCESS)
+  {
+    ret_val = _modem->read_last_contact_details();
+  }
+  if (ret_val == ANS_STATUS_SUCCESS)
+  {
+    ret_val = _modem->read_module_state();
+  }
+  if (ret_val != ANS_STATUS_SUCCESS)
+  {
+    return ret_val;
+  }
+
+  // The period is kept in the module RAM only: back to the default after a module reset, written again
+  if (_period != SAT_SEARCH_DEFAULT &&
+      (_modem->mst_struct.last_rst != _written_rst || _modem->mst_struct.uptime < _written_uptime))
+  {
+    _period = SAT_SEARCH_DEFAULT;
+  }
+
+  // A contact took place since the previous update
+  bool new_contact = _primed && (_modem->lcd_struct.time_end_last_contact != _last_contact_end);
+  _last_contact_end = _modem->lcd_struct.time_end_last_contact;
+  _primed = true;
+
+  uint8_t period = select_period(nco,
+                                 _modem->end_struct.last_sat_search_peak_rssi,
+                                 _modem->end_struct.time_since_last_sat_search,
+                                 new_contact,
+                                 _modem->lcd_struct.peak_rssi_last_contact);
+  if (period == _period)
+  {
+    return ANS_STATUS_SUCCESS;
+  }
+
+  ret_val = _modem->satellite_search_config_write(period, false);
+  if (ret_val == ANS_STATUS_SUCCESS)
+  {
+    _period = period;
+    _written_rst = _modem->mst_struct.last_rst;
+    _written_uptime = _modem->mst_struct.uptime;
+    _write_cnt++;
+  }
+  return ret_val;
+}
+
+uint8_t ASTRONODE_SEARCH_CTRL::select_period(uint32_t nco,
+                                             uint8_t search_peak_rssi,
+                                             uint32_t time_since_search,
+                                             bool new_contact,
+                                             uint8_t contact_peak_rssi)
+{
+  uint8_t target;
+  if (nco <= SEARCH_CTRL_NCO_NEAR ||
+      new_contact ||
+      (search_peak_rssi > SEARCH_CTRL_RSSI_DETECT && time_since_search <= SEARCH_CTRL_DETECT_RECENT))
+  {
+    target = _min_period;
+  }
+  else if (nco <= SEARCH_CTRL_NCO_FAR)
+  {
+    target = (_min_period + _max_period + 1) / 2;
+    if (contact_peak_rssi <= SEARCH_CTRL_RSSI_WEAK && target > _min_period)
+    {
+      target--;
+    }
+  }
+  else
+  {
+    target = _max_period;
+  }
+
+  // Slow down one step at a time
+  if (_period != SAT_SEARCH_DEFAULT && target > _period)
+  {
+    target = _period + 1;
+  }
+  return target;
+}
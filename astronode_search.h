@@ -0,0 +1,69 @@
+/******************************************************************************************
+ * File:        astronode_search.h
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * Adaptive satellite search period. update() reads the next contact opportunity, the
+ * environment details (last satellite search peak RSSI and age) and the last contact
+ * details, selects a SAT_SEARCH_* period within [min_period, max_period] and only writes
+ * it to the module (SSC_WR) when it changes:
+ *
+ *   - contact expected soon, satellite detected recently, or new contact since the last
+ *     update: fastest period (min_period)
+ *   - contact expected within SEARCH_CTRL_NCO_FAR: middle period, one step faster if the
+ *     last contact peak RSSI was weak
+ *   - otherwise: slowest period (max_period)
+ *
+ * The period becomes faster immediately but slower by one step per update only. The module
+ * keeps the period in RAM only: a module reset (last reset reason changed, or uptime lower
+ * than when the period was written) is detected with the module state and the period is
+ * written again.
+ ****************************************************************************************/
+
+#ifndef _ASTRONODE_SEARCH_h
+#define _ASTRONODE_SEARCH_h
+
+#include "astronode.h"
+
+#define SEARCH_CTRL_NCO_NEAR 600      // s, next contact opportunity considered imminent
+#define SEARCH_CTRL_NCO_FAR 3600      // s, beyond this the slowest period is used
+#define SEARCH_CTRL_DETECT_RECENT 900 // s, age below which a satellite search detection counts
+#define SEARCH_CTRL_RSSI_DETECT 3     // Search peak RSSI above which a satellite was detected (4 = detection threshold)
+#define SEARCH_CTRL_RSSI_WEAK 5       // Contact peak RSSI at or below which the link is considered marginal
+
+class ASTRONODE_SEARCH_CTRL
+{
+
+private:
+  ASTRONODE *_modem;
+  uint8_t _min_period;
+  uint8_t _max_period;
+  uint8_t _period = SAT_SEARCH_DEFAULT; // Last period written, SAT_SEARCH_DEFAULT if none
+  uint8_t _written_rst = 0;             // Module state when _period was written
+  uint32_t _written_uptime = 0;
+  uint32_t _last_contact_end = 0;
+  bool _primed = false;
+  uint16_t _write_cnt = 0;
+
+public:
+  // Periods from SAT_SEARCH_1377_MS (fastest) to SAT_SEARCH_23414_MS (slowest)
+  ASTRONODE_SEARCH_CTRL(ASTRONODE &modem,
+                        uint8_t min_period = SAT_SEARCH_1377_MS,
+                        uint8_t max_period = SAT_SEARCH_23414_MS);
+
+  // Call periodically (e.g. every few minutes)
+  ans_status_e update(void);
+
+  // Decision only, no module access (for simulation on recorded housekeeping data)
+  uint8_t select_period(uint32_t nco,
+                        uint8_t search_peak_rssi,
+                        uint32_t time_since_search,
+                        bool new_contact,
+                        uint8_t contact_peak_rssi);
+
+  uint8_t period(void) { return _period; }
+  uint16_t write_count(void) { return _write_cnt; } // SSC_WR issued
+};
+
+#endif
@@ -0,0 +1,184 @@
+/******************************************************************************************
+ * File:        astronode_stats.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+
+#include "astronode_stats.h"
+
+ans_status_e ASTRONODE_CONTACT_STATS::update(uint32_t now)
+{
+  ans_status_e ret_val = _modem->read_last_contact_details();
+  if (ret_val == ANS_STATUS_SUCCESS)
+  {
+    add_lcd(_modem->lcd_struct, now);
+  }
+  return ret_val;
+}
+
+void ASTRONODE_CONTACT_STATS::add_lcd(const ASTRONODE::ASTRONODE_LCD_STRUCT &lcd,
+                                      uint32_t now)
+{
+  // Hour slot bookkeeping
+  uint32_t slot = now / 3600;
+  if (slot != _slot)
+  {
+    close_slot();
+    _slot = slot;
+    _slot_contact = false;
+  }
+
+  // New contact since the previous update: the end of the last contact increases. It goes back (to 0) after a module
+  // reset, which only takes the new reference, as does the first update.
+  if (_primed && lcd.time_end_last_contact > _last_contact_end)
+  {
+    uint32_t duration = (lcd.time_end_last_contact >= lcd.time_start_last_contact)
+                            ? lcd.time_end_last_contact - lcd.time_start_last_contact
+                            : 0;
+    add_sample(_rssi_hist, rssi_bin(lcd.peak_rssi_last_contact));
+    add_sample(_duration_hist, duration_bin(duration));
+    _slot_contact = true;
+    _contact_cnt++;
+  }
+  _last_contact_end = lcd.time_end_last_contact;
+  _primed = true;
+}
+
+void ASTRONODE_CONTACT_STATS::close_slot(void)
+{
+  if (_slot == 0)
+  {
+    return;
+  }
+
+  uint8_t hour = _slot % 24;
+  if (_hour_observed[hour] >= ASTRONODE_STATS_HISTORY)
+  {
+    _hour_observed[hour] /= 2;
+    _hour_contact[hour] /= 2;
+  }
+  _hour_observed[hour]++;
+  if (_slot_contact)
+  {
+    _hour_contact[hour]++;
+  }
+}
+
+void ASTRONODE_CONTACT_STATS::add_sample(uint8_t *hist,
+                                         uint8_t bin)
+{
+  uint16_t total = 0;
+  for (uint8_t i = 0; i < ASTRONODE_STATS_BINS; i++)
+  {
+    total += hist[i];
+  }
+  if (total >= ASTRONODE_STATS_HISTORY)
+  {
+    for (uint8_t i = 0; i < ASTRONODE_STATS_BINS; i++)
+    {
+      hist[i] /= 2;
+    }
+  }
+  hist[bin]++;
+}
+
+void ASTRONODE_CONTACT_STATS::clear(void)
+{
+  memset(_rssi_hist, 0, sizeof(_rssi_hist));
+  memset(_duration_hist, 0, sizeof(_duration_hist));
+  memset(_hour_observed, 0, sizeof(_hour_observed));
+  memset(_hour_contact, 0, sizeof(_hour_contact));
+  _contact_cnt = 0;
+  _primed = false;
+  _slot = 0;
+  _slot_contact = false;
+}
+
+uint8_t ASTRONODE_CONTACT_STATS::rssi_bin(uint8_t rssi)
+{
+  uint8_t bin = rssi / ASTRONODE_STATS_RSSI_BIN_WIDTH;
+  return (bin < ASTRONODE_STATS_BINS) ? bin : ASTRONODE_STATS_BINS - 1;
+}
+
+uint8_t ASTRONODE_CONTACT_STATS::duration_bin(uint32_t duration)
+{
+  // [0, 15], ]15, 30], ]30, 60], ... open-ended last bin
+  uint8_t bin = 0;
+  uint32_t bound = ASTRONODE_STATS_DURATION_BIN;
+  while (duration > bound && bin < ASTRONODE_STATS_BINS - 1)
+  {
+    bound *= 2;
+    bin++;
+  }
+  return bin;
+}
+
+uint16_t ASTRONODE_CONTACT_STATS::contact_probability(uint8_t hour)
+{
+  hour %= 24;
+  if (_hour_observed[hour] == 0)
+  {
+    return STATS_PROBABILITY_UNKNOWN;
+  }
+  return (uint16_t)(((uint32_t)_hour_contact[hour] * 1000) / _hour_observed[hour]);
+}
+
+int8_t ASTRONODE_CONTACT_STATS::best_hour(uint8_t from_hour,
+                                          uint8_t hours)
+{
+  int8_t best = -1;
+  uint16_t best_probability = 0;
+  for (uint8_t k = 0; k < hours && k < 24; k++)
+  {
+    uint8_t hour = (from_hour + k) % 24;
+    uint16_t probability = contact_probability(hour);
+    if (probability != STATS_PROBABILITY_UNKNOWN && (best < 0 || probability > best_probability))
+    {
+      best = hour;
+      best_probability = probability;
+    }
+  }
+  return best;
+}
+
+uint8_t ASTRONODE_CONTACT_STATS::rssi_percentile(uint8_t percent)
+{
+  uint16_t total = 0;
+  for (uint8_t i = 0; i < ASTRONODE_STATS_BINS; i++)
+  {
+    total += _rssi_hist[i];
+  }
+
+  uint16_t cumulated = 0;
+  for (uint8_t i = 0; i < ASTRONODE_STATS_BINS; i++)
+  {
+    cumulated += _rssi_hist[i];
+    if (total > 0 && (uint32_t)cumulated * 100 >= (uint32_t)total * percent)
+    {
+      return i * ASTRONODE_STATS_RSSI_BIN_WIDTH;
+    }
+  }
+  return 0;
+}
+
+uint32_t ASTRONODE_CONTACT_STATS::duration_percentile(uint8_t percent)
+{
+  uint16_t total = 0;
+  for (uint8_t i = 0; i < ASTRONODE_STATS_BINS; i++)
+  {
+    total += _duration_hist[i];
+  }
+
+  uint16_t cumulated = 0;
+  uint32_t bound = ASTRONODE_STATS_DURATION_BIN;
+  for (uint8_t i = 0; i < ASTRONODE_STATS_BINS; i++)
+  {
+    cumulated += _duration_hist[i];
+    if (total > 0 && (uint32_t)cumulated * 100 >= (uint32_t)total * percent)
+    {
+      return bound;
+    }
+    bound *= 2;
+  }
+  return 0;
+}
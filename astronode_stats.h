@@ -0,0 +1,76 @@
+/******************************************************************************************
+ * File:        astronode_stats.h
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * Contact statistics in fixed memory (about 100 bytes), built from the last contact details:
+ *   - histogram of the contact peak RSSI
+ *   - histogram of the contact duration (bins doubling from 15 s)
+ *   - hour-of-day table of the probability to get a contact within that hour
+ *
+ * A contact is counted when time_end_last_contact increases (it goes back to 0 after a
+ * module reset, which is not a contact), and attributed to the hour of the update which
+ * sees it: call update() (or add_lcd() with a snapshot) at least every 15 minutes. Histograms and table are halved when they reach ASTRONODE_STATS_HISTORY
+ * samples, so recent history weighs more.
+ ****************************************************************************************/
+
+#ifndef _ASTRONODE_STATS_h
+#define _ASTRONODE_STATS_h
+
+#include "astronode.h"
+
+#define ASTRONODE_STATS_BINS 8
+#define ASTRONODE_STATS_RSSI_BIN_WIDTH 4 // Peak RSSI units per bin, the last bin is open-ended
+#define ASTRONODE_STATS_DURATION_BIN 15  // s, upper bound of the first duration bin
+#define ASTRONODE_STATS_HISTORY 64       // Samples per histogram and per hour before halving
+
+#define STATS_PROBABILITY_UNKNOWN 0xFFFF // Hour never observed
+
+class ASTRONODE_CONTACT_STATS
+{
+
+private:
+  ASTRONODE *_modem;
+
+  uint8_t _rssi_hist[ASTRONODE_STATS_BINS] = {};
+  uint8_t _duration_hist[ASTRONODE_STATS_BINS] = {};
+  uint8_t _hour_observed[24] = {}; // Hour slots observed
+  uint8_t _hour_contact[24] = {};  // Hour slots with at least one contact
+  uint16_t _contact_cnt = 0;
+
+  // Current observation
+  bool _primed = false;
+  uint32_t _last_contact_end = 0;
+  uint32_t _slot = 0; // Current hour slot (unix time / 3600), 0 if none
+  bool _slot_contact = false;
+
+  void add_sample(uint8_t *hist,
+                  uint8_t bin);
+  void close_slot(void);
+
+public:
+  ASTRONODE_CONTACT_STATS(ASTRONODE &modem) : _modem(&modem) {}
+
+  // Read the last contact details and update the statistics. now is the unix time (e.g. from rtc_read()).
+  ans_status_e update(uint32_t now);
+  // Same with last contact details already read (lcd_struct, or a snapshot)
+  void add_lcd(const ASTRONODE::ASTRONODE_LCD_STRUCT &lcd,
+               uint32_t now);
+  void clear(void);
+
+  uint16_t contact_count(void) { return _contact_cnt; }
+  uint8_t rssi_histogram(uint8_t bin) { return (bin < ASTRONODE_STATS_BINS) ? _rssi_hist[bin] : 0; }
+  uint8_t duration_histogram(uint8_t bin) { return (bin < ASTRONODE_STATS_BINS) ? _duration_hist[bin] : 0; }
+  uint8_t rssi_bin(uint8_t rssi);
+  uint8_t duration_bin(uint32_t duration);
+
+  // Predictions
+  uint16_t contact_probability(uint8_t hour); // per mille, STATS_PROBABILITY_UNKNOWN if never observed
+  int8_t best_hour(uint8_t from_hour,
+                   uint8_t hours); // Most likely hour in [from_hour, from_hour + hours), -1 if none observed
+  uint8_t rssi_percentile(uint8_t percent);    // Lower bound of the RSSI bin reached by percent of the contacts
+  uint32_t duration_percentile(uint8_t percent); // Upper bound [s] of the duration bin reached by percent of the contacts
+};
+
+#endif
@@ -0,0 +1,145 @@
+/******************************************************************************************
+ * File:        astronode_time.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+
+#include "astronode_time.h"
+
+ans_status_e ASTRONODE_TIME::sync(void)
+{
+  // Poll the RTC until its second changes, the edge is between the last two requests
+  uint32_t first_time;
+  unsigned long start = millis();
+  ans_status_e ret_val = _modem->rtc_read(&first_time);
+  unsigned long previous = (start + millis()) / 2;
+  if (ret_val != ANS_STATUS_SUCCESS)
+  {
+    return ret_val;
+  }
+
+  uint32_t time = first_time;
+  unsigned long current = previous;
+  while (time == first_time)
+  {
+    if (millis() - start > 2000)
+    {
+      return ANS_STATUS_TIMEOUT; // RTC not running
+    }
+    while (millis() - current < ASTRONODE_TIME_EDGE_POLL)
+    {
+      delay(1);
+    }
+    previous = current;
+    unsigned long request_start = millis();
+    ret_val = _modem->rtc_read(&time);
+    current = request_start + (millis() - request_start) / 2;
+    if (ret_val != ANS_STATUS_SUCCESS)
+    {
+      return ret_val;
+    }
+  }
+  unsigned long edge_ms = previous + (current - previous) / 2;
+  uint32_t edge_error = (current - previous) / 2 + 1;
+
+  // Drift estimate from the previous base
+  if (_synced)
+  {
+    uint32_t local = edge_ms - _base_ms;
+    uint32_t reference = (time - _base_time) * 1000;
+    if (local >= (uint32_t)ASTRONODE_TIME_DRIFT_MIN_INTERVAL * 1000 &&
+        time >= _base_time && _last_rst == _modem->mst_struct.last_rst &&
+        _sleep_error == 0) // Sleeps are not timed by the local clock
+    {
+      int32_t ppm = (int32_t)(((int64_t)reference - (int64_t)local) * 1000000 / (int64_t)local);
+      if (ppm <= 2 * ASTRONODE_TIME_CLOCK_PPM && ppm >= -2 * ASTRONODE_TIME_CLOCK_PPM) // RTC not adjusted meanwhile
+      {
+        _drift_ppm = _drift_valid ? (_drift_ppm + ppm) / 2 : ppm;
+        _drift_valid = true;
+      }
+    }
+  }
+
+  _base_time = time;
+  _base_ms = edge_ms;
+  _sync_error = edge_error;
+  _sleep_error = 0;
+  _last_rst = _modem->mst_struct.last_rst;
+  _uptime = _modem->mst_struct.uptime;
+  _synced = true;
+
+  return read_nco();
+}
+
+ans_status_e ASTRONODE_TIME::read_nco(void)
+{
+  uint32_t nco;
+  ans_status_e ret_val = _modem->read_next_contact_opportunity(&nco);
+  if (ret_val == ANS_STATUS_SUCCESS)
+  {
+    _nco = nco;
+  }
+  _nco_ms = millis(); // Also rate-limits the retries
+  return ret_val;
+}
+
+ans_status_e ASTRONODE_TIME::update(void)
+{
+  // Module reset since the sync (only seen if the module state is read by the application)
+  if (_synced &&
+      (_modem->mst_struct.last_rst != _last_rst || _modem->mst_struct.uptime < _uptime))
+  {
+    _synced = false;
+  }
+
+  if (!_synced || error_ms() > _max_error)
+  {
+    return sync();
+  }
+  if (nco() == 0 && millis() - _nco_ms >= (unsigned long)ASTRONODE_TIME_NCO_REFRESH * 1000)
+  {
+    return read_nco();
+  }
+  return ANS_STATUS_SUCCESS;
+}
+
+void ASTRONODE_TIME::slept(uint32_t sleep_ms)
+{
+  // Move the bases back as if millis() had advanced
+  _base_ms -= sleep_ms;
+  _nco_ms -= sleep_ms;
+  _sleep_error += (uint32_t)(((uint64_t)sleep_ms * ASTRONODE_TIME_SLEEP_PPM) / 1000000) + 1;
+}
+
+uint32_t ASTRONODE_TIME::elapsed_ms(void)
+{
+  // Local time since the base, corrected by the estimated drift
+  uint32_t elapsed = millis() - _base_ms;
+  return elapsed + (int32_t)(((int64_t)elapsed * _drift_ppm) / 1000000);
+}
+
+uint32_t ASTRONODE_TIME::now(void)
+{
+  return _base_time + elapsed_ms() / 1000;
+}
+
+uint64_t ASTRONODE_TIME::now_ms(void)
+{
+  return (uint64_t)_base_time * 1000 + elapsed_ms();
+}
+
+uint32_t ASTRONODE_TIME::nco(void)
+{
+  uint32_t elapsed = (millis() - _nco_ms) / 1000;
+  return (_nco > elapsed) ? _nco - elapsed : 0;
+}
+
+uint32_t ASTRONODE_TIME::error_ms(void)
+{
+  if (!_synced)
+  {
+    return 0xFFFFFFFF;
+  }
+  uint32_t ppm = _drift_valid ? ASTRONODE_TIME_RESIDUAL_PPM : ASTRONODE_TIME_CLOCK_PPM;
+  return _sync_error + _sleep_error + (uint32_t)(((uint64_t)(millis() - _base_ms) * ppm) / 1000000);
+}
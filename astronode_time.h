@@ -0,0 +1,82 @@
+/******************************************************************************************
+ * File:        astronode_time.h
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * Local time service: the module RTC and next contact opportunity are read once, then
+ * served from millis() without UART traffic.
+ *
+ * sync() polls the RTC until its second changes, so the local base is aligned within one
+ * request round trip rather than one second. That costs up to one second of RTC_RR
+ * requests back to back (one every ASTRONODE_TIME_EDGE_POLL ms, about 50) per sync, so the
+ * traffic is only reduced when the time is read much more often than it is synced. The
+ * local clock drift is estimated from
+ * successive syncs. update() only syncs again when the estimated error exceeds max_error,
+ * after a module reset (seen in mst_struct or reported with invalidate()), or re-reads the
+ * next contact opportunity once its countdown expired.
+ *
+ * millis() does not advance while the MCU sleeps in standby (e.g. Watchdog.sleep() on
+ * SAMD): report each sleep with slept(), otherwise now() lags behind by the time slept.
+ * The sleep timer tolerance (ASTRONODE_TIME_SLEEP_PPM) adds to the error, so update() syncs
+ * again when it exceeds max_error.
+ ****************************************************************************************/
+
+#ifndef _ASTRONODE_TIME_h
+#define _ASTRONODE_TIME_h
+
+#include "astronode.h"
+
+#define ASTRONODE_TIME_CLOCK_PPM 500          // Local clock tolerance before the drift is estimated
+#define ASTRONODE_TIME_RESIDUAL_PPM 20        // Local clock uncertainty once the drift is estimated
+#define ASTRONODE_TIME_DRIFT_MIN_INTERVAL 600 // s, minimum interval between syncs to estimate the drift
+#define ASTRONODE_TIME_NCO_REFRESH 60         // s, next contact opportunity read period once expired
+#define ASTRONODE_TIME_EDGE_POLL 20           // ms, RTC read period while waiting for the second edge
+#define ASTRONODE_TIME_SLEEP_PPM 20000        // Sleep timer tolerance (watchdog on the ultra low power oscillator)
+
+class ASTRONODE_TIME
+{
+
+private:
+  ASTRONODE *_modem;
+  uint32_t _max_error;
+
+  bool _synced = false;
+  uint32_t _base_time = 0;    // Unix time at _base_ms
+  unsigned long _base_ms = 0; // millis() at the RTC second edge
+  uint32_t _sync_error = 0;   // ms, error of the base itself
+  uint32_t _sleep_error = 0;  // ms, error of the sleeps reported since the base
+  int32_t _drift_ppm = 0;     // Local clock error (positive: millis() too slow)
+  bool _drift_valid = false;
+
+  uint32_t _nco = 0; // Next contact opportunity [s] at _nco_ms
+  unsigned long _nco_ms = 0;
+
+  uint8_t _last_rst = 0; // Module state at sync
+  uint32_t _uptime = 0;
+
+  uint32_t elapsed_ms(void);
+  ans_status_e read_nco(void);
+
+public:
+  ASTRONODE_TIME(ASTRONODE &modem,
+                 uint32_t max_error = 1000) : _modem(&modem), _max_error(max_error) {}
+
+  // Read RTC (second edge) and next contact opportunity
+  ans_status_e sync(void);
+  // Call from the main loop: only accesses the module when needed
+  ans_status_e update(void);
+  // Force a sync on the next update() (e.g. module reset event)
+  void invalidate(void) { _synced = false; }
+  // MCU sleep not counted by millis(), e.g. Watchdog.sleep() result
+  void slept(uint32_t sleep_ms);
+
+  bool synced(void) { return _synced; }
+  uint32_t now(void);    // Unix time [s]
+  uint64_t now_ms(void); // Unix time [ms]
+  uint32_t nco(void);    // Next contact opportunity [s], 0 when expired
+  uint32_t error_ms(void);
+  int32_t drift_ppm(void) { return _drift_ppm; }
+};
+
+#endif
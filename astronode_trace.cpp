@@ -0,0 +1,321 @@
+/******************************************************************************************
+ * File:        astronode_trace.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+
+#include "astronode_trace.h"
+
+int ASTRONODE_TRACE_RECORDER::read(void)
+{
+  int c = _port->read();
+  if (c >= 0)
+  {
+    log((uint8_t)c, true);
+  }
+  return c;
+}
+
+size_t ASTRONODE_TRACE_RECORDER::write(uint8_t c)
+{
+  size_t written = _port->write(c);
+  if (written == 1)
+  {
+    log(c, false);
+  }
+  return written;
+}
+
+size_t ASTRONODE_TRACE_RECORDER::write(const uint8_t *buffer,
+                                       size_t size)
+{
+  size_t written = _port->write(buffer, size);
+  for (size_t i = 0; i < written; i++)
+  {
+    log(buffer[i], false);
+  }
+  return written;
+}
+
+void ASTRONODE_TRACE_RECORDER::log(uint8_t c,
+                                   bool rx)
+{
+  unsigned long now = micros();
+  if (_record_length > 0 &&
+      (rx != _record_rx ||
+       _record_length == sizeof(_record) ||
+       now - _last_byte > ASTRONODE_TRACE_GAP_US))
+  {
+    trace_flush();
+  }
+  if (_record_length == 0)
+  {
+    _record_rx = rx;
+    _record_start = now;
+  }
+  _record[_record_length++] = c;
+  _last_byte = now;
+}
+
+void ASTRONODE_TRACE_RECORDER::trace_write(uint8_t c)
+{
+  if (_trace->write(c) != 1)
+  {
+    _dropped++;
+  }
+}
+
+void ASTRONODE_TRACE_RECORDER::trace_flush(void)
+{
+  if (_record_length == 0)
+  {
+    return;
+  }
+
+  if (!_started)
+  {
+    const char *magic = ASTRONODE_TRACE_MAGIC;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+      trace_write(magic[i]);
+    }
+    _previous_start = _record_start;
+    _started = true;
+  }
+
+  trace_write((_record_rx ? TRACE_FLAG_RX : 0) | (_record_length - 1));
+  uint32_t delay_us = _record_start - _previous_start;
+  do
+  {
+    uint8_t b = delay_us & 0x7F;
+    delay_us >>= 7;
+    trace_write(b | ((delay_us != 0) ? 0x80 : 0));
+  } while (delay_us != 0);
+  for (uint8_t i = 0; i < _record_length; i++)
+  {
+    trace_write(_record[i]);
+  }
+
+  _previous_start = _record_start;
+  _record_length = 0;
+}
+
+#if defined(ASTRONODE_HOST)
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ASTRONODE_TRACE_FILE::~ASTRONODE_TRACE_FILE()
+{
+  close();
+}
+
+bool ASTRONODE_TRACE_FILE::open(const char *path)
+{
+  close();
+  _fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  return _fd >= 0;
+}
+
+void ASTRONODE_TRACE_FILE::close(void)
+{
+  if (_fd >= 0)
+  {
+    ::close(_fd);
+  }
+  _fd = -1;
+}
+
+size_t ASTRONODE_TRACE_FILE::write(const uint8_t *buffer,
+                                   size_t size)
+{
+  if (_fd < 0)
+  {
+    return 0;
+  }
+  ssize_t written = ::write(_fd, buffer, size);
+  return (written > 0) ? (size_t)written : 0;
+}
+
+ASTRONODE_TRACE_PLAYER::~ASTRONODE_TRACE_PLAYER()
+{
+  close();
+}
+
+bool ASTRONODE_TRACE_PLAYER::open(const char *path,
+                                  uint16_t speed)
+{
+  close();
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  struct stat st;
+  uint8_t *trace = NULL;
+  bool ok = (fstat(fd, &st) == 0 && st.st_size > 0);
+  if (ok)
+  {
+    trace = (uint8_t *)malloc(st.st_size);
+    ok = (trace != NULL && ::read(fd, trace, st.st_size) == st.st_size);
+  }
+  ::close(fd);
+
+  if (ok && attach(trace, st.st_size, speed))
+  {
+    _owns_trace = true;
+    return true;
+  }
+  free(trace);
+  return false;
+}
+
+bool ASTRONODE_TRACE_PLAYER::attach(const uint8_t *trace,
+                                    size_t length,
+                                    uint16_t speed)
+{
+  close();
+  if (length < 4 || memcmp(trace, ASTRONODE_TRACE_MAGIC, 4) != 0)
+  {
+    return false;
+  }
+
+  _trace = (uint8_t *)trace;
+  _trace_length = length;
+  _speed = speed;
+  _next = 4;
+  _time = 0;
+  _anchor = micros();
+  _anchor_time = 0;
+  _mismatches = 0;
+  next_record();
+  return true;
+}
+
+void ASTRONODE_TRACE_PLAYER::close(void)
+{
+  if (_owns_trace)
+  {
+    free(_trace);
+  }
+  _trace = NULL;
+  _trace_length = 0;
+  _owns_trace = false;
+  _next = 0;
+  _remaining = 0;
+}
+
+void ASTRONODE_TRACE_PLAYER::next_record(void)
+{
+  _remaining = 0;
+  if (_next >= _trace_length)
+  {
+    return;
+  }
+
+  uint8_t flags = _trace[_next++];
+  uint32_t delay_us = 0;
+  uint8_t shift = 0;
+  while (_next < _trace_length)
+  {
+    uint8_t b = _trace[_next++];
+    delay_us |= (uint32_t)(b & 0x7F) << shift;
+    shift += 7;
+    if ((b & 0x80) == 0 || shift > 28)
+    {
+      break;
+    }
+  }
+
+  uint8_t length = (flags & 0x7F) + 1;
+  if (_next + length > _trace_length)
+  {
+    _next = _trace_length; // Truncated trace
+    return;
+  }
+  _rx = (flags & TRACE_FLAG_RX) != 0;
+  _data = &_trace[_next];
+  _remaining = length;
+  _time += delay_us;
+  _next += length;
+}
+
+bool ASTRONODE_TRACE_PLAYER::rx_ready(void)
+{
+  if (_remaining == 0 || !_rx)
+  {
+    return false; // Waiting for the request bytes
+  }
+  if (_speed == 0 || _time <= _anchor_time)
+  {
+    return true;
+  }
+  uint64_t elapsed = (uint64_t)(micros() - _anchor) * _speed;
+  return elapsed >= _time - _anchor_time;
+}
+
+int ASTRONODE_TRACE_PLAYER::available(void)
+{
+  return rx_ready() ? _remaining : 0;
+}
+
+int ASTRONODE_TRACE_PLAYER::peek(void)
+{
+  return rx_ready() ? *_data : -1;
+}
+
+int ASTRONODE_TRACE_PLAYER::read(void)
+{
+  if (!rx_ready())
+  {
+    return -1;
+  }
+  uint8_t c = *_data++;
+  if (--_remaining == 0)
+  {
+    next_record();
+  }
+  return c;
+}
+
+size_t ASTRONODE_TRACE_PLAYER::write(uint8_t c)
+{
+  // Module bytes not read by the library are skipped, as a real module answer would be lost
+  while (_remaining > 0 && _rx)
+  {
+    next_record();
+  }
+
+  if (_remaining == 0)
+  {
+    _mismatches++; // Beyond the end of the trace
+    return 1;
+  }
+  if (*_data != c)
+  {
+    _mismatches++;
+  }
+  _data++;
+  if (--_remaining == 0)
+  {
+    // Request written: the next module bytes are timed from now
+    _anchor = micros();
+    _anchor_time = _time;
+    next_record();
+  }
+  return 1;
+}
+
+size_t ASTRONODE_TRACE_PLAYER::write(const uint8_t *buffer,
+                                     size_t size)
+{
+  for (size_t i = 0; i < size; i++)
+  {
+    write(buffer[i]);
+  }
+  return size;
+}
+
+#endif
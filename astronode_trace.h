@@ -0,0 +1,144 @@
+/******************************************************************************************
+ * File:        astronode_trace.h
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * UART session record and replay.
+ *
+ * ASTRONODE_TRACE_RECORDER wraps the Stream given to ASTRONODE::begin() and logs every byte
+ * written and read into a binary trace on any Print (SD card file, host file, ...).
+ * ASTRONODE_TRACE_PLAYER (host only) is a Stream playing a trace back to ASTRONODE: module
+ * bytes become available once the preceding request bytes were written and the recorded
+ * delay elapsed, at original speed or accelerated.
+ *
+ * Trace format:
+ *   "ANT1"
+ *   records: [flags: bit 7 set for module -> asset, bits 0-6 length - 1]
+ *            [delay since the previous record start, us, LEB128 varint]
+ *            [length data bytes]
+ ****************************************************************************************/
+
+#ifndef _ASTRONODE_TRACE_h
+#define _ASTRONODE_TRACE_h
+
+#include "astronode.h"
+
+#define ASTRONODE_TRACE_MAGIC "ANT1"
+#define ASTRONODE_TRACE_RECORD_SIZE 32 // Bytes per record, up to 128
+#define ASTRONODE_TRACE_GAP_US 2000    // A new record is started after this silence
+#define TRACE_FLAG_RX (1 << 7)
+
+class ASTRONODE_TRACE_RECORDER : public Stream
+{
+
+private:
+  Stream *_port;
+  Print *_trace;
+
+  uint8_t _record[ASTRONODE_TRACE_RECORD_SIZE];
+  uint8_t _record_length = 0;
+  bool _record_rx = false;
+  unsigned long _record_start = 0; // micros()
+  unsigned long _last_byte = 0;
+  unsigned long _previous_start = 0;
+  bool _started = false;
+  uint32_t _dropped = 0; // Trace bytes the sink could not take
+
+  void log(uint8_t c,
+           bool rx);
+  void trace_write(uint8_t c);
+
+public:
+  ASTRONODE_TRACE_RECORDER(Stream &port,
+                           Print &trace) : _port(&port), _trace(&trace) {}
+
+  // Write the pending record to the trace (e.g. before closing the trace file)
+  void trace_flush(void);
+  uint32_t trace_dropped(void) { return _dropped; }
+
+  int available(void) { return _port->available(); }
+  int read(void);
+  int peek(void) { return _port->peek(); }
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *buffer,
+               size_t size);
+  void flush(void) { _port->flush(); }
+
+  using Print::write;
+};
+
+#if defined(ASTRONODE_HOST)
+
+// Trace sink on a host file
+class ASTRONODE_TRACE_FILE : public Print
+{
+
+private:
+  int _fd = -1;
+
+public:
+  ~ASTRONODE_TRACE_FILE();
+
+  bool open(const char *path);
+  void close(void);
+
+  size_t write(uint8_t c) { return write(&c, 1); }
+  size_t write(const uint8_t *buffer,
+               size_t size);
+
+  using Print::write;
+};
+
+class ASTRONODE_TRACE_PLAYER : public Stream
+{
+
+private:
+  uint8_t *_trace = NULL;
+  size_t _trace_length = 0;
+  bool _owns_trace = false;
+  uint16_t _speed = 1;
+
+  // Current record
+  size_t _next = 0;     // Offset of the next record in the trace
+  bool _rx = false;
+  const uint8_t *_data = NULL;
+  uint8_t _remaining = 0;
+  uint64_t _time = 0;   // Record start in trace time [us]
+
+  // Module bytes are timed from the last request byte written
+  unsigned long _anchor = 0; // micros()
+  uint64_t _anchor_time = 0; // trace time
+
+  uint32_t _mismatches = 0;
+
+  void next_record(void);
+  bool rx_ready(void);
+
+public:
+  ~ASTRONODE_TRACE_PLAYER();
+
+  // speed: 1 original timing, N N times faster, 0 without any delay
+  bool open(const char *path,
+            uint16_t speed = 1);
+  bool attach(const uint8_t *trace,
+              size_t length,
+              uint16_t speed = 1);
+  void close(void);
+
+  bool done(void) { return _remaining == 0 && _next >= _trace_length; }
+  uint32_t mismatches(void) { return _mismatches; } // Written bytes differing from the recorded requests
+
+  int available(void);
+  int read(void);
+  int peek(void);
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *buffer,
+               size_t size);
+
+  using Print::write;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,411 @@
+/******************************************************************************************
+ * File:        astronode_uplink.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+
+#include "astronode_uplink.h"
+
+ASTRONODE_UPLINK::ASTRONODE_UPLINK(ASTRONODE &modem)
+{
+  _modem = &modem;
+  memset(_entries, 0, sizeof(_entries));
+}
+
+ans_status_e ASTRONODE_UPLINK::enqueue_payload(uint8_t *data,
+                                               uint8_t length,
+                                               uint16_t id,
+                                               uint8_t priority)
+{
+  return add(data, length, id, priority, UPLINK_NO_KEY);
+}
+
+ans_status_e ASTRONODE_UPLINK::enqueue_latest(uint8_t *data,
+                                              uint8_t length,
+                                              uint16_t id,
+                                              uint8_t key,
+                                              uint8_t priority)
+{
+  if (key == UPLINK_NO_KEY)
+  {
+    return ANS_STATUS_ARG_NOT_VALID;
+  }
+  return add(data, length, id, priority, key);
+}
+
+ans_status_e ASTRONODE_UPLINK::add(uint8_t *data,
+                                   uint8_t length,
+                                   uint16_t id,
+                                   uint8_t priority,
+                                   uint8_t key)
+{
+  if (length > ASN_MAX_MSG_SIZE)
+  {
+    return ANS_STATUS_PAYLOAD_TOO_LONG;
+  }
+  if (find(id) >= 0)
+  {
+    return ANS_STATUS_DUPLICATE_ID;
+  }
+
+  ans_status_e ret_val = ANS_STATUS_SUCCESS;
+  if (key != UPLINK_NO_KEY)
+  {
+    int8_t stale = find_key(key);
+    if (stale >= 0)
+    {
+      ret_val = supersede(stale);
+      if (ret_val != ANS_STATUS_SUCCESS)
+      {
+        fill(); // Enqueue again the payloads already displaced
+        return ret_val;
+      }
+    }
+  }
+
+  int8_t i = free_entry(priority);
+  if (i < 0)
+  {
+    fill(); // Enqueue again the payloads displaced by the supersede, if any
+    return ANS_STATUS_BUFFER_FULL;
+  }
+
+  ASTRONODE_UPLINK_ENTRY *e = &_entries[i];
+  e->used = true;
+  e->in_module = false;
+  e->displaced = false;
+  e->priority = priority;
+  e->key = key;
+  e->id = id;
+  e->seq = _seq++;
+  e->length = length;
+  memcpy(e->data, data, length);
+
+  if (priority >= UPLINK_PRIORITY_HIGH)
+  {
+    ret_val = preempt(priority);
+    if (ret_val != ANS_STATUS_SUCCESS)
+    {
+      // Not accepted: release it, and enqueue again the payloads already displaced
+      e->used = false;
+      fill();
+      return ret_val;
+    }
+  }
+  ret_val = fill();
+  if (ret_val == ANS_STATUS_SUCCESS && !e->in_module)
+  {
+    ret_val = ANS_STATUS_PENDING;
+  }
+  return ret_val;
+}
+
+ans_status_e ASTRONODE_UPLINK::service(void)
+{
+  ans_status_e ret_val = _modem->read_module_state();
+  if (ret_val != ANS_STATUS_SUCCESS)
+  {
+    return ret_val;
+  }
+
+  // Payloads leave the module queue in order: release the oldest ones
+  uint8_t in_module = in_module_count();
+  uint8_t queued = _modem->mst_struct.msg_in_queue;
+  while (in_module > queued)
+  {
+    int8_t i = module_head();
+    _entries[i].used = false;
+    _entries[i].in_module = false;
+    in_module--;
+  }
+
+  return fill();
+}
+
+void ASTRONODE_UPLINK::acknowledged(uint16_t id)
+{
+  int8_t i = find(id);
+  if (i >= 0)
+  {
+    _entries[i].used = false;
+    _entries[i].in_module = false;
+  }
+}
+
+ans_status_e ASTRONODE_UPLINK::pop_module_tail(int8_t tail,
+                                               bool requeue)
+{
+  // Remove the last payload of the module queue, it becomes a displaced waiting payload
+  uint16_t id = 0;
+  ans_status_e ret_val = _modem->dequeue_payload(&id, requeue);
+  if (ret_val == ANS_STATUS_BUFFER_EMPTY)
+  {
+    // Module queue already empty: all payloads were sent
+    for (uint8_t i = 0; i < ASTRONODE_UPLINK_SIZE; i++)
+    {
+      if (_entries[i].used && _entries[i].in_module)
+      {
+        _entries[i].used = false;
+        _entries[i].in_module = false;
+      }
+    }
+    return ANS_STATUS_SUCCESS;
+  }
+  if (ret_val != ANS_STATUS_SUCCESS)
+  {
+    return ret_val;
+  }
+
+  int8_t popped = find(id);
+  if (popped >= 0)
+  {
+    _entries[popped].in_module = false;
+    _entries[popped].displaced = true;
+    _displaced_cnt++;
+  }
+  if (popped != tail)
+  {
+    // The module did not remove the last payload queued: stop there, the one removed
+    // (if known) is enqueued again by fill()
+    return ANS_STATUS_PAYLOD_ID_CHECK_FAILED;
+  }
+  return ANS_STATUS_SUCCESS;
+}
+
+ans_status_e ASTRONODE_UPLINK::preempt(uint8_t priority)
+{
+  // Remove the lower priority payloads from the tail of the module queue, down to the head (may be in transmission)
+  while (true)
+  {
+    int8_t t = module_tail();
+    if (t < 0 || _entries[t].priority >= priority || t == module_head())
+    {
+      return ANS_STATUS_SUCCESS;
+    }
+
+    ans_status_e ret_val = pop_module_tail(t, true);
+    if (ret_val != ANS_STATUS_SUCCESS)
+    {
+      return ret_val;
+    }
+  }
+}
+
+ans_status_e ASTRONODE_UPLINK::supersede(int8_t stale)
+{
+  // Pop the module queue down to the stale payload, the ones after it are enqueued again by fill()
+  while (_entries[stale].used && _entries[stale].in_module)
+  {
+    if (stale == module_head())
+    {
+      break; // May be in transmission: keep it
+    }
+
+    int8_t t = module_tail();
+    ans_status_e ret_val = pop_module_tail(t, t != stale); // The stale payload is not enqueued again
+    if (ret_val != ANS_STATUS_SUCCESS)
+    {
+      return ret_val;
+    }
+  }
+
+  // Drop it unless it is still in the module
+  if (_entries[stale].used && !_entries[stale].in_module)
+  {
+    _entries[stale].used = false;
+    _superseded_cnt++;
+  }
+  else if (_entries[stale].used)
+  {
+    _entries[stale].key = UPLINK_NO_KEY; // Sent anyway, the new payload holds the key
+  }
+  return ANS_STATUS_SUCCESS;
+}
+
+ans_status_e ASTRONODE_UPLINK::fill(void)
+{
+  // Enqueue waiting payloads, highest priority first, as long as the module accepts them
+  while (true)
+  {
+    int8_t i = next_waiting();
+    if (i < 0)
+    {
+      return ANS_STATUS_SUCCESS;
+    }
+
+    ASTRONODE_UPLINK_ENTRY *e = &_entries[i];
+    ans_status_e ret_val = _modem->enqueue_payload(e->data, e->length, e->id);
+    if (ret_val == ANS_STATUS_BUFFER_FULL)
+    {
+      return ANS_STATUS_SUCCESS; // Wait for room
+    }
+    if (ret_val != ANS_STATUS_SUCCESS && ret_val != ANS_STATUS_DUPLICATE_ID) // Duplicate: already in the module
+    {
+      return ret_val;
+    }
+    e->in_module = true;
+    e->displaced = false;
+    e->module_seq = _module_seq++;
+  }
+}
+
+int8_t ASTRONODE_UPLINK::find(uint16_t id)
+{
+  for (uint8_t i = 0; i < ASTRONODE_UPLINK_SIZE; i++)
+  {
+    if (_entries[i].used && _entries[i].id == id)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int8_t ASTRONODE_UPLINK::find_key(uint8_t key)
+{
+  for (uint8_t i = 0; i < ASTRONODE_UPLINK_SIZE; i++)
+  {
+    if (_entries[i].used && _entries[i].key == key)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int32_t ASTRONODE_UPLINK::latest_id(uint8_t key)
+{
+  int8_t i = (key != UPLINK_NO_KEY) ? find_key(key) : -1;
+  return (i >= 0) ? (int32_t)_entries[i].id : -1;
+}
+
+int8_t ASTRONODE_UPLINK::next_waiting(void)
+{
+  int8_t best = -1;
+  for (uint8_t i = 0; i < ASTRONODE_UPLINK_SIZE; i++)
+  {
+    ASTRONODE_UPLINK_ENTRY *e = &_entries[i];
+    if (!e->used || e->in_module)
+    {
+      continue;
+    }
+    if (best < 0 ||
+        e->priority > _entries[best].priority ||
+        (e->priority == _entries[best].priority && (int16_t)(e->seq - _entries[best].seq) < 0))
+    {
+      best = i;
+    }
+  }
+  return best;
+}
+
+int8_t ASTRONODE_UPLINK::module_tail(void)
+{
+  int8_t tail = -1;
+  for (uint8_t i = 0; i < ASTRONODE_UPLINK_SIZE; i++)
+  {
+    if (_entries[i].used && _entries[i].in_module &&
+        (tail < 0 || (int16_t)(_entries[i].module_seq - _entries[tail].module_seq) > 0))
+    {
+      tail = i;
+    }
+  }
+  return tail;
+}
+
+int8_t ASTRONODE_UPLINK::module_head(void)
+{
+  int8_t head = -1;
+  for (uint8_t i = 0; i < ASTRONODE_UPLINK_SIZE; i++)
+  {
+    if (_entries[i].used && _entries[i].in_module &&
+        (head < 0 || (int16_t)(_entries[i].module_seq - _entries[head].module_seq) < 0))
+    {
+      head = i;
+    }
+  }
+  return head;
+}
+
+int8_t ASTRONODE_UPLINK::free_entry(uint8_t priority)
+{
+  for (uint8_t i = 0; i < ASTRONODE_UPLINK_SIZE; i++)
+  {
+    if (!_entries[i].used)
+    {
+      return i;
+    }
+  }
+
+  // Full: drop the newest waiting payload of the lowest priority, if lower than the new one
+  int8_t victim = -1;
+  for (uint8_t i = 0; i < ASTRONODE_UPLINK_SIZE; i++)
+  {
+    ASTRONODE_UPLINK_ENTRY *e = &_entries[i];
+    if (e->in_module || e->priority >= priority)
+    {
+      continue;
+    }
+    if (victim < 0 ||
+        e->priority < _entries[victim].priority ||
+        (e->priority == _entries[victim].priority && (int16_t)(e->seq - _entries[victim].seq) > 0))
+    {
+      victim = i;
+    }
+  }
+  if (victim >= 0)
+  {
+    _entries[victim].used = false;
+    if (_dropped_cb != NULL)
+    {
+      _dropped_cb(_entries[victim].id);
+    }
+  }
+  return victim;
+}
+
+uint8_t ASTRONODE_UPLINK::in_module_count(void)
+{
+  uint8_t cnt = 0;
+  for (uint8_t i = 0; i < ASTRONODE_UPLINK_SIZE; i++)
+  {
+    if (_entries[i].used && _entries[i].in_module)
+    {
+      cnt++;
+    }
+  }
+  return cnt;
+}
+
+uint8_t ASTRONODE_UPLINK::waiting_count(void)
+{
+  uint8_t cnt = 0;
+  for (uint8_t i = 0; i < ASTRONODE_UPLINK_SIZE; i++)
+  {
+    if (_entries[i].used && !_entries[i].in_module)
+    {
+      cnt++;
+    }
+  }
+  return cnt;
+}
+
+uint8_t ASTRONODE_UPLINK::displaced_ids(uint16_t *ids,
+                                        uint8_t max_ids)
+{
+  uint8_t cnt = 0;
+  for (uint8_t i = 0; i < ASTRONODE_UPLINK_SIZE && cnt < max_ids; i++)
+  {
+    if (_entries[i].used && _entries[i].displaced)
+    {
+      ids[cnt++] = _entries[i].id;
+    }
+  }
+  return cnt;
+}
+
+const ASTRONODE_UPLINK::ASTRONODE_UPLINK_ENTRY *ASTRONODE_UPLINK::entry(uint16_t id)
+{
+  int8_t i = find(id);
+  return (i >= 0) ? &_entries[i] : NULL;
+}
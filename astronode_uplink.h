@@ -0,0 +1,128 @@
+/******************************************************************************************
+ * File:        astronode_uplink.h
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * Priority-aware uplink queue. The module queue is FIFO (ASN_MSG_QUEUE_SIZE payloads), so
+ * a copy of each payload is kept here until it left the module queue:
+ *
+ *   - payloads are enqueued in the module by priority, then arrival order
+ *   - a payload with priority >= UPLINK_PRIORITY_HIGH preempts lower priority payloads:
+ *     they are removed from the tail of the module queue with dequeue_payload(), the payload
+ *     is enqueued, and the displaced payloads are enqueued again behind it as room allows.
+ *     The head of the module queue (may be in transmission) is never removed
+ *   - service() reads the module state to release the payloads which left the module
+ *     queue and enqueues the waiting ones
+ *
+ * So the time to uplink of a high priority payload does not depend on the number of lower
+ * priority payloads queued.
+ *
+ * enqueue_latest() gives latest-value semantics to state-type data (position, level, ...):
+ * a payload not sent yet with the same key is superseded. If it waits, it is replaced; if
+ * it is in the module queue, it is removed with dequeue_payload() (the payloads queued
+ * after it are displaced and enqueued again). A payload being transmitted (head of the
+ * module queue) cannot be removed.
+ *
+ * Both expect dequeue_payload() (PLD_DR) to remove the last payload queued, and check the
+ * ID it returns against the tail expected here. On a mismatch, the payload removed is
+ * enqueued again (if it is one of ours) and ANS_STATUS_PAYLOD_ID_CHECK_FAILED is returned.
+ * On this or any other error of the dequeue, the new payload is not kept: the call can be
+ * repeated with the same ID.
+ ****************************************************************************************/
+
+#ifndef _ASTRONODE_UPLINK_h
+#define _ASTRONODE_UPLINK_h
+
+#include "astronode.h"
+
+#define ASTRONODE_UPLINK_SIZE (ASN_MSG_QUEUE_SIZE + 4) // Payloads in the module queue and waiting
+
+// Priorities
+#define UPLINK_PRIORITY_LOW 0
+#define UPLINK_PRIORITY_NORMAL 1
+#define UPLINK_PRIORITY_HIGH 2 // Preempts lower priority payloads queued in the module
+
+#define UPLINK_NO_KEY 0
+
+class ASTRONODE_UPLINK
+{
+
+public:
+  typedef void (*uplink_dropped_cb_t)(uint16_t id);
+
+  typedef struct
+  {
+    bool used;
+    bool in_module;     // Enqueued in the module, waiting otherwise
+    bool displaced;     // Removed from the module queue by a higher priority payload, waiting to be enqueued again
+    uint8_t priority;
+    uint8_t key; // UPLINK_NO_KEY, or latest-value key
+    uint16_t id;
+    uint16_t seq;        // Arrival order
+    uint16_t module_seq; // Order in the module queue
+    uint8_t length;
+    uint8_t data[ASN_MAX_MSG_SIZE];
+  } ASTRONODE_UPLINK_ENTRY;
+
+private:
+  ASTRONODE *_modem;
+  ASTRONODE_UPLINK_ENTRY _entries[ASTRONODE_UPLINK_SIZE];
+  uint16_t _seq = 0;
+  uint16_t _module_seq = 0;
+  uint16_t _displaced_cnt = 0;
+  uint16_t _superseded_cnt = 0;
+  uplink_dropped_cb_t _dropped_cb = NULL;
+
+  int8_t find(uint16_t id);
+  int8_t find_key(uint8_t key);
+  int8_t next_waiting(void);
+  int8_t module_tail(void);
+  int8_t module_head(void);
+  int8_t free_entry(uint8_t priority);
+  ans_status_e pop_module_tail(int8_t tail,
+                               bool requeue);
+  ans_status_e preempt(uint8_t priority);
+  ans_status_e supersede(int8_t stale);
+  ans_status_e add(uint8_t *data,
+                   uint8_t length,
+                   uint16_t id,
+                   uint8_t priority,
+                   uint8_t key);
+  ans_status_e fill(void);
+
+public:
+  ASTRONODE_UPLINK(ASTRONODE &modem);
+
+  // ANS_STATUS_SUCCESS once the payload is enqueued in the module, ANS_STATUS_PENDING if it waits for room
+  ans_status_e enqueue_payload(uint8_t *data,
+                               uint8_t length,
+                               uint16_t id,
+                               uint8_t priority = UPLINK_PRIORITY_NORMAL);
+  // Same, superseding the payload with the same key (1 to 255) which was not sent yet
+  ans_status_e enqueue_latest(uint8_t *data,
+                              uint8_t length,
+                              uint16_t id,
+                              uint8_t key,
+                              uint8_t priority = UPLINK_PRIORITY_NORMAL);
+  // Release the payloads which left the module queue and enqueue the waiting ones. Call after each contact,
+  // or periodically.
+  ans_status_e service(void);
+  // Payload acknowledged by the satellite (read_satellite_ack())
+  void acknowledged(uint16_t id);
+
+  // A waiting payload was dropped to make room for a higher priority one (local queue full)
+  void onUplinkDropped(uplink_dropped_cb_t cb) { _dropped_cb = cb; }
+
+  uint8_t in_module_count(void);
+  uint8_t waiting_count(void);
+  uint8_t displaced_ids(uint16_t *ids,
+                        uint8_t max_ids); // IDs currently displaced
+  uint16_t displaced_total(void) { return _displaced_cnt; } // Payloads removed from the module queue
+  uint16_t superseded_total(void) { return _superseded_cnt; }
+  // ID of the payload holding the latest value of key, -1 if none
+  int32_t latest_id(uint8_t key);
+  const ASTRONODE_UPLINK_ENTRY *entry(uint16_t id);
+};
+
+#endif
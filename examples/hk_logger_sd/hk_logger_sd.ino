@@ -43,6 +43,7 @@ File logFile;
 
 bool save_hk_to_sd(uint32_t timestamp);
 bool save_command_to_sd(uint32_t timestamp, uint8_t data[40], uint32_t createdDate);
+bool on_command(uint8_t *data, uint8_t length, uint32_t createdDate);
 
 void setup()
 {
@@ -61,17 +62,16 @@ void setup()
         while (1)
             ;
     }
-    astronode.configuration_write(ASTRONODE_WITH_PLD_ACK,
-                                  ASTRONODE_WITH_GEO_LOC,
-                                  ASTRONODE_WITH_EPHEMERIS,
-                                  ASTRONODE_WITH_DEEP_SLEEP_EN,
-                                  ASTRONODE_WITH_MSG_ACK_PIN_EN,
-                                  ASTRONODE_WITH_MSG_RESET_PIN_EN,
-                                  ASTRONODE_WITH_CMD_EVENT_PIN_EN,
-                                  ASTRONODE_WITH_TX_PEND_EVENT_PIN_EN);
     astronode.satellite_search_config_write(SAT_SEARCH_2755_MS, true);
-    astronode.configuration_save();
-    astronode.configuration_read();
+    astronode.configuration_sync(ASTRONODE_WITH_PLD_ACK,
+                                 ASTRONODE_WITH_GEO_LOC,
+                                 ASTRONODE_WITH_EPHEMERIS,
+                                 ASTRONODE_WITH_DEEP_SLEEP_EN,
+                                 ASTRONODE_WITH_MSG_ACK_PIN_EN,
+                                 ASTRONODE_WITH_MSG_RESET_PIN_EN,
+                                 ASTRONODE_WITH_CMD_EVENT_PIN_EN,
+                                 ASTRONODE_WITH_TX_PEND_EVENT_PIN_EN);
+    astronode.onCommand(on_command);
 
     //Initialize SD card
     if (!SD.begin(PIN_SD_CS))
@@ -106,43 +106,8 @@ void loop()
         }
     }
 
-    //Querry and process events
-    uint8_t event_type;
-    astronode.event_read(&event_type);
-    switch (event_type)
-    {
-    case EVENT_MSG_ACK:
-    {
-        //If satellite ACK event, read and clear event to be able to queue a new message
-        uint16_t counter_read = 0;
-        if (astronode.read_satellite_ack(&counter_read) == ANS_STATUS_SUCCESS)
-        {
-            astronode.clear_satellite_ack();
-        }
-        break;
-    }
-    case EVENT_RESET:
-    {
-        //If reset event, clear event
-        astronode.clear_reset_event();
-        break;
-    }
-    case EVENT_CMD_RECEIVED:
-    {
-        //If command event, read command, write command to SD card, clear command
-        uint8_t data[40] = {0};
-        uint32_t createdDate = 0;
-        if (astronode.read_command_40B(data, &createdDate) == ANS_STATUS_SUCCESS &&
-            astronode.rtc_read(&rtc_time) == ANS_STATUS_SUCCESS)
-        {
-            if (save_command_to_sd(rtc_time, data, createdDate))
-            {
-                astronode.clear_command();
-            }
-        }
-        break;
-    }
-    }
+    //Querry and process all pending events (acks and reset are cleared, commands are saved to SD card)
+    astronode.process_events(1000);
 
     // Try to enqueue a new message
     uint8_t data[ASTRONODE_PAYLOAD_SIZE];
@@ -239,6 +204,14 @@ bool save_hk_to_sd(uint32_t timestamp)
     return true;
 }
 
+bool on_command(uint8_t *data, uint8_t length, uint32_t createdDate)
+{
+    //Command is only cleared if written to SD card
+    uint32_t rtc_time;
+    return astronode.rtc_read(&rtc_time) == ANS_STATUS_SUCCESS &&
+           save_command_to_sd(rtc_time, data, createdDate);
+}
+
 bool save_command_to_sd(uint32_t timestamp, uint8_t data[40], uint32_t createdDate)
 {
     // Write log of operation to SD card
@@ -13,6 +13,9 @@ from skyfield.api import load, Topos
 import pytz
 import math
 import glob
+import os
+import pickle
+from concurrent.futures import ProcessPoolExecutor
 from io import StringIO
 
 ########################################################################################################################
@@ -29,6 +32,9 @@ rssi_sat_detect_max_display = 18  # Maximum RSSI to display in the figures
 obs_window_start = datetime.datetime(2022, 2, 4, 00, 00, 00).replace(tzinfo=pytz.UTC)  # time start observation window
 obs_window_end = datetime.datetime(2022, 2, 5, 23, 59, 59).replace(tzinfo=pytz.UTC)   # time end observation window
 sat_lst = ['ASTROCAST-0101', 'ASTROCAST-0102', 'ASTROCAST-0103', 'ASTROCAST-0104', 'ASTROCAST-0105', 'ASTROCAST-0201', 'ASTROCAST-0202', 'ASTROCAST-0203', 'ASTROCAST-0204', 'ASTROCAST-0205']    # List of satellites used for the computation
+tle_max_age_days = 1.0  # Re-download a TLE only if the local copy is older than this [days]
+cache_folder = folderpath + "pass_cache"  # Computed pass tables are cached here (per satellite, TLE epoch and window)
+max_workers = None      # Number of processes used to compute the passes (None = number of CPUs)
 ########################################################################################################################
 # Log file columns description
 column = ["epoch", "sat_search_phase_cnt", "sat_detect_operation_cnt", "signal_demod_phase_cnt",
@@ -39,9 +45,73 @@ column = ["epoch", "sat_search_phase_cnt", "sat_detect_operation_cnt", "signal_d
           "last_mac_result", "last_sat_search_peak_rssi", "time_since_last_sat_search",
           "time_start_last_contact", "time_end_last_contact", "peak_rssi_last_contact",
           "time_peak_rssi_last_contact"]
+column_dtype = {"epoch": "int64", "sat_search_phase_cnt": "uint32", "sat_detect_operation_cnt": "uint32",
+                "signal_demod_phase_cnt": "uint32", "signal_demod_attempt_cnt": "uint32",
+                "signal_demod_success_cnt": "uint32", "ack_demod_attempt_cnt": "uint32",
+                "ack_demod_success_cnt": "uint32", "queued_msg_cnt": "uint32", "dequeued_unack_msg_cnt": "uint32",
+                "ack_msg_cnt": "uint32", "sent_fragment_cnt": "uint32", "ack_fragment_cnt": "uint32",
+                "cmd_demod_attempt_cnt": "uint32", "cmd_demod_success_cnt": "uint32",
+                "msg_in_queue": "uint8", "ack_msg_in_queue": "uint8", "last_rst": "uint8",
+                "last_mac_result": "uint8", "last_sat_search_peak_rssi": "uint8", "time_since_last_sat_search": "uint32",
+                "time_start_last_contact": "uint32", "time_end_last_contact": "uint32",
+                "peak_rssi_last_contact": "uint8", "time_peak_rssi_last_contact": "uint32"}
 ########################################################################################################################
 
 
+def get_log_files_in_window(pattern, t_start, t_end):
+    """
+    List the log files that may contain samples within the observation window.
+    The logger names its files after the UNIX day of the samples they contain (<timestamp / 86400>.csv), so files
+    of days outside the window are skipped without being opened. Files not following this convention are kept.
+    :param pattern: glob pattern of the log files
+    :param t_start: Observation window start time
+    :param t_end: Observation window end time
+    :return: List of file paths
+    """
+
+    day_start = int(t_start.timestamp()) // 86400
+    day_end = int(t_end.timestamp()) // 86400
+
+    files = []
+    for file in sorted(glob.glob(pattern)):
+        day = os.path.splitext(os.path.basename(file))[0]
+        if not day.isdigit() or day_start <= int(day) <= day_end:
+            files.append(file)
+    return files
+
+
+def load_hk_log_file(file):
+    """
+    Parse the housekeeping lines of a log file with explicit column types.
+    :param file: path of the log file
+    :return: Pandas dataframe indexed by epoch (UTC)
+    """
+
+    s = StringIO()
+    with open(file) as f:
+        for line in f:
+            if line.startswith('HK'):
+                s.write(line[3:])
+    s.seek(0)
+
+    df = pd.read_csv(s, sep=';', names=column, dtype=column_dtype, engine='c')
+    df['epoch'] = pd.to_datetime(df['epoch'], unit='s', utc=True)
+    return df.set_index('epoch')
+
+
+def load_sat_tle(sat):
+    """
+    Load the TLE of a satellite, downloading it from Celestrak only if the local copy is missing or too old.
+    :param sat: satellite name
+    :return: Skyfield satellite object
+    """
+
+    sat_tle_filename = '%s.txt' % sat
+    reload = not os.path.exists(sat_tle_filename) or load.days_old(sat_tle_filename) > tle_max_age_days
+    sat_tle_url = 'https://celestrak.com/NORAD/elements/gp.php?NAME=%s&FORMAT=TLE' % sat
+    return load.tle_file(sat_tle_url, reload=reload, filename=sat_tle_filename)[0]
+
+
 def get_gs_pass_info_from_tle(sat_tle, lat, lon, alt, elev_min, t_start, t_end):
     """
     Get satellite passes opportunities over a given terminal location for a given observation window
@@ -55,7 +125,7 @@ def get_gs_pass_info_from_tle(sat_tle, lat, lon, alt, elev_min, t_start, t_end):
     :return: Pandas dataframe with satellite passes opportunities
     """
 
-    df = pd.DataFrame([])
+    passes = []
 
     # Set ground-station / terminal location
     ground_station = Topos(latitude_degrees=float(lat),
@@ -87,20 +157,47 @@ def get_gs_pass_info_from_tle(sat_tle, lat, lon, alt, elev_min, t_start, t_end):
             los_elev = math.degrees(alt.radians)
             try:
                 if max_elev >= elev_min:
-                    df = df.append({'AOS UTC': aos_utc,
-                                    'AOS el. [deg]': aos_elev,
-                                    'AOS az. [deg]': None,
-                                    'LOS UTC': los_utc,
-                                    'LOS el. [deg]': los_elev,
-                                    'LOS az. [deg]': None,
-                                    'Duration [min]': (los_utc - aos_utc).total_seconds() / 60,
-                                    'Max. el. UTC': max_utc,
-                                    'Max. el. [deg]': max_elev,
-                                    'Max. el. az. [deg]': None
-                                    }, ignore_index=True)
+                    passes.append({'AOS UTC': aos_utc,
+                                   'AOS el. [deg]': aos_elev,
+                                   'AOS az. [deg]': None,
+                                   'LOS UTC': los_utc,
+                                   'LOS el. [deg]': los_elev,
+                                   'LOS az. [deg]': None,
+                                   'Duration [min]': (los_utc - aos_utc).total_seconds() / 60,
+                                   'Max. el. UTC': max_utc,
+                                   'Max. el. [deg]': max_elev,
+                                   'Max. el. az. [deg]': None
+                                   })
             except:
                 print('AOS not in time range, skipping. LOS was %s' % los_utc)
 
+    return pd.DataFrame(passes, columns=['AOS UTC', 'AOS el. [deg]', 'AOS az. [deg]', 'LOS UTC', 'LOS el. [deg]',
+                                         'LOS az. [deg]', 'Duration [min]', 'Max. el. UTC', 'Max. el. [deg]',
+                                         'Max. el. az. [deg]'])
+
+
+def get_gs_pass_info_cached(sat_tle, lat, lon, alt, elev_min, t_start, t_end):
+    """
+    Same as get_gs_pass_info_from_tle, but the pass table is cached on disk per satellite, TLE epoch, terminal
+    location and observation window. A new TLE epoch or a different window triggers a new computation.
+    :return: Pandas dataframe with satellite passes opportunities
+    """
+
+    key = '%s_%s_%.4f_%.4f_%.0f_%g_%d_%d' % (sat_tle.name.replace(' ', '_'),
+                                             sat_tle.epoch.utc_strftime('%Y%m%d%H%M%S'),
+                                             lat, lon, alt, elev_min,
+                                             int(t_start.timestamp()), int(t_end.timestamp()))
+    cache_file = os.path.join(cache_folder, key + '.pkl')
+
+    if os.path.exists(cache_file):
+        with open(cache_file, 'rb') as f:
+            return pickle.load(f)
+
+    df = get_gs_pass_info_from_tle(sat_tle, lat, lon, alt, elev_min, t_start, t_end)
+
+    os.makedirs(cache_folder, exist_ok=True)
+    with open(cache_file, 'wb') as f:
+        pickle.dump(df, f)
     return df
 
 
@@ -124,19 +221,44 @@ def get_satellite_elevation_azimuth_at_epoch_from_tle(sat_tle, lat, lon, alt, t_
 
     difference = sat_tle - ground_station
 
-    # For each epoch, get satellite location with respect to GS/terminal
+    if len(t_index) == 0:
+        return df
+
+    # Get satellite location with respect to GS/terminal for all epochs at once
     ts = load.timescale()
-    for t in t_index:
-        topocentric = difference.at(ts.from_datetime(t))
-        s_alt, s_az, s_distance = topocentric.altaz()
+    topocentric = difference.at(ts.from_datetimes(t_index.to_pydatetime()))
+    s_alt, s_az, s_distance = topocentric.altaz()
 
-        df.loc[t, 'elevation'] = s_alt.degrees
-        df.loc[t, 'azimuth'] = s_az.degrees
-        df.loc[t, 'distance'] = s_distance.m
+    df['elevation'] = s_alt.degrees
+    df['azimuth'] = s_az.degrees
+    df['distance'] = s_distance.m
 
     return df
 
 
+def compute_sat_in_view(sat, t_index, lat, lon, alt, elev_min, t_start, t_end):
+    """
+    Compute, for one satellite, which epochs of the log fall within one of its passes and the satellite location
+    at those epochs. Runs in a worker process: the TLE is re-loaded from the local file.
+    :param sat: satellite name
+    :param t_index: Pandas time index of the log
+    :return: (satellite name, boolean mask of in-view epochs, dataframe with satellite location for those epochs)
+    """
+
+    sat_tle = load_sat_tle(sat)
+    sat_pass_df = get_gs_pass_info_cached(sat_tle, lat, lon, alt, elev_min, t_start, t_end)
+
+    # filter timestamps -> valid only if in interval
+    sat_in_view = np.zeros(len(t_index), dtype=bool)
+    for aos_utc, los_utc in zip(sat_pass_df['AOS UTC'], sat_pass_df['LOS UTC']):
+        sat_in_view |= (t_index > aos_utc) & (t_index < los_utc)
+
+    # Compute satellite elevation for epochs during which the satellite is visible
+    sat_location_df = get_satellite_elevation_azimuth_at_epoch_from_tle(sat_tle, lat, lon, alt, t_index[sat_in_view])
+
+    return sat, sat_in_view, sat_location_df
+
+
 def autolabel(rects):
     """
     Attach a text label above each bar in *rects*, displaying its height.
@@ -156,20 +278,10 @@ def autolabel(rects):
 
 if __name__ == '__main__':
 
-    df = pd.DataFrame([])
-
-    # Parse log file from terminal (will load all log files matching pattern)
-    dateparse = lambda x: datetime.datetime.utcfromtimestamp(int(x)).replace(tzinfo=pytz.UTC)
-    for file in glob.glob(folderpath + filename):
-        s = StringIO()
-        with open(file) as f:
-            for line in f:
-                if line.startswith('HK'):
-                    s.write(line[3:])
-        s.seek(0)
-
-        df = pd.concat([df, pd.read_csv(s, sep=';', names=column, parse_dates=['epoch'],
-                                        date_parser=dateparse, index_col=['epoch'])])
+    # Parse log files from terminal (only the files overlapping the observation window are loaded)
+    df = pd.concat([load_hk_log_file(file)
+                    for file in get_log_files_in_window(folderpath + filename, obs_window_start, obs_window_end)])
+    df = df.sort_index()
 
     # Replace MAC result with human readable strings
     mac_result_dict = {0: "None",
@@ -188,6 +300,7 @@ if __name__ == '__main__':
 
     # Trim observation window:
     df = df[(df.index > obs_window_start) & (df.index < obs_window_end)]
+    df = df[~df.index.duplicated(keep='first')]
 
     # RSSI signal filtering (convolve with normalized Hanning window)
     windowSize = 8
@@ -202,27 +315,23 @@ if __name__ == '__main__':
     df['sat_name'] = ''
     df['sat_in_view'] = False
 
-    # Compute satellite passes time and elevation
+    # Retrieve TLE files from Celestrak web site (once, before the workers read them)
     for sat in sat_lst:
-
-        # Retrieve TLE file from Celestrak web site
-        sat_tle_url = 'https://celestrak.com/NORAD/elements/gp.php?NAME=%s&FORMAT=TLE' % sat
-        sat_tle = load.tle_file(sat_tle_url, reload=True, filename='%s.txt' % sat)[0]
-
-        sat_pass_df = get_gs_pass_info_from_tle(sat_tle, lat, lon, alt, min_sat_elevation, df.index[0], df.index[-1])
-
-        # filter timestamps -> valid only if in interval
-        for epoch, sat_pass in sat_pass_df.iterrows():
-            sat_in_view_tmp = (df.index > sat_pass['AOS UTC']) & (df.index < sat_pass['LOS UTC'])
-            df['sat_in_view'] = df['sat_in_view'] | sat_in_view_tmp
-            df.loc[sat_in_view_tmp, 'sat_name'] = sat
-
-        # Compute satellite elevation for epochs during which the satellite is visible
+        load_sat_tle(sat)
+
+    # Compute satellite passes time and elevation (one worker process per satellite)
+    with ProcessPoolExecutor(max_workers=max_workers) as executor:
+        futures = [executor.submit(compute_sat_in_view, sat, df.index, lat, lon, alt, min_sat_elevation,
+                                   obs_window_start, obs_window_end) for sat in sat_lst]
+        results = [future.result() for future in futures]
+
+    # Merge in satellite list order (a later satellite overrides an earlier one on overlapping passes)
+    for sat, sat_in_view, sat_location_df in results:
+        df['sat_in_view'] = df['sat_in_view'] | sat_in_view
+        df.loc[sat_in_view, 'sat_name'] = sat
         t_index_to_process = df[df['sat_name'] == sat].index
-        df = df[~df.index.duplicated(keep='first')]
-        sat_pass_df_cnt = get_satellite_elevation_azimuth_at_epoch_from_tle(sat_tle, lat, lon, alt, t_index_to_process)
-        df.loc[t_index_to_process, 'sat_elevation'] = sat_pass_df_cnt['elevation']
-        df.loc[t_index_to_process, 'sat_azimuth'] = sat_pass_df_cnt['azimuth']
+        df.loc[t_index_to_process, 'sat_elevation'] = sat_location_df['elevation'].reindex(t_index_to_process)
+        df.loc[t_index_to_process, 'sat_azimuth'] = sat_location_df['azimuth'].reindex(t_index_to_process)
 
     # Filtering data for which the satellite is in view and RSSI above detection threshold
     df_sat_in_view = df[(df['sat_elevation'] >= min_sat_elevation) &
@@ -0,0 +1,62 @@
+# Split the payloads built by ASTRONODE_AGGREGATOR (astronode_aggregator.h) back into records.
+#
+# Payload format:
+#   [format = 0x01] [type][length][data...] [type][length][data...] ...
+#
+# Usage:
+#   python aggregator_decode.py <hex payload> [<hex payload> ...]
+#   python aggregator_decode.py -f payloads.txt      (one hex payload per line)
+#
+# Or from python:
+#   from aggregator_decode import decode_payload
+#   for record_type, data in decode_payload(payload_bytes): ...
+
+import sys
+
+AGGREGATOR_FORMAT = 0x01
+RECORD_HEADER_SIZE = 2
+
+
+class AggregatorFormatError(ValueError):
+    pass
+
+
+def decode_payload(payload):
+    """
+    Split an aggregated payload into records.
+    :param payload: payload bytes (bytes, bytearray or list of int)
+    :return: list of (type, data bytes) tuples, in the order they were appended
+    """
+    payload = bytes(payload)
+    if len(payload) == 0 or payload[0] != AGGREGATOR_FORMAT:
+        raise AggregatorFormatError("unknown payload format")
+
+    records = []
+    i = 1
+    while i < len(payload):
+        if i + RECORD_HEADER_SIZE > len(payload):
+            raise AggregatorFormatError("truncated record header at offset %d" % i)
+        record_type = payload[i]
+        length = payload[i + 1]
+        start = i + RECORD_HEADER_SIZE
+        if start + length > len(payload):
+            raise AggregatorFormatError("truncated record at offset %d" % i)
+        records.append((record_type, payload[start:start + length]))
+        i = start + length
+    return records
+
+
+def main(argv):
+    if len(argv) >= 2 and argv[0] == "-f":
+        with open(argv[1]) as f:
+            payloads = [line.strip() for line in f if line.strip()]
+    else:
+        payloads = argv
+
+    for payload in payloads:
+        for record_type, data in decode_payload(bytes.fromhex(payload)):
+            print("type=%d length=%d data=%s" % (record_type, len(data), data.hex()))
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
@@ -0,0 +1,488 @@
+/******************************************************************************************
+ * File:        astronode_sim.h
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * Astronode S simulator for the host tests. It answers the serial protocol (STX, hex
+ * encoded frame, CRC, ETX) on the master side of a pseudo-terminal; the library is
+ * attached to the slave side with ASTRONODE_POSIX_SERIAL::attach(sim.slave).
+ *
+ * The module state (queue, events, acks, command, counters, RTC, ...) is kept in public
+ * members that the tests set and check. Test-only code, never built for the boards.
+ ****************************************************************************************/
+
+#ifndef _ASTRONODE_SIM_h
+#define _ASTRONODE_SIM_h
+
+#include <pty.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#define SIM_QUEUE_SIZE 8
+
+class ASTRONODE_SIM
+{
+
+public:
+  typedef std::pair<uint16_t, std::vector<uint8_t>> payload_t;
+
+  int master = -1;
+  int slave = -1;
+
+  // Module state, protected by lock while the simulator runs
+  std::mutex lock;
+  std::deque<payload_t> queue;
+  std::deque<uint16_t> acks;
+  std::vector<uint8_t> cmd;
+  uint32_t cmd_date = 0;
+  uint8_t cfg[3] = {0, 0, 0};
+  uint8_t events = 0;
+  uint32_t rtc = 100000;
+  bool rtc_live = false; // RTC advancing with the host clock
+  double rtc_rate = 1.0;
+  uint32_t nco = 120;
+  uint32_t uptime = 1000;
+  uint8_t last_rst = 0;
+  uint32_t per[14] = {};
+  bool per_bump = false; // Performance counters follow the number of frames received
+  uint8_t ssc_period = 0;
+  uint8_t search_rssi = 7;    // END: last satellite search peak RSSI
+  uint32_t search_age = 30;   // END: time since the last satellite search [s]
+  uint32_t contact_end = 400; // LCD: end of the last contact
+  uint8_t contact_rssi = 9;   // LCD: peak RSSI of the last contact
+  int max_tx = 255;           // TTX_SR accepted before MAX_TX_REACHED
+
+  // Link behaviour
+  int delay_ms = 0; // Before each answer
+  int drop = 0;     // Frames left unanswered
+  int corrupt = 0;  // Answers sent with a wrong CRC
+  int late = 0;     // Answers sent after late_ms (once the asset gave up waiting)
+  int late_ms = 0;
+  int repeat = 0;   // Answers preceded by the previous answer again (late answer to an earlier request)
+  bool dequeue_head = false; // PLD_DR removes the first payload queued instead of the last
+
+  // Statistics
+  int frames = 0;
+  int cfg_writes = 0;
+  int cfg_saves = 0;
+  int cfg_reads = 0;
+  int ssc_writes = 0;
+  int ttx_starts = 0;
+
+  ~ASTRONODE_SIM() { stop(); }
+
+  bool start(void)
+  {
+    if (openpty(&master, &slave, NULL, NULL, NULL) != 0)
+    {
+      return false;
+    }
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+    clock_gettime(CLOCK_MONOTONIC, &_rtc_t0);
+    _stop = false;
+    _thread = std::thread([this] { run(); });
+    return true;
+  }
+
+  void stop(void)
+  {
+    _stop = true;
+    if (_thread.joinable())
+    {
+      _thread.join();
+    }
+    if (master >= 0)
+    {
+      ::close(master);
+    }
+    if (slave >= 0)
+    {
+      ::close(slave);
+    }
+    master = -1;
+    slave = -1;
+  }
+
+  // Close the module side only (cable unplugged)
+  void hangup(void)
+  {
+    _stop = true;
+    if (_thread.joinable())
+    {
+      _thread.join();
+    }
+    ::close(master);
+    master = -1;
+  }
+
+  std::vector<uint16_t> queue_ids(void)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    std::vector<uint16_t> ids;
+    for (size_t i = 0; i < queue.size(); i++)
+    {
+      ids.push_back(queue[i].first);
+    }
+    return ids;
+  }
+
+  static uint16_t crc(const uint8_t *data, size_t length)
+  {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++)
+    {
+      uint16_t x = crc >> 8 ^ data[i];
+      x ^= x >> 4;
+      crc = (crc << 8) ^ (x << 12) ^ (x << 5) ^ x;
+    }
+    return crc;
+  }
+
+private:
+  std::thread _thread;
+  std::atomic<bool> _stop{false};
+  struct timespec _rtc_t0 = {};
+  std::string _last_answer;
+
+  static void put_u32(std::vector<uint8_t> &v, uint32_t x)
+  {
+    for (int i = 0; i < 4; i++)
+    {
+      v.push_back((uint8_t)(x >> (8 * i)));
+    }
+  }
+
+  static uint8_t hex_to_nibble(uint8_t h) { return (h < 'A') ? h - '0' : h - 'A' + 10; }
+
+  void send(uint8_t reg, const std::vector<uint8_t> &param)
+  {
+    std::vector<uint8_t> frame;
+    frame.push_back(reg);
+    frame.insert(frame.end(), param.begin(), param.end());
+    uint16_t c = crc(frame.data(), frame.size());
+    if (corrupt > 0)
+    {
+      corrupt--;
+      c ^= 0x0100;
+    }
+    frame.push_back(c & 0xFF);
+    frame.push_back(c >> 8);
+
+    std::string out = "\x02";
+    char hex[3];
+    for (size_t i = 0; i < frame.size(); i++)
+    {
+      snprintf(hex, sizeof(hex), "%02X", frame[i]);
+      out += hex;
+    }
+    out += "\x03";
+    if (delay_ms > 0)
+    {
+      usleep(delay_ms * 1000);
+    }
+    if (late > 0)
+    {
+      late--;
+      usleep(late_ms * 1000);
+    }
+    std::string answer = out;
+    if (repeat > 0 && !_last_answer.empty())
+    {
+      repeat--;
+      out = _last_answer + out;
+    }
+    _last_answer = answer;
+    if (::write(master, out.data(), out.size()) < 0)
+    {
+      perror("sim write");
+    }
+  }
+
+  void error(uint16_t code) { send(0xFF, {(uint8_t)code, (uint8_t)(code >> 8)}); }
+
+  uint32_t rtc_now(void)
+  {
+    if (!rtc_live)
+    {
+      return rtc;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed = (now.tv_sec - _rtc_t0.tv_sec) + (now.tv_nsec - _rtc_t0.tv_nsec) / 1e9;
+    return rtc + (uint32_t)(elapsed * rtc_rate);
+  }
+
+  void handle(const std::vector<uint8_t> &frame)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    frames++;
+    if (drop > 0)
+    {
+      drop--;
+      return;
+    }
+
+    uint8_t reg = frame[0];
+    std::vector<uint8_t> p(frame.begin() + 1, frame.end() - 2);
+    std::vector<uint8_t> v;
+    switch (reg)
+    {
+    case 0x05: // CFG_WR
+      memcpy(cfg, p.data(), 3);
+      cfg_writes++;
+      send(0x85, {});
+      break;
+    case 0x07: // SSC_WR
+      ssc_writes++;
+      ssc_period = p[0];
+      send(0x87, {});
+      break;
+    case 0x10: // CFG_SR
+      cfg_saves++;
+      send(0x90, {});
+      break;
+    case 0x11: // CFG_FR
+      memset(cfg, 0, sizeof(cfg));
+      send(0x91, {});
+      break;
+    case 0x15: // CFG_RR
+      cfg_reads++;
+      send(0x95, {3, 1, 2, 3, 4, cfg[0], cfg[1], cfg[2]});
+      break;
+    case 0x17: // RTC_RR
+      put_u32(v, rtc_now());
+      send(0x97, v);
+      break;
+    case 0x18: // NCO_RR
+      put_u32(v, nco);
+      send(0x98, v);
+      break;
+    case 0x19: // MGI_RR
+      for (int i = 0; i < 36; i++)
+      {
+        v.push_back('a' + i % 26);
+      }
+      send(0x99, v);
+      break;
+    case 0x25: // PLD_ER
+    {
+      uint16_t id = p[0] | (p[1] << 8);
+      if (queue.size() >= SIM_QUEUE_SIZE)
+      {
+        error(0x2501);
+        break;
+      }
+      for (size_t i = 0; i < queue.size(); i++)
+      {
+        if (queue[i].first == id)
+        {
+          error(0x2511);
+          return;
+        }
+      }
+      queue.push_back(payload_t(id, std::vector<uint8_t>(p.begin() + 2, p.end())));
+      per[7]++;
+      send(0xA5, {p[0], p[1]});
+      break;
+    }
+    case 0x26: // PLD_DR: removes the last payload queued
+    {
+      if (queue.empty())
+      {
+        error(0x2601);
+        break;
+      }
+      uint16_t id = dequeue_head ? queue.front().first : queue.back().first;
+      if (dequeue_head)
+      {
+        queue.pop_front();
+      }
+      else
+      {
+        queue.pop_back();
+      }
+      send(0xA6, {(uint8_t)id, (uint8_t)(id >> 8)});
+      break;
+    }
+    case 0x27: // PLD_FR
+      queue.clear();
+      send(0xA7, {});
+      break;
+    case 0x45: // SAK_RR
+      if (acks.empty())
+      {
+        error(0x4501);
+        break;
+      }
+      send(0xC5, {(uint8_t)acks.front(), (uint8_t)(acks.front() >> 8)});
+      break;
+    case 0x46: // SAK_CR
+      if (acks.empty())
+      {
+        error(0x4601);
+        break;
+      }
+      acks.pop_front();
+      if (acks.empty())
+      {
+        events &= ~1;
+      }
+      send(0xC6, {});
+      break;
+    case 0x47: // CMD_RR
+      if (cmd.empty())
+      {
+        error(0x4701);
+        break;
+      }
+      put_u32(v, cmd_date);
+      v.insert(v.end(), cmd.begin(), cmd.end());
+      send(0xC7, v);
+      break;
+    case 0x48: // CMD_CR
+      if (cmd.empty())
+      {
+        error(0x4801);
+        break;
+      }
+      cmd.clear();
+      events &= ~4;
+      send(0xC8, {});
+      break;
+    case 0x55: // RES_CR
+      events &= ~2;
+      send(0xD5, {});
+      break;
+    case 0x61: // TTX_SR
+      if (ttx_starts >= max_tx)
+      {
+        error(0x6101);
+        break;
+      }
+      ttx_starts++;
+      send(0xE1, {});
+      break;
+    case 0x65: // EVT_RR
+      send(0xE5, {(uint8_t)(events | (queue.empty() ? 0 : 8))});
+      break;
+    case 0x66: // PER_SR
+      send(0xE6, {});
+      break;
+    case 0x67: // PER_RR
+      if (per_bump)
+      {
+        for (int i = 0; i < 14; i++)
+        {
+          per[i] = frames;
+        }
+      }
+      for (int i = 0; i < 14; i++)
+      {
+        v.push_back(i + 1);
+        v.push_back(4);
+        put_u32(v, per[i]);
+      }
+      send(0xE7, v);
+      break;
+    case 0x68: // PER_CR
+      memset(per, 0, sizeof(per));
+      send(0xE8, {});
+      break;
+    case 0x69: // MST_RR
+      v = {0x41, 1, (uint8_t)queue.size(), 0x42, 1, (uint8_t)acks.size(), 0x43, 1, last_rst, 0x44, 4};
+      put_u32(v, uptime);
+      send(0xE9, v);
+      break;
+    case 0x6A: // LCD_RR
+      v = {0x51, 4};
+      put_u32(v, 500);
+      v.push_back(0x52);
+      v.push_back(4);
+      put_u32(v, contact_end);
+      v.push_back(0x53);
+      v.push_back(1);
+      v.push_back(contact_rssi);
+      v.push_back(0x54);
+      v.push_back(4);
+      put_u32(v, 450);
+      send(0xEA, v);
+      break;
+    case 0x6B: // END_RR
+      v = {0x61, 1, 1, 0x62, 1, search_rssi, 0x63, 4};
+      put_u32(v, search_age);
+      send(0xEB, v);
+      break;
+    default:
+      error(0x0121);
+      break;
+    }
+  }
+
+  void run(void)
+  {
+    std::vector<uint8_t> hex;
+    bool in_frame = false;
+    while (!_stop)
+    {
+      struct pollfd pfd = {master, POLLIN, 0};
+      if (poll(&pfd, 1, 20) <= 0)
+      {
+        continue;
+      }
+      uint8_t buf[256];
+      ssize_t n = ::read(master, buf, sizeof(buf));
+      for (ssize_t i = 0; i < n; i++)
+      {
+        if (buf[i] == 0x02)
+        {
+          in_frame = true;
+          hex.clear();
+        }
+        else if (buf[i] == 0x03 && in_frame)
+        {
+          in_frame = false;
+          std::vector<uint8_t> frame;
+          for (size_t k = 0; k + 1 < hex.size(); k += 2)
+          {
+            frame.push_back((hex_to_nibble(hex[k]) << 4) | hex_to_nibble(hex[k + 1]));
+          }
+          if (frame.size() < 3)
+          {
+            continue;
+          }
+          uint16_t c = frame[frame.size() - 2] | (frame[frame.size() - 1] << 8);
+          if (c != crc(frame.data(), frame.size() - 2))
+          {
+            error(0x0001);
+          }
+          else
+          {
+            handle(frame);
+          }
+        }
+        else if (in_frame)
+        {
+          hex.push_back(buf[i]);
+        }
+      }
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,34 @@
+/******************************************************************************************
+ * File:        test.h
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * Minimal checks for the host tests: a failed CHECK prints its location and the test
+ * exits with an error code. Test-only code, never built for the boards.
+ ****************************************************************************************/
+
+#ifndef _ASTRONODE_TEST_h
+#define _ASTRONODE_TEST_h
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECK(condition)                                                             \
+  do                                                                                 \
+  {                                                                                  \
+    if (!(condition))                                                                \
+    {                                                                                \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+      exit(1);                                                                       \
+    }                                                                                \
+  } while (0)
+
+#define TEST_PASSED()                  \
+  do                                   \
+  {                                    \
+    printf("%s: passed\n", __FILE__); \
+    return 0;                          \
+  } while (0)
+
+#endif
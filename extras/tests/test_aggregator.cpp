@@ -0,0 +1,66 @@
+/******************************************************************************************
+ * File:        test_aggregator.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * ASTRONODE_AGGREGATOR: records packed into payloads, flush() and reserve() failures
+ * while a record is being written.
+ ****************************************************************************************/
+
+#include "astronode.h"
+#include "astronode_aggregator.h"
+#include "astronode_posix.h"
+#include "astronode_sim.h"
+#include "test.h"
+
+static std::vector<uint8_t> module_payload(ASTRONODE_SIM &sim,
+                                           size_t index)
+{
+  std::lock_guard<std::mutex> guard(sim.lock);
+  return sim.queue[index].second;
+}
+
+int main(void)
+{
+  ASTRONODE_SIM sim;
+  CHECK(sim.start());
+  ASTRONODE_POSIX_SERIAL serial;
+  CHECK(serial.attach(sim.slave));
+  ASTRONODE astronode;
+  CHECK(astronode.begin(serial) == ANS_STATUS_SUCCESS);
+
+  ASTRONODE_AGGREGATOR aggregator(astronode, 0);
+  uint8_t value[4] = {1, 2, 3, 4};
+  CHECK(aggregator.append(0x10, value, sizeof(value)));
+
+  // Not sealed while a record is being written, the record goes into the same payload
+  uint8_t *record = aggregator.reserve(0x11, 2);
+  CHECK(record != NULL);
+  CHECK(!aggregator.flush());
+  record[0] = 0xAA;
+  record[1] = 0xBB;
+  aggregator.commit();
+  CHECK(aggregator.flush());
+  CHECK(aggregator.poll() == ANS_STATUS_SUCCESS);
+  CHECK(module_payload(sim, 0) == std::vector<uint8_t>({AGGREGATOR_FORMAT, 0x10, 4, 1, 2, 3, 4, 0x11, 2, 0xAA, 0xBB}));
+
+  // Both buffers full: the record is dropped and a later commit() adds nothing
+  uint8_t large[AGGREGATOR_MAX_RECORD_SIZE] = {};
+  CHECK(aggregator.append(0x12, large, sizeof(large)));
+  CHECK(aggregator.append(0x12, large, sizeof(large)));
+  CHECK(aggregator.reserve(0x13, 1) == NULL);
+  CHECK(aggregator.dropped_count() == 1);
+  aggregator.commit();
+  CHECK(aggregator.pending_length() == ASN_MAX_MSG_SIZE);
+
+  // An abandoned reservation does not block flush()
+  CHECK(aggregator.poll() == ANS_STATUS_SUCCESS);
+  CHECK(aggregator.reserve(0x14, 1) != NULL);
+  CHECK(aggregator.reserve(0x15, AGGREGATOR_MAX_RECORD_SIZE + 1) == NULL);
+  CHECK(aggregator.flush());
+  CHECK(aggregator.poll() == ANS_STATUS_SUCCESS);
+  CHECK(sim.queue_ids() == std::vector<uint16_t>({0, 1, 2}));
+
+  TEST_PASSED();
+}
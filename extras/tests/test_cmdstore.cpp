@@ -0,0 +1,123 @@
+/******************************************************************************************
+ * File:        test_cmdstore.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * ASTRONODE_CMDSTORE with process_events(): a command handled once across a missed clear,
+ * and a store write failure reported without handling the command twice.
+ ****************************************************************************************/
+
+#include "astronode.h"
+#include "astronode_cmdstore.h"
+#include "astronode_nvm.h"
+#include "astronode_posix.h"
+#include "astronode_sim.h"
+#include "test.h"
+
+#define STORE_ADDRESS 832
+
+class RAM_NVM : public ASTRONODE_NVM
+{
+
+public:
+  uint8_t bytes[1024];
+  bool fail_writes = false;
+
+  RAM_NVM() { memset(bytes, 0xFF, sizeof(bytes)); }
+
+  bool read(uint32_t address,
+            uint8_t *data,
+            uint16_t length)
+  {
+    if (address + length > sizeof(bytes))
+    {
+      return false;
+    }
+    memcpy(data, &bytes[address], length);
+    return true;
+  }
+
+  bool write(uint32_t address,
+             const uint8_t *data,
+             uint16_t length)
+  {
+    if (fail_writes || address + length > sizeof(bytes))
+    {
+      return false;
+    }
+    memcpy(&bytes[address], data, length);
+    return true;
+  }
+};
+
+static int handled = 0;
+
+static bool on_command(uint8_t *data,
+                       uint8_t length,
+                       uint32_t createdDate)
+{
+  (void)data;
+  (void)length;
+  (void)createdDate;
+  handled++;
+  return true;
+}
+
+static void send_command(ASTRONODE_SIM &sim,
+                         uint8_t first)
+{
+  std::lock_guard<std::mutex> guard(sim.lock);
+  sim.cmd.clear();
+  for (uint8_t i = 0; i < DATA_CMD_8B_SIZE; i++)
+  {
+    sim.cmd.push_back(first + i);
+  }
+  sim.cmd_date = 1000 + first;
+  sim.events |= 4;
+}
+
+int main(void)
+{
+  ASTRONODE_SIM sim;
+  CHECK(sim.start());
+  ASTRONODE_POSIX_SERIAL serial;
+  CHECK(serial.attach(sim.slave));
+  ASTRONODE astronode;
+  CHECK(astronode.begin(serial) == ANS_STATUS_SUCCESS);
+
+  RAM_NVM nvm;
+  ASTRONODE_CMDSTORE commands(nvm, STORE_ADDRESS);
+  commands.begin();
+  astronode.onCommand(on_command, DATA_CMD_8B_SIZE);
+  astronode.enableCommandStore(commands);
+
+  // Handled, recorded and cleared
+  send_command(sim, 1);
+  CHECK(astronode.process_events(1000) == ANS_STATUS_SUCCESS);
+  CHECK(handled == 1 && commands.count() == 1);
+  CHECK(sim.cmd.empty());
+
+  // Read again (asset reset before the clear): cleared without calling the handler
+  send_command(sim, 1);
+  CHECK(astronode.process_events(1000) == ANS_STATUS_SUCCESS);
+  CHECK(handled == 1 && commands.duplicates() == 1);
+  CHECK(sim.cmd.empty());
+
+  // Store write failure: handled once, cleared, reported
+  nvm.fail_writes = true;
+  send_command(sim, 20);
+  CHECK(astronode.process_events(1000) == ANS_STATUS_HW_ERR);
+  CHECK(handled == 2 && commands.count() == 1);
+  CHECK(sim.cmd.empty());
+  CHECK(astronode.process_events(1000) == ANS_STATUS_SUCCESS);
+  CHECK(handled == 2);
+
+  // The store is restored with the storage
+  nvm.fail_writes = false;
+  send_command(sim, 40);
+  CHECK(astronode.process_events(1000) == ANS_STATUS_SUCCESS);
+  CHECK(handled == 3 && commands.count() == 2);
+
+  TEST_PASSED();
+}
@@ -0,0 +1,106 @@
+/******************************************************************************************
+ * File:        test_coro.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * ASTRONODE_CORO (C++20): coroutines sharing the module, frame pool exhaustion, and
+ * deadlines shorter and longer than TIMEOUT_SERIAL.
+ ****************************************************************************************/
+
+#include "astronode.h"
+#include "astronode_coro.h"
+#include "astronode_posix.h"
+#include "astronode_sim.h"
+#include "test.h"
+
+static int finished = 0;
+static ans_status_e deadline_status;
+static unsigned long deadline_elapsed;
+
+static ASTRONODE_TASK modem_logic(ASTRONODE_CORO &modem,
+                                  uint16_t id)
+{
+  auto rtc = co_await modem.rtc_read();
+  CHECK(rtc.status == ANS_STATUS_SUCCESS);
+  CHECK(rtc.value == 100000 + ASTROCAST_REF_UNIX_TIME);
+
+  uint8_t data[4] = {1, 2, 3, 4};
+  CHECK(co_await modem.enqueue_payload(data, sizeof(data), id) == ANS_STATUS_SUCCESS);
+
+  auto nco = co_await modem.read_next_contact_opportunity();
+  CHECK(nco.status == ANS_STATUS_SUCCESS && nco.value == 120);
+  CHECK(co_await modem.read_module_state() == ANS_STATUS_SUCCESS);
+
+  auto ack = co_await modem.read_satellite_ack();
+  CHECK(ack.status == ANS_STATUS_NO_ACK);
+  finished++;
+}
+
+static ASTRONODE_TASK read_with_deadline(ASTRONODE_CORO &modem,
+                                         unsigned long deadline)
+{
+  unsigned long start = millis();
+  auto rtc = co_await modem.rtc_read(deadline);
+  deadline_status = rtc.status;
+  deadline_elapsed = millis() - start;
+  finished++;
+}
+
+static void run(ASTRONODE_CORO &modem)
+{
+  unsigned long start = millis();
+  while (!modem.idle())
+  {
+    CHECK(millis() - start < 10000);
+    modem.run();
+    usleep(200);
+  }
+}
+
+int main(void)
+{
+  ASTRONODE_SIM sim;
+  CHECK(sim.start());
+  ASTRONODE_POSIX_SERIAL serial;
+  CHECK(serial.attach(sim.slave));
+  ASTRONODE astronode;
+  CHECK(astronode.begin(serial) == ANS_STATUS_SUCCESS);
+  ASTRONODE_CORO modem(astronode);
+
+  // Coroutines interleave their requests on one module, one frame each from the pool
+  for (uint16_t id = 0; id < ASTRONODE_CORO_POOL_SIZE; id++)
+  {
+    CHECK(modem_logic(modem, id).started());
+  }
+  CHECK(!modem_logic(modem, 99).started());
+  run(modem);
+  CHECK(finished == ASTRONODE_CORO_POOL_SIZE);
+  CHECK(sim.queue_ids().size() == ASTRONODE_CORO_POOL_SIZE);
+
+  // Deadline shorter than the answer delay
+  sim.delay_ms = 300;
+  CHECK(read_with_deadline(modem, 50).started());
+  run(modem);
+  CHECK(deadline_status == ANS_STATUS_TIMEOUT);
+  CHECK(deadline_elapsed < 300);
+  usleep(400000); // Late answer, discarded by the next request
+
+  // Answer later than TIMEOUT_SERIAL: a longer deadline waits for it, the default one does not
+  sim.delay_ms = TIMEOUT_SERIAL + 500;
+  CHECK(read_with_deadline(modem, TIMEOUT_SERIAL + 2000).started());
+  run(modem);
+  CHECK(deadline_status == ANS_STATUS_SUCCESS);
+  CHECK(deadline_elapsed >= TIMEOUT_SERIAL + 500);
+
+  CHECK(read_with_deadline(modem, TIMEOUT_SERIAL).started());
+  run(modem);
+  CHECK(deadline_status == ANS_STATUS_TIMEOUT);
+  usleep(1000000);
+
+  sim.delay_ms = 0;
+  uint32_t rtc_time;
+  CHECK(astronode.rtc_read(&rtc_time) == ANS_STATUS_SUCCESS);
+
+  TEST_PASSED();
+}
@@ -0,0 +1,163 @@
+/******************************************************************************************
+ * File:        test_energy.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * ASTRONODE_ENERGY with a fixed configuration: request, performance counter (cleared
+ * counters included), SD write and cycle charges against hand-computed values, request
+ * codes past the table folded into slot 0x00, and the accounting of blocking and
+ * async_request() requests through the simulator.
+ ****************************************************************************************/
+
+#include "astronode.h"
+#include "astronode_energy.h"
+#include "astronode_posix.h"
+#include "astronode_sim.h"
+#include "test.h"
+
+#include <cmath>
+
+static const ASTRONODE_ENERGY_CONFIG config = {
+    5000,   // mcu_awake_ua
+    10,     // mcu_sleep_ua
+    2000,   // uart_active_ua
+    1000,   // module_idle_ua
+    20000,  // module_search_ua
+    100000, // module_tx_ua
+    30000,  // sd_write_ua
+    100,    // search_phase_ms
+    500,    // fragment_tx_ms
+    10000,  // baudrate
+};
+
+static bool near(float mah,
+                 double pc)
+{
+  double expected = pc / ASTRONODE_ENERGY_PC_PER_MAH;
+  return std::fabs(mah - expected) <= expected * 1e-5;
+}
+
+static void charges(void)
+{
+  ASTRONODE_ENERGY energy(config);
+  energy.begin_cycle();
+
+  // 1 s request, 50 bytes: MCU 5000 uA x 1e6 us, UART 2000 uA x 500 bits / 10000 bit/s
+  energy.request(PLD_ER, 1000000, 50);
+  uint8_t reg;
+  uint16_t count;
+  float mah;
+  CHECK(energy.opcode_count() == 1);
+  CHECK(energy.opcode(0, &reg, &count, &mah) && reg == PLD_ER && count == 1);
+  CHECK(near(mah, 5e9 + 1e8));
+  CHECK(!energy.opcode(1, &reg, &count, &mah));
+
+  // First read: reference only. Then 3 search phases and 1 fragment, then counters cleared (2 phases since)
+  energy.performance_counters(10, 2);
+  energy.performance_counters(13, 3);
+  energy.performance_counters(2, 0);
+  double module = 19000.0 * 3 * 100 * 1000 + 99000.0 * 1 * 500 * 1000 + 19000.0 * 2 * 100 * 1000;
+
+  energy.sd_write(1000); // 30000 uA x 1000 us
+  double sd = 3e7;
+
+  // The request covers the awake time of the cycle: only the sleep and the module idle current are added
+  energy.end_cycle(2000);
+  const ASTRONODE_ENERGY_CYCLE &cycle = energy.last_cycle();
+  CHECK(cycle.requests == 1 && cycle.sleep_ms == 2000 && cycle.awake_ms < 1000);
+  CHECK(cycle.mcu == 5000000000ULL + 10ULL * 2000 * 1000);
+  CHECK(cycle.uart == 100000000ULL);
+  CHECK(cycle.sd == (uint64_t)sd);
+  uint64_t idle_min = 1000ULL * ((uint64_t)cycle.awake_ms * 1000 + 2000 * 1000);
+  CHECK(cycle.module >= (uint64_t)module + idle_min && cycle.module < (uint64_t)module + idle_min + 1000ULL * 1000);
+  CHECK(near(energy.last_cycle_mah(), (double)(cycle.mcu + cycle.uart + cycle.module + cycle.sd)));
+  CHECK(near(energy.total_mah(), (double)(cycle.mcu + cycle.uart + cycle.module + cycle.sd)));
+
+  // Cycle without request: the MCU awake over the whole cycle
+  delay(20);
+  energy.end_cycle(0);
+  const ASTRONODE_ENERGY_CYCLE &awake = energy.last_cycle();
+  CHECK(awake.requests == 0 && awake.awake_ms >= 20 && awake.uart == 0 && awake.sd == 0);
+  CHECK(awake.mcu >= 5000ULL * awake.awake_ms * 1000 && awake.mcu < 5000ULL * (awake.awake_ms + 1) * 1000);
+  CHECK(awake.module >= 1000ULL * awake.awake_ms * 1000 && awake.module < 1000ULL * (awake.awake_ms + 1) * 1000);
+
+  energy.clear();
+  CHECK(energy.opcode_count() == 0 && energy.total_mah() == 0);
+}
+
+static void folding(void)
+{
+  ASTRONODE_ENERGY energy(config);
+  uint8_t reg;
+  uint16_t count;
+  float mah;
+
+  // ASTRONODE_ENERGY_OPCODES - 1 codes get a slot each
+  for (uint8_t code = 1; code < ASTRONODE_ENERGY_OPCODES; code++)
+  {
+    energy.request(code, 1000, 0);
+  }
+  CHECK(energy.opcode_count() == ASTRONODE_ENERGY_OPCODES - 1);
+
+  // Next codes summed in the last slot, as 0x00; the codes with a slot keep it
+  energy.request(0x60, 1000, 0);
+  energy.request(0x61, 2000, 0);
+  energy.request(0x60, 1000, 0);
+  energy.request(3, 1000, 0);
+  CHECK(energy.opcode_count() == ASTRONODE_ENERGY_OPCODES);
+  CHECK(energy.opcode(ASTRONODE_ENERGY_OPCODES - 1, &reg, &count, &mah));
+  CHECK(reg == 0x00 && count == 3 && near(mah, 5000.0 * 4000));
+  CHECK(energy.opcode(2, &reg, &count, &mah) && reg == 3 && count == 2 && near(mah, 5000.0 * 2000));
+  CHECK(energy.opcode(0, &reg, &count, &mah) && reg == 1 && count == 1);
+}
+
+static void modem_requests(void)
+{
+  ASTRONODE_SIM sim;
+  CHECK(sim.start());
+  ASTRONODE_POSIX_SERIAL serial;
+  CHECK(serial.attach(sim.slave));
+  ASTRONODE astronode;
+  CHECK(astronode.begin(serial) == ANS_STATUS_SUCCESS);
+  ASTRONODE_ENERGY energy(config);
+  astronode.enableEnergyAccounting(energy);
+  energy.begin_cycle();
+
+  // Blocking request
+  uint32_t rtc_time;
+  CHECK(astronode.rtc_read(&rtc_time) == ANS_STATUS_SUCCESS);
+
+  // Non-blocking request, then one cancelled
+  uint8_t reg;
+  uint8_t param[4];
+  CHECK(astronode.async_request(RTC_RR, NULL, 0, 4) == ANS_STATUS_DATA_SENT);
+  ans_status_e ret_val;
+  while ((ret_val = astronode.async_poll(&reg, param, sizeof(param))) == ANS_STATUS_PENDING)
+  {
+    delay(1);
+  }
+  CHECK(ret_val == ANS_STATUS_DATA_RECEIVED && reg == RTC_RA);
+  CHECK(astronode.async_request(NCO_RR, NULL, 0, 4) == ANS_STATUS_DATA_SENT);
+  astronode.async_cancel();
+
+  uint16_t count;
+  float mah;
+  CHECK(energy.opcode_count() == 2);
+  CHECK(energy.opcode(0, &reg, &count, &mah) && reg == RTC_RR && count == 2 && mah > 0);
+  CHECK(energy.opcode(1, &reg, &count, &mah) && reg == NCO_RR && count == 1);
+  energy.end_cycle(0);
+  CHECK(energy.last_cycle().requests == 3);
+
+  // Bytes on the wire: RTC_RR 8 bytes and its answer 16 bytes twice, NCO_RR 8 bytes (2000 uA x 1 ms per byte)
+  CHECK(energy.last_cycle().uart == 2 * 2000ULL * (8 + 16) * 1000 + 2000ULL * 8 * 1000);
+}
+
+int main(void)
+{
+  charges();
+  folding();
+  modem_requests();
+
+  TEST_PASSED();
+}
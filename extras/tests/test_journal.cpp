@@ -0,0 +1,145 @@
+/******************************************************************************************
+ * File:        test_journal.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * ASTRONODE_JOURNAL on ASTRONODE_NVM_FILE: more than 65536 enqueue / ack cycles while the
+ * first payload stays queued (sequence numbers and payload IDs wrap, many compactions),
+ * reloads along the way, a module reset which keeps the module queue, and one which loses
+ * it after enqueues without service().
+ ****************************************************************************************/
+
+#include "astronode.h"
+#include "astronode_journal.h"
+#include "astronode_posix.h"
+#include "astronode_sim.h"
+#include "test.h"
+
+#include <algorithm>
+
+#define NVM_PATH "build/test_journal.nvm"
+#define JOURNAL_ADDRESS 64
+#define JOURNAL_SIZE 768 // README layout for a 1 KB EEPROM
+#define CYCLES 70000
+#define IN_FLIGHT 3       // Payloads kept in the module queue
+#define STICKY_ID 0       // First payload, acknowledged at the end
+#define RELOAD_PERIOD 33331 // Cycles between asset resets, the sequence numbers wrap in between
+
+static std::vector<uint16_t> journal_ids(ASTRONODE_JOURNAL &journal)
+{
+  uint16_t ids[ASTRONODE_JOURNAL_ENTRIES];
+  uint8_t cnt = journal.queued_ids(ids, ASTRONODE_JOURNAL_ENTRIES);
+  return std::vector<uint16_t>(ids, ids + cnt);
+}
+
+static void module_sends(ASTRONODE_SIM &sim,
+                         uint16_t id)
+{
+  std::lock_guard<std::mutex> guard(sim.lock);
+  for (size_t i = 0; i < sim.queue.size(); i++)
+  {
+    if (sim.queue[i].first == id)
+    {
+      sim.queue.erase(sim.queue.begin() + i);
+      return;
+    }
+  }
+  CHECK(false);
+}
+
+int main(void)
+{
+  ASTRONODE_SIM sim;
+  CHECK(sim.start());
+  ASTRONODE_POSIX_SERIAL serial;
+  CHECK(serial.attach(sim.slave));
+  ASTRONODE astronode;
+  CHECK(astronode.begin(serial) == ANS_STATUS_SUCCESS);
+
+  unlink(NVM_PATH);
+  ASTRONODE_NVM_FILE nvm;
+  CHECK(nvm.open(NVM_PATH));
+  ASTRONODE_JOURNAL *journal = new ASTRONODE_JOURNAL(astronode, nvm, JOURNAL_ADDRESS, JOURNAL_SIZE);
+  CHECK(journal->begin() == ANS_STATUS_SUCCESS);
+
+  uint32_t compactions = 0;
+  uint8_t data[8] = {};
+  CHECK(journal->enqueue_payload(data, sizeof(data), STICKY_ID) == ANS_STATUS_SUCCESS);
+  for (uint32_t cycle = 0; cycle < CYCLES; cycle++)
+  {
+    // IDs 1 to 65535, then wrap
+    memcpy(data, &cycle, sizeof(cycle));
+    CHECK(journal->enqueue_payload(data, sizeof(data), (uint16_t)(cycle % 0xFFFF + 1)) == ANS_STATUS_SUCCESS);
+    if (journal->queued_count() > IN_FLIGHT)
+    {
+      // Journal and module agree on the queue order, the sticky payload first
+      std::vector<uint16_t> ids = journal_ids(*journal);
+      CHECK(ids == sim.queue_ids());
+      CHECK(ids[0] == STICKY_ID);
+      module_sends(sim, ids[1]);
+      CHECK(journal->acknowledged(ids[1]) == ANS_STATUS_SUCCESS);
+    }
+
+    if (cycle % RELOAD_PERIOD == RELOAD_PERIOD - 1)
+    {
+      std::vector<uint16_t> ids = journal_ids(*journal);
+      compactions += journal->compactions();
+      delete journal;
+      journal = new ASTRONODE_JOURNAL(astronode, nvm, JOURNAL_ADDRESS, JOURNAL_SIZE);
+      CHECK(journal->begin() == ANS_STATUS_SUCCESS);
+      CHECK(journal_ids(*journal) == ids);
+      CHECK(journal->pending_count() == 0);
+    }
+  }
+  CHECK(journal_ids(*journal) == sim.queue_ids());
+  CHECK(journal->queued_count() == IN_FLIGHT);
+  compactions += journal->compactions();
+  CHECK(compactions > 65536 / ASTRONODE_JOURNAL_ENTRIES); // The live entries were copied across the wraps
+
+  // Module reset after sending the oldest payload: the other ones stay in its queue, the oldest is enqueued again
+  std::vector<uint16_t> ids = journal_ids(*journal);
+  CHECK(ids[0] == STICKY_ID);
+  module_sends(sim, ids[0]);
+  sim.uptime = 5;
+  delete journal;
+  journal = new ASTRONODE_JOURNAL(astronode, nvm, JOURNAL_ADDRESS, JOURNAL_SIZE);
+  CHECK(journal->begin() == ANS_STATUS_SUCCESS);
+  CHECK(sim.queue_ids() == std::vector<uint16_t>({ids[1], ids[2], ids[0]}));
+  CHECK(journal_ids(*journal) == sim.queue_ids());
+
+  // Not detected as a reset again
+  sim.uptime = 6;
+  delete journal;
+  journal = new ASTRONODE_JOURNAL(astronode, nvm, JOURNAL_ADDRESS, JOURNAL_SIZE);
+  CHECK(journal->begin() == ANS_STATUS_SUCCESS);
+  CHECK(journal_ids(*journal) == sim.queue_ids());
+
+  // Module reset after enqueues without service(), once its uptime passed the one of the last service(): the
+  // queue is lost with it, all the payloads are enqueued again
+  for (uint16_t id = 0xA000; id < 0xA003; id++)
+  {
+    sim.uptime += 1000;
+    CHECK(journal->enqueue_payload(data, sizeof(data), id) == ANS_STATUS_SUCCESS);
+  }
+  ids = journal_ids(*journal);
+  {
+    std::lock_guard<std::mutex> guard(sim.lock);
+    sim.queue.clear();
+    sim.uptime -= 500;
+  }
+  delete journal;
+  journal = new ASTRONODE_JOURNAL(astronode, nvm, JOURNAL_ADDRESS, JOURNAL_SIZE);
+  CHECK(journal->begin() == ANS_STATUS_SUCCESS);
+  CHECK(journal_ids(*journal) == sim.queue_ids());
+  std::vector<uint16_t> requeued = journal_ids(*journal);
+  std::sort(ids.begin(), ids.end());
+  std::sort(requeued.begin(), requeued.end());
+  CHECK(requeued == ids && ids.size() == 6);
+
+  printf("%u compactions\n", compactions);
+  delete journal;
+  nvm.close();
+  unlink(NVM_PATH);
+  TEST_PASSED();
+}
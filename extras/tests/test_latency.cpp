@@ -0,0 +1,78 @@
+/******************************************************************************************
+ * File:        test_latency.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * ASTRONODE_LATENCY: ids reused by the application after a dequeue, and payloads dequeued
+ * and enqueued again by ASTRONODE_UPLINK.
+ ****************************************************************************************/
+
+#include "astronode.h"
+#include "astronode_latency.h"
+#include "astronode_posix.h"
+#include "astronode_sim.h"
+#include "astronode_uplink.h"
+#include "test.h"
+
+static void reused_ids(void)
+{
+  ASTRONODE_LATENCY latency;
+
+  // Dequeued by the application, then the id is reused: a new payload, timed from its own enqueue
+  latency.enqueued(1, 0);
+  latency.dequeued(1);
+  CHECK(latency.unacked_count() == 1 && latency.in_flight() == 0);
+  latency.enqueued(1, 500000);
+  latency.acked(1, 560000);
+  CHECK(latency.acked_count() == 1 && latency.max() == 60);
+  CHECK(latency.unacked_count() == 1);
+
+  // Dequeued to be enqueued again: the same payload, timed from its first enqueue
+  latency.enqueued(2, 0);
+  latency.dequeued(2, true);
+  CHECK(latency.unacked_count() == 1 && latency.in_flight() == 1);
+  latency.enqueued(2, 100000);
+  latency.acked(2, 200000);
+  CHECK(latency.acked_count() == 2 && latency.max() == 200);
+  CHECK(latency.unacked_count() == 1 && latency.in_flight() == 0);
+}
+
+static void uplink(void)
+{
+  ASTRONODE_SIM sim;
+  CHECK(sim.start());
+  ASTRONODE_POSIX_SERIAL serial;
+  CHECK(serial.attach(sim.slave));
+  ASTRONODE astronode;
+  CHECK(astronode.begin(serial) == ANS_STATUS_SUCCESS);
+  ASTRONODE_LATENCY latency;
+  astronode.enableLatencyTracking(latency);
+  ASTRONODE_UPLINK uplink(astronode);
+
+  uint8_t data[4] = {};
+  for (uint16_t id = 1; id <= 3; id++)
+  {
+    CHECK(uplink.enqueue_payload(data, sizeof(data), id, UPLINK_PRIORITY_LOW) == ANS_STATUS_SUCCESS);
+  }
+  CHECK(uplink.enqueue_latest(data, sizeof(data), 4, 7, UPLINK_PRIORITY_LOW) == ANS_STATUS_SUCCESS);
+
+  // Preemption: displaced payloads are not unacked
+  CHECK(uplink.enqueue_payload(data, sizeof(data), 100, UPLINK_PRIORITY_HIGH) == ANS_STATUS_SUCCESS);
+  CHECK(uplink.displaced_total() == 3);
+  CHECK(latency.unacked_count() == 0 && latency.in_flight() == 5);
+
+  // Supersede: the stale payload is unacked, the ones after it are not
+  CHECK(sim.queue_ids() == std::vector<uint16_t>({1, 100, 2, 3, 4}));
+  CHECK(uplink.enqueue_payload(data, sizeof(data), 5, UPLINK_PRIORITY_LOW) == ANS_STATUS_SUCCESS);
+  CHECK(uplink.enqueue_latest(data, sizeof(data), 6, 7, UPLINK_PRIORITY_LOW) == ANS_STATUS_SUCCESS);
+  CHECK(uplink.superseded_total() == 1);
+  CHECK(latency.unacked_count() == 1 && latency.in_flight() == 6);
+}
+
+int main(void)
+{
+  reused_ids();
+  uplink();
+  TEST_PASSED();
+}
@@ -0,0 +1,119 @@
+/******************************************************************************************
+ * File:        test_link.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * ASTRONODE::transact() on link errors: request table lookup and timeouts, retries after
+ * a dropped answer, a corrupted CRC and a late answer, error answers, and a PLD_ER after
+ * a retried read which must not read the late answer of the read.
+ ****************************************************************************************/
+
+#include "astronode.h"
+#include "astronode_posix.h"
+#include "astronode_sim.h"
+#include "test.h"
+
+// Records the timeouts set by transact()
+class LINK_ASTRONODE : public ASTRONODE
+{
+
+public:
+  unsigned long timeout = 0;
+  int timeout_sets = 0;
+
+  using ASTRONODE::transact;
+
+protected:
+  void transport_set_timeout(unsigned long t)
+  {
+    timeout = t;
+    timeout_sets++;
+    ASTRONODE::transport_set_timeout(t);
+  }
+};
+
+static int sim_frames(ASTRONODE_SIM &sim)
+{
+  std::lock_guard<std::mutex> guard(sim.lock);
+  return sim.frames;
+}
+
+int main(void)
+{
+  ASTRONODE_SIM sim;
+  CHECK(sim.start());
+  ASTRONODE_POSIX_SERIAL serial;
+  CHECK(serial.attach(sim.slave));
+  LINK_ASTRONODE astronode;
+  CHECK(astronode.begin(serial) == ANS_STATUS_SUCCESS);
+  astronode.set_request_retries(1);
+  astronode.link_stats = {};
+  uint32_t rtc_time;
+
+  // Request table: unknown codes are not sent, the timeout of the table is set once
+  int frames = sim_frames(sim);
+  CHECK(astronode.transact(0x00) == ANS_STATUS_OPCODE_NOT_VALID);
+  CHECK(astronode.transact(0x16) == ANS_STATUS_OPCODE_NOT_VALID);
+  CHECK(astronode.transact(0xFF) == ANS_STATUS_OPCODE_NOT_VALID);
+  CHECK(sim_frames(sim) == frames && astronode.link_stats.requests == 0);
+  CHECK(astronode.rtc_read(&rtc_time) == ANS_STATUS_SUCCESS);
+  CHECK(astronode.read_performance_counter() == ANS_STATUS_SUCCESS);
+  CHECK(astronode.timeout == TIMEOUT_SERIAL);
+  int timeout_sets = astronode.timeout_sets;
+  CHECK(astronode.rtc_read(&rtc_time) == ANS_STATUS_SUCCESS);
+  CHECK(astronode.timeout_sets == timeout_sets);
+  astronode.link_stats = {};
+
+  // Dropped answer: retried
+  sim.drop = 1;
+  CHECK(astronode.rtc_read(&rtc_time) == ANS_STATUS_SUCCESS);
+  CHECK(astronode.link_stats.requests == 2 && astronode.link_stats.retries == 1);
+  CHECK(astronode.link_stats.timeouts == 1 && astronode.link_stats.crc_errors == 0);
+
+  // Corrupted CRC: retried
+  sim.corrupt = 1;
+  CHECK(astronode.rtc_read(&rtc_time) == ANS_STATUS_SUCCESS);
+  CHECK(astronode.link_stats.requests == 4 && astronode.link_stats.retries == 2);
+  CHECK(astronode.link_stats.timeouts == 1 && astronode.link_stats.crc_errors == 1);
+
+  // Error answer: given to the caller, not retried
+  uint16_t id;
+  CHECK(astronode.read_satellite_ack(&id) == ANS_STATUS_NO_ACK);
+  CHECK(astronode.link_stats.requests == 5 && astronode.link_stats.retries == 2);
+  CHECK(astronode.link_stats.error_answers == 1);
+
+  // Non idempotent request: not retried
+  uint8_t data[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+  sim.drop = 1;
+  CHECK(astronode.enqueue_payload(data, sizeof(data), 1) == ANS_STATUS_TIMEOUT);
+  CHECK(astronode.link_stats.requests == 6 && astronode.link_stats.retries == 2);
+  CHECK(astronode.link_stats.timeouts == 2);
+  CHECK(sim.queue_ids().empty());
+
+  // Late answer (after the timeout): the retry reads it, the answer to the retry comes during the PLD_ER
+  sim.late = 1;
+  sim.late_ms = TIMEOUT_SERIAL + 200;
+  sim.delay_ms = 50;
+  CHECK(astronode.rtc_read(&rtc_time) == ANS_STATUS_SUCCESS);
+  CHECK(astronode.link_stats.timeouts == 3 && astronode.link_stats.retries == 3);
+  CHECK(astronode.enqueue_payload(data, sizeof(data), 2) == ANS_STATUS_SUCCESS);
+  CHECK(astronode.link_stats.retries == 3 && astronode.link_stats.timeouts == 3);
+  CHECK(sim.queue_ids() == std::vector<uint16_t>({2}));
+  sim.delay_ms = 0;
+
+  // Answer preceded by the answer to the previous request: dropped, the answer is read
+  uint16_t stale = astronode.link_stats.stale_answers;
+  CHECK(astronode.rtc_read(&rtc_time) == ANS_STATUS_SUCCESS);
+  sim.repeat = 1;
+  CHECK(astronode.enqueue_payload(data, sizeof(data), 3) == ANS_STATUS_SUCCESS);
+  CHECK(astronode.link_stats.stale_answers == stale + 1);
+  CHECK(sim.queue_ids() == std::vector<uint16_t>({2, 3}));
+  sim.repeat = 1;
+  CHECK(astronode.rtc_read(&rtc_time) == ANS_STATUS_SUCCESS);
+  CHECK(rtc_time == sim.rtc + ASTROCAST_REF_UNIX_TIME);
+  CHECK(astronode.link_stats.stale_answers == stale + 2);
+  CHECK(astronode.link_stats.retries == 3 && astronode.link_stats.crc_errors == 1);
+
+  TEST_PASSED();
+}
@@ -0,0 +1,105 @@
+/******************************************************************************************
+ * File:        test_linktest.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * ASTRONODE_LINK_TEST start(), poll() and summary: test transmissions up to the module
+ * limit (MAX_TX_REACHED), a contact seen during the test and a module reset which is not
+ * one, and performance counter deltas across a clear of the counters.
+ ****************************************************************************************/
+
+#include "astronode.h"
+#include "astronode_linktest.h"
+#include "astronode_posix.h"
+#include "astronode_sim.h"
+#include "test.h"
+
+#define DURATION 300
+#define TX_INTERVAL 50
+
+// poll() until the end of the test, change() called once after the first poll
+template <class F>
+static ans_status_e run(ASTRONODE_LINK_TEST &test,
+                        uint8_t transmissions,
+                        F change)
+{
+  ans_status_e ret_val = test.start(DURATION, transmissions, TX_INTERVAL);
+  change();
+  while (ret_val == ANS_STATUS_PENDING)
+  {
+    delay(10);
+    ret_val = test.poll();
+  }
+  return ret_val;
+}
+
+static void set_per(ASTRONODE_SIM &sim,
+                    uint8_t type,
+                    uint32_t value)
+{
+  std::lock_guard<std::mutex> guard(sim.lock);
+  sim.per[PER_INDEX(type)] = value;
+}
+
+int main(void)
+{
+  ASTRONODE_SIM sim;
+  CHECK(sim.start());
+  ASTRONODE_POSIX_SERIAL serial;
+  CHECK(serial.attach(sim.slave));
+  ASTRONODE astronode;
+  CHECK(astronode.begin(serial) == ANS_STATUS_SUCCESS);
+  ASTRONODE_LINK_TEST test(astronode);
+
+  // Module limit after one transmission, a new contact, counters cleared during the test
+  sim.max_tx = 1;
+  sim.search_rssi = 5;
+  set_per(sim, PER_TYPE_SAT_DETECT_OPERATION_CNT, 100);
+  set_per(sim, PER_TYPE_SIGNAL_DEMOD_ATTEMPS_CNT, 10);
+  set_per(sim, PER_TYPE_ACK_DEMOD_SUCCESS_CNT, 0xFFFFFFF0);
+  CHECK(run(test, 4, [&] {
+          std::lock_guard<std::mutex> guard(sim.lock);
+          sim.contact_end = 800;
+          sim.contact_rssi = 12;
+          memset(sim.per, 0, sizeof(sim.per)); // PER_CR
+          sim.per[PER_INDEX(PER_TYPE_SAT_DETECT_OPERATION_CNT)] = 30;
+          sim.per[PER_INDEX(PER_TYPE_SIGNAL_DEMOD_ATTEMPS_CNT)] = 25;
+          sim.per[PER_INDEX(PER_TYPE_ACK_DEMOD_SUCCESS_CNT)] = 3;
+        }) == ANS_STATUS_SUCCESS);
+  const ASTRONODE_LINK_TEST::ASTRONODE_LINK_TEST_SUMMARY &summary = test.summary();
+  CHECK(summary.tx_requested == 2 && summary.tx_started == 1 && summary.max_tx_reached == true);
+  CHECK(sim.ttx_starts == 1);
+  CHECK(summary.duration >= DURATION);
+  CHECK(summary.samples == 1 && summary.detections == 1 && summary.peak_search_rssi == 5);
+  CHECK(summary.contacts == 1 && summary.peak_contact_rssi == 12);
+  CHECK(summary.sat_detect_cnt == 30);        // Cleared: the count since the clear
+  CHECK(summary.signal_demod_attempts == 15); // Not cleared before the end (25 after 10)
+  CHECK(summary.ack_demod_success == 3);
+  CHECK(summary.signal_demod_success == 0 && summary.ack_demod_attempts == 0);
+  CHECK(!test.running() && test.poll() == ANS_STATUS_SUCCESS);
+
+  // All transmissions accepted, no new contact
+  sim.max_tx = 255;
+  sim.ttx_starts = 0;
+  CHECK(run(test, 3, [] {}) == ANS_STATUS_SUCCESS);
+  CHECK(test.summary().tx_requested == 3 && test.summary().tx_started == 3);
+  CHECK(test.summary().max_tx_reached == false && sim.ttx_starts == 3);
+  CHECK(test.summary().contacts == 0 && test.summary().sat_detect_cnt == 0);
+
+  // Module reset during the test: the end of the last contact back to 0 is not a contact
+  CHECK(run(test, 0, [&] {
+          std::lock_guard<std::mutex> guard(sim.lock);
+          sim.contact_end = 0;
+        }) == ANS_STATUS_SUCCESS);
+  CHECK(test.summary().contacts == 0 && test.summary().tx_requested == 0);
+
+  // First contact after the reset
+  CHECK(run(test, 0, [&] {
+          std::lock_guard<std::mutex> guard(sim.lock);
+          sim.contact_end = 300;
+        }) == ANS_STATUS_SUCCESS);
+  CHECK(test.summary().contacts == 1);
+
+  TEST_PASSED();
+}
@@ -0,0 +1,165 @@
+/******************************************************************************************
+ * File:        test_manager.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * ASTRONODE_MANAGER with three simulated modules: refresh state machine, module selection
+ * (least msg_in_queue, then earliest next contact opportunity), re-dispatch of an
+ * uplink refused with BUFFER_FULL, and no resend of an uplink whose answer was lost.
+ ****************************************************************************************/
+
+#include "astronode.h"
+#include "astronode_manager.h"
+#include "astronode_posix.h"
+#include "astronode_sim.h"
+#include "test.h"
+
+#define MODEMS 3
+
+static ASTRONODE_MANAGER manager;
+static int done_cnt = 0;
+static uint16_t done_id;
+static uint8_t done_modem;
+static ans_status_e done_status;
+
+static void uplink_done(uint16_t id,
+                        uint8_t modem_index,
+                        ans_status_e status)
+{
+  done_cnt++;
+  done_id = id;
+  done_modem = modem_index;
+  done_status = status;
+}
+
+static bool all_valid(void)
+{
+  for (uint8_t i = 0; i < manager.modem_count(); i++)
+  {
+    if (!manager.modem_info(i)->valid || manager.modem_info(i)->state != MODEM_STATE_IDLE)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void run_until(bool (*condition)(void))
+{
+  unsigned long start = millis();
+  while (!condition())
+  {
+    CHECK(millis() - start < 2 * ASTRONODE_MANAGER_RETRY_PERIOD);
+    manager.poll();
+    manager.wait(50);
+  }
+}
+
+static int expected_done;
+static bool uplink_reported(void) { return done_cnt == expected_done; }
+
+// Enqueue one uplink, wait for its result and return the module it went to
+static uint8_t send_uplink(uint16_t id,
+                           ans_status_e status = ANS_STATUS_SUCCESS)
+{
+  uint8_t data[8] = {(uint8_t)id};
+  expected_done = done_cnt + 1;
+  CHECK(manager.enqueue_payload(data, sizeof(data), id) == ANS_STATUS_PENDING);
+  run_until(uplink_reported);
+  CHECK(done_id == id);
+  CHECK(done_status == status);
+  CHECK(manager.pending_uplinks() == 0);
+  return done_modem;
+}
+
+int main(void)
+{
+  ASTRONODE_SIM sim[MODEMS];
+  ASTRONODE_POSIX_SERIAL serial[MODEMS];
+  ASTRONODE astronode[MODEMS];
+
+  // Module 1 has the earliest contact, module 2 has payloads queued already
+  sim[0].nco = 300;
+  sim[1].nco = 20;
+  sim[2].nco = 5;
+  sim[2].queue.push_back(ASTRONODE_SIM::payload_t(1000, std::vector<uint8_t>(4)));
+  sim[2].queue.push_back(ASTRONODE_SIM::payload_t(1001, std::vector<uint8_t>(4)));
+
+  manager.onUplinkDone(uplink_done);
+  for (int i = 0; i < MODEMS; i++)
+  {
+    sim[i].delay_ms = 20;
+    CHECK(sim[i].start());
+    CHECK(serial[i].attach(sim[i].slave));
+    CHECK(astronode[i].begin(serial[i]) == ANS_STATUS_SUCCESS);
+    CHECK(manager.add_modem(astronode[i], sim[i].slave));
+  }
+  CHECK(manager.modem_count() == MODEMS);
+
+  // State machine: IDLE -> WAIT_MST -> WAIT_NCO -> IDLE with a valid module state
+  CHECK(manager.modem_info(0)->state == MODEM_STATE_IDLE);
+  CHECK(!manager.modem_info(0)->valid);
+  manager.poll();
+  CHECK(manager.modem_info(0)->state == MODEM_STATE_WAIT_MST);
+  run_until(all_valid);
+  for (int i = 0; i < MODEMS; i++)
+  {
+    CHECK(manager.modem_info(i)->nco == sim[i].nco);
+  }
+  CHECK(manager.modem_info(0)->msg_in_queue == 0);
+  CHECK(manager.modem_info(2)->msg_in_queue == 2);
+
+  // Uplinks wait for a module while none is valid
+  ASTRONODE_MANAGER idle_manager;
+  uint8_t data[4] = {};
+  CHECK(idle_manager.enqueue_payload(data, sizeof(data), 1) == ANS_STATUS_PENDING);
+  idle_manager.poll();
+  CHECK(idle_manager.pending_uplinks() == 1);
+
+  // Module 1 is the best one, but its queue was filled behind the manager's back:
+  // the uplink is refused with BUFFER_FULL and goes to module 0 instead
+  {
+    std::lock_guard<std::mutex> guard(sim[1].lock);
+    for (uint16_t id = 2000; sim[1].queue.size() < SIM_QUEUE_SIZE; id++)
+    {
+      sim[1].queue.push_back(ASTRONODE_SIM::payload_t(id, std::vector<uint8_t>(4)));
+    }
+  }
+  CHECK(send_uplink(100) == 0);
+  CHECK(manager.modem_info(1)->msg_in_queue == ASN_MSG_QUEUE_SIZE);
+  CHECK(manager.modem_info(1)->enqueued_cnt == 0);
+  CHECK(sim[0].queue_ids() == std::vector<uint16_t>({100}));
+
+  // Queue depths now 1, 8, 2: least loaded first, earliest contact on equal load
+  CHECK(send_uplink(101) == 0); // 1 < 2
+  CHECK(send_uplink(102) == 2); // 2 == 2, contact in 5 s before 300 s
+  CHECK(send_uplink(103) == 0); // 2 < 3
+  CHECK(send_uplink(104) == 2); // 3 == 3
+  CHECK(manager.modem_info(0)->enqueued_cnt == 3);
+  CHECK(manager.modem_info(2)->enqueued_cnt == 2);
+  CHECK(sim[2].queue_ids() == std::vector<uint16_t>({1000, 1001, 102, 104}));
+
+  // Module 0 stops answering: the uplink is reported, not sent to module 2, and module 0 is marked invalid
+  sim[0].drop = 1;
+  CHECK(send_uplink(105, ANS_STATUS_TIMEOUT) == 0);
+  CHECK(!manager.modem_info(0)->valid);
+  CHECK(manager.modem_info(0)->error_cnt == 1);
+  CHECK(send_uplink(106) == 2); // Module 0 not used until refreshed
+  CHECK(manager.modem_info(2)->msg_in_queue == 5);
+  CHECK(sim[2].queue_ids() == std::vector<uint16_t>({1000, 1001, 102, 104, 106}));
+
+  // Answer after the deadline, the payload queued: reported, never queued again in any module
+  run_until(all_valid);
+  sim[0].late = 1;
+  sim[0].late_ms = TIMEOUT_SERIAL + 200;
+  CHECK(send_uplink(107, ANS_STATUS_TIMEOUT) == 0);
+  CHECK(manager.modem_info(0)->error_cnt == 2);
+  CHECK(send_uplink(108) == 2);
+  run_until(all_valid);
+  CHECK(sim[0].queue_ids() == std::vector<uint16_t>({100, 101, 103, 107}));
+  CHECK(sim[2].queue_ids() == std::vector<uint16_t>({1000, 1001, 102, 104, 106, 108}));
+  CHECK(manager.modem_info(0)->msg_in_queue == 4 && manager.pending_uplinks() == 0);
+
+  TEST_PASSED();
+}
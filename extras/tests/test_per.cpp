@@ -0,0 +1,99 @@
+/******************************************************************************************
+ * File:        test_per.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * Performance counters: decoding into the named fields, per_counter() indexing, and
+ * ASTRONODE_PER_DELTA across wraparound, clear and module reset, and its ratios.
+ ****************************************************************************************/
+
+#include "astronode.h"
+#include "astronode_per.h"
+#include "astronode_posix.h"
+#include "astronode_sim.h"
+#include "test.h"
+
+int main(void)
+{
+  ASTRONODE_SIM sim;
+  CHECK(sim.start());
+  ASTRONODE_POSIX_SERIAL serial;
+  CHECK(serial.attach(sim.slave));
+  ASTRONODE astronode;
+  CHECK(astronode.begin(serial) == ANS_STATUS_SUCCESS);
+
+  // Named fields and indexed access see the same counters
+  for (int i = 0; i < PER_TYPE_CNT; i++)
+  {
+    sim.per[i] = 1000 + i;
+  }
+  CHECK(astronode.read_performance_counter() == ANS_STATUS_SUCCESS);
+  CHECK(astronode.per_struct.sat_search_phase_cnt == 1000);
+  CHECK(astronode.per_struct.queued_msg_cnt == 1007);
+  CHECK(astronode.per_struct.cmd_demod_success_cnt == 1013);
+  for (uint8_t type = PER_TYPE_SAT_SEARCH_PHASE_CNT; type <= PER_TYPE_CMD_DEMOD_SUCCESS_CNT; type++)
+  {
+    CHECK(*ASTRONODE::per_counter(&astronode.per_struct, PER_INDEX(type)) == 1000u + PER_INDEX(type));
+  }
+  *ASTRONODE::per_counter(&astronode.per_struct, PER_INDEX(PER_TYPE_ACK_MSG_CNT)) = 7;
+  CHECK(astronode.per_struct.ack_msg_cnt == 7);
+
+  // Deltas across the 32-bit wraparound
+  ASTRONODE_PER_DELTA per(astronode);
+  for (int i = 0; i < PER_TYPE_CNT; i++)
+  {
+    sim.per[i] = 0xFFFFFFF0u + i;
+  }
+  CHECK(per.update() == ANS_STATUS_SUCCESS && per.count() == 0);
+  for (int i = 0; i < PER_TYPE_CNT; i++)
+  {
+    sim.per[i] += 20 + i;
+  }
+  sim.uptime += 60;
+  CHECK(per.update() == ANS_STATUS_SUCCESS && per.count() == 1);
+  CHECK(per.delta(PER_TYPE_SAT_SEARCH_PHASE_CNT, 1) == 20);
+  CHECK(per.delta(PER_TYPE_CMD_DEMOD_SUCCESS_CNT, 1) == 33);
+  CHECK(per.duration(1) == 60);
+
+  // Counted from 0 after a clear
+  CHECK(astronode.clear_performance_counter() == ANS_STATUS_SUCCESS);
+  for (int i = 0; i < PER_TYPE_CNT; i++)
+  {
+    sim.per[i] = 5;
+  }
+  sim.uptime += 10;
+  CHECK(per.update() == ANS_STATUS_SUCCESS && per.count() == 2);
+  CHECK(per.delta(PER_TYPE_ACK_MSG_CNT, 1) == 5);
+  CHECK(!per.reset_detected());
+
+  // No interval across a module reset
+  sim.uptime = 3;
+  CHECK(per.update() == ANS_STATUS_SUCCESS && per.reset_detected() && per.count() == 2);
+  sim.uptime = 13;
+  for (int i = 0; i < PER_TYPE_CNT; i++)
+  {
+    sim.per[i] = 7;
+  }
+  CHECK(per.update() == ANS_STATUS_SUCCESS && per.count() == 3);
+  CHECK(per.delta(PER_TYPE_ACK_MSG_CNT, 1) == 2);
+  CHECK(per.delta(PER_TYPE_ACK_MSG_CNT, ASTRONODE_PER_WINDOW_SIZE) == 29 + 5 + 2);
+
+  // Ratios: per mille, clamped to 1000 when the numerator delta is larger (saturated deltas)
+  sim.uptime += 10;
+  sim.per[PER_INDEX(PER_TYPE_SIGNAL_DEMOD_ATTEMPS_CNT)] += 1000;
+  sim.per[PER_INDEX(PER_TYPE_SIGNAL_DEMOD_SUCCESS_CNT)] += 500;
+  CHECK(per.update() == ANS_STATUS_SUCCESS);
+  CHECK(per.signal_demod_success_ratio(1) == 500);
+  CHECK(per.ratio(PER_TYPE_ACK_MSG_CNT, PER_TYPE_SIGNAL_DEMOD_ATTEMPS_CNT, 1) == 0);
+  CHECK(per.ratio(PER_TYPE_SIGNAL_DEMOD_ATTEMPS_CNT, PER_TYPE_ACK_MSG_CNT, 1) == PER_RATIO_UNDEFINED);
+  sim.uptime += 10;
+  sim.per[PER_INDEX(PER_TYPE_SIGNAL_DEMOD_ATTEMPS_CNT)] += 1;
+  sim.per[PER_INDEX(PER_TYPE_SIGNAL_DEMOD_SUCCESS_CNT)] += 0x10000;
+  CHECK(per.update() == ANS_STATUS_SUCCESS);
+  CHECK(per.delta(PER_TYPE_SIGNAL_DEMOD_SUCCESS_CNT, 1) == 0xFFFF);
+  CHECK(per.signal_demod_success_ratio(1) == 1000);
+  CHECK(per.signal_demod_success_ratio(ASTRONODE_PER_WINDOW_SIZE) == 1000);
+
+  TEST_PASSED();
+}
@@ -0,0 +1,61 @@
+/******************************************************************************************
+ * File:        test_posix.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * ASTRONODE on ASTRONODE_POSIX_SERIAL: request / answer round trips through a
+ * pseudo-terminal, and timeouts when the module side goes away.
+ ****************************************************************************************/
+
+#include "astronode.h"
+#include "astronode_posix.h"
+#include "astronode_sim.h"
+#include "test.h"
+
+int main(void)
+{
+  ASTRONODE_SIM sim;
+  CHECK(sim.start());
+  ASTRONODE_POSIX_SERIAL serial;
+  CHECK(serial.attach(sim.slave));
+
+  ASTRONODE astronode;
+  CHECK(astronode.begin(serial) == ANS_STATUS_SUCCESS);
+
+  // Round trips
+  uint32_t rtc_time;
+  CHECK(astronode.rtc_read(&rtc_time) == ANS_STATUS_SUCCESS);
+  CHECK(rtc_time == 100000 + ASTROCAST_REF_UNIX_TIME);
+
+  uint8_t data[10] = {1, 2, 3};
+  CHECK(astronode.enqueue_payload(data, sizeof(data), 5) == ANS_STATUS_SUCCESS);
+  CHECK(astronode.enqueue_payload(data, sizeof(data), 5) == ANS_STATUS_DUPLICATE_ID);
+  CHECK(sim.queue_ids().size() == 1);
+
+  CHECK(astronode.read_module_state() == ANS_STATUS_SUCCESS);
+  CHECK(astronode.mst_struct.msg_in_queue == 1);
+  CHECK(astronode.mst_struct.uptime == 1000);
+
+  String guid;
+  CHECK(astronode.guid_read(&guid) == ANS_STATUS_SUCCESS);
+  CHECK(guid.length() == 36);
+
+  // Unanswered request: the transaction times out
+  sim.drop = 1;
+  unsigned long start = millis();
+  CHECK(astronode.rtc_read(&rtc_time) == ANS_STATUS_TIMEOUT);
+  CHECK(millis() - start >= TIMEOUT_SERIAL);
+  CHECK(astronode.rtc_read(&rtc_time) == ANS_STATUS_SUCCESS);
+
+  // Module side closed: reads fail at once instead of spinning until the timeout
+  sim.hangup();
+  start = millis();
+  serial.setTimeout(TIMEOUT_SERIAL);
+  char byte;
+  CHECK(serial.readBytes(&byte, 1) == 0);
+  CHECK(millis() - start < 100);
+  CHECK(astronode.rtc_read(&rtc_time) != ANS_STATUS_SUCCESS);
+
+  TEST_PASSED();
+}
@@ -0,0 +1,167 @@
+/******************************************************************************************
+ * File:        test_rtos.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * ASTRONODE_SPSC_QUEUE and ASTRONODE_RTOS under load: producer and consumer threads, and
+ * several client threads served by one modem thread.
+ ****************************************************************************************/
+
+#include "astronode.h"
+#include "astronode_posix.h"
+#include "astronode_rtos.h"
+#include "astronode_sim.h"
+#include "test.h"
+
+#define SPSC_ITEMS 1000000
+#define CLIENTS 3
+#define CLIENT_REQUESTS 200
+
+typedef struct
+{
+  uint32_t seq;
+  uint32_t check; // ~seq, detects torn items
+  uint8_t fill[24];
+} ITEM;
+
+static void spsc_stress(void)
+{
+  static ASTRONODE_SPSC_QUEUE<ITEM, 4> queue;
+
+  std::thread producer([] {
+    for (uint32_t seq = 0; seq < SPSC_ITEMS;)
+    {
+      ITEM item;
+      item.seq = seq;
+      item.check = ~seq;
+      memset(item.fill, (uint8_t)seq, sizeof(item.fill));
+      if (queue.push(item))
+      {
+        seq++;
+      }
+      else
+      {
+        std::this_thread::yield(); // A task would block here
+      }
+    }
+  });
+
+  uint32_t expected = 0;
+  while (expected < SPSC_ITEMS)
+  {
+    ITEM item;
+    if (!queue.pop(&item))
+    {
+      std::this_thread::yield();
+      continue;
+    }
+    CHECK(item.seq == expected);
+    CHECK(item.check == ~expected);
+    CHECK(item.fill[0] == (uint8_t)expected && item.fill[sizeof(item.fill) - 1] == (uint8_t)expected);
+    expected++;
+  }
+  producer.join();
+  CHECK(queue.empty());
+}
+
+static void service_stress(void)
+{
+  ASTRONODE_SIM sim;
+  CHECK(sim.start());
+  ASTRONODE_POSIX_SERIAL serial;
+  CHECK(serial.attach(sim.slave));
+  ASTRONODE astronode;
+  CHECK(astronode.begin(serial) == ANS_STATUS_SUCCESS);
+
+  ASTRONODE_RTOS rtos(astronode);
+  int8_t clients[CLIENTS];
+  for (int c = 0; c < CLIENTS; c++)
+  {
+    clients[c] = rtos.register_client();
+    CHECK(clients[c] >= 0);
+  }
+
+  std::atomic<bool> stop{false};
+  std::thread modem([&] {
+    while (!stop)
+    {
+      if (!rtos.service())
+      {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  // Client 0 enqueues and dequeues payloads, clients 1.. read the RTC and the events
+  std::thread client_threads[CLIENTS];
+  for (int c = 0; c < CLIENTS; c++)
+  {
+    client_threads[c] = std::thread([&, c] {
+      uint8_t client = clients[c];
+      uint32_t submitted = 0;
+      uint32_t completed = 0;
+      while (completed < CLIENT_REQUESTS)
+      {
+        bool ok = false;
+        if (submitted < CLIENT_REQUESTS)
+        {
+          if (c != 0)
+          {
+            ok = rtos.submit(client, (submitted & 1) ? RTOS_OP_EVENT_READ : RTOS_OP_RTC_READ, submitted);
+          }
+          else if (submitted & 1)
+          {
+            ok = rtos.submit(client, RTOS_OP_DEQUEUE_PAYLOAD, submitted);
+          }
+          else
+          {
+            uint8_t data[8] = {(uint8_t)submitted};
+            ok = rtos.submit_enqueue_payload(client, data, sizeof(data), (uint16_t)submitted, submitted);
+          }
+          submitted += ok ? 1 : 0;
+        }
+
+        ASTRONODE_RTOS_COMPLETION completion;
+        while (rtos.poll_completion(client, &completion))
+        {
+          // Completions come back in order, with the fields of their own request
+          CHECK(completion.tag == completed);
+          CHECK(completion.status == ANS_STATUS_SUCCESS);
+          if (c != 0)
+          {
+            CHECK(completion.op == ((completed & 1) ? RTOS_OP_EVENT_READ : RTOS_OP_RTC_READ));
+            CHECK((completed & 1) || completion.value == 100000 + ASTROCAST_REF_UNIX_TIME);
+          }
+          else if (completed & 1)
+          {
+            CHECK(completion.op == RTOS_OP_DEQUEUE_PAYLOAD);
+            CHECK(completion.id == (uint16_t)(completed - 1));
+          }
+          else
+          {
+            CHECK(completion.op == RTOS_OP_ENQUEUE_PAYLOAD);
+          }
+          completed++;
+        }
+        std::this_thread::yield();
+      }
+    });
+  }
+  for (int c = 0; c < CLIENTS; c++)
+  {
+    client_threads[c].join();
+  }
+  stop = true;
+  modem.join();
+
+  CHECK(sim.queue_ids().empty());
+  CHECK(!rtos.service());
+}
+
+int main(void)
+{
+  spsc_stress();
+  service_stress();
+  TEST_PASSED();
+}
@@ -0,0 +1,184 @@
+/******************************************************************************************
+ * File:        test_search.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * Energy versus missed contacts of ASTRONODE_SEARCH_CTRL, on a simulated week of
+ * satellite passes. The controller runs against the simulated module every 5 minutes of
+ * simulated time; between updates, search phases are placed at the period it wrote
+ * (SSC_WR). A pass is missed when no search phase falls in its usable window. The
+ * number of search phases stands for the search energy. Fixed fastest and slowest
+ * periods are simulated for comparison. Then the period written again after module resets.
+ ****************************************************************************************/
+
+#include "astronode.h"
+#include "astronode_posix.h"
+#include "astronode_search.h"
+#include "astronode_sim.h"
+#include "test.h"
+
+#include <algorithm>
+
+#define SIM_DAYS 7
+#define UPDATE_PERIOD 300 // s, ASTRONODE_SEARCH_CTRL::update() period
+
+typedef struct
+{
+  double start; // s
+  double end;   // s, end of the usable window
+  uint8_t rssi;
+} PASS;
+
+typedef struct
+{
+  uint32_t search_phases;
+  uint16_t missed;
+  uint16_t ssc_writes;
+} RESULT;
+
+static const uint16_t period_ms[] = {0, 1377, 2755, 4132, 15150, 17905, 23414}; // SAT_SEARCH_*
+
+static std::vector<PASS> passes;
+
+static void generate_passes(void)
+{
+  uint32_t seed = 12345;
+  double t = 600;
+  while (t < SIM_DAYS * 86400.0)
+  {
+    seed = seed * 1103515245 + 12345;
+    double window = 10 + (seed >> 16) % 80; // Usable part of the pass, 10 to 90 s
+    seed = seed * 1103515245 + 12345;
+    passes.push_back({t, t + window, (uint8_t)(3 + (seed >> 16) % 8)});
+    seed = seed * 1103515245 + 12345;
+    t += window + 1800 + (seed >> 16) % 5400; // 30 to 120 min between passes
+  }
+}
+
+// search_period: SAT_SEARCH_* for a fixed period, SAT_SEARCH_DEFAULT for the controller
+static RESULT simulate(ASTRONODE &astronode,
+                       ASTRONODE_SIM &sim,
+                       uint8_t search_period)
+{
+  RESULT result = {};
+  ASTRONODE_SEARCH_CTRL ctrl(astronode);
+  std::vector<bool> detected(passes.size(), false);
+  size_t next_pass = 0; // First pass not over yet
+  double last_phase = -1;
+  bool last_phase_detect = false;
+  uint32_t contact_end = 0;
+  int writes_start = sim.ssc_writes;
+
+  uint8_t period = search_period;
+  for (double now = 0; now < SIM_DAYS * 86400.0; now += UPDATE_PERIOD)
+  {
+    while (next_pass < passes.size() && passes[next_pass].end < now)
+    {
+      next_pass++;
+    }
+
+    if (search_period == SAT_SEARCH_DEFAULT)
+    {
+      // Module view at the time of the update
+      sim.nco = (next_pass == passes.size()) ? 86400 : (uint32_t)std::max(0.0, passes[next_pass].start - now);
+      sim.search_rssi = last_phase_detect ? 8 : 2;
+      sim.search_age = (last_phase < 0) ? 0xFFFFFFFF : (uint32_t)(now - last_phase);
+      sim.contact_end = contact_end;
+      CHECK(ctrl.update() == ANS_STATUS_SUCCESS);
+      period = ctrl.period();
+      CHECK(period == sim.ssc_period);
+    }
+
+    // Search phases until the next update
+    double phase = (last_phase < 0) ? now : last_phase + period_ms[period] / 1000.0;
+    for (; phase < now + UPDATE_PERIOD; phase += period_ms[period] / 1000.0)
+    {
+      result.search_phases++;
+      last_phase = phase;
+      last_phase_detect = false;
+      for (size_t p = next_pass; p < passes.size() && passes[p].start <= phase; p++)
+      {
+        if (phase <= passes[p].end)
+        {
+          last_phase_detect = true;
+          if (!detected[p])
+          {
+            detected[p] = true;
+            contact_end = (uint32_t)passes[p].end;
+            sim.contact_rssi = passes[p].rssi;
+          }
+        }
+      }
+    }
+  }
+
+  for (size_t p = 0; p < passes.size(); p++)
+  {
+    result.missed += detected[p] ? 0 : 1;
+  }
+  result.ssc_writes = sim.ssc_writes - writes_start;
+  return result;
+}
+
+// The period is written again after a module reset (reset reason changed or uptime lower), not otherwise
+static void module_reset(ASTRONODE &astronode,
+                         ASTRONODE_SIM &sim)
+{
+  ASTRONODE_SEARCH_CTRL ctrl(astronode);
+  sim.nco = 86400;
+  sim.search_age = 0xFFFFFFFF;
+  CHECK(ctrl.update() == ANS_STATUS_SUCCESS);
+  CHECK(ctrl.write_count() == 1 && sim.ssc_period == ctrl.period());
+  sim.uptime += UPDATE_PERIOD;
+  CHECK(ctrl.update() == ANS_STATUS_SUCCESS);
+  CHECK(ctrl.write_count() == 1);
+
+  sim.uptime = 10;
+  sim.ssc_period = SAT_SEARCH_DEFAULT;
+  CHECK(ctrl.update() == ANS_STATUS_SUCCESS);
+  CHECK(ctrl.write_count() == 2 && sim.ssc_period == ctrl.period());
+  sim.uptime += UPDATE_PERIOD;
+  CHECK(ctrl.update() == ANS_STATUS_SUCCESS);
+  CHECK(ctrl.write_count() == 2);
+
+  sim.last_rst++;
+  sim.uptime += UPDATE_PERIOD;
+  sim.ssc_period = SAT_SEARCH_DEFAULT;
+  CHECK(ctrl.update() == ANS_STATUS_SUCCESS);
+  CHECK(ctrl.write_count() == 3 && sim.ssc_period == ctrl.period());
+}
+
+int main(void)
+{
+  ASTRONODE_SIM sim;
+  CHECK(sim.start());
+  ASTRONODE_POSIX_SERIAL serial;
+  CHECK(serial.attach(sim.slave));
+  ASTRONODE astronode;
+  CHECK(astronode.begin(serial) == ANS_STATUS_SUCCESS);
+
+  generate_passes();
+  RESULT fastest = simulate(astronode, sim, SAT_SEARCH_1377_MS);
+  RESULT slowest = simulate(astronode, sim, SAT_SEARCH_23414_MS);
+  RESULT adaptive = simulate(astronode, sim, SAT_SEARCH_DEFAULT);
+
+  printf("%u passes in %d days\n", (unsigned)passes.size(), SIM_DAYS);
+  printf("  period        search phases  missed passes  SSC_WR\n");
+  printf("  1377 ms       %13u  %13u  %6u\n", fastest.search_phases, fastest.missed, fastest.ssc_writes);
+  printf("  23414 ms      %13u  %13u  %6u\n", slowest.search_phases, slowest.missed, slowest.ssc_writes);
+  printf("  controller    %13u  %13u  %6u\n", adaptive.search_phases, adaptive.missed, adaptive.ssc_writes);
+
+  // The controller misses no more passes than the fastest period, for a fraction of its search energy
+  CHECK(fastest.missed == 0);
+  CHECK(slowest.missed > 0);
+  CHECK(adaptive.missed == fastest.missed);
+  CHECK(adaptive.search_phases < fastest.search_phases / 2);
+  CHECK(adaptive.search_phases > slowest.search_phases);
+  // SSC_WR only when the period changes: fastest before a pass, then one step slower per update
+  CHECK(adaptive.ssc_writes <= (SAT_SEARCH_23414_MS - SAT_SEARCH_1377_MS + 1) * passes.size());
+
+  module_reset(astronode, sim);
+
+  TEST_PASSED();
+}
@@ -0,0 +1,194 @@
+/******************************************************************************************
+ * File:        test_snapshot.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * snapshot_read() while publications are made, from another thread and from a signal
+ * handler (as from an ISR): every field of a snapshot must come from the same publication. Also built without ASTRONODE_WITH_SNAPSHOT
+ * (build/test_snapshot_off): no snapshot API, the read_*() calls still update the
+ * structures.
+ ****************************************************************************************/
+
+#include "astronode.h"
+#include "astronode_posix.h"
+#include "astronode_sim.h"
+#include "test.h"
+
+#include <signal.h>
+#include <sys/time.h>
+#include <atomic>
+#include <thread>
+#include <utility>
+
+#define PUBLICATIONS 500000
+#define ISR_READS 20000
+
+template <class T>
+static constexpr bool has_snapshot(decltype(std::declval<T>().snapshot_read(nullptr)) *)
+{
+  return true;
+}
+template <class T>
+static constexpr bool has_snapshot(...)
+{
+  return false;
+}
+
+static void read_structures(void)
+{
+  ASTRONODE_SIM sim;
+  sim.uptime = 4321;
+  sim.per[PER_INDEX(PER_TYPE_ACK_MSG_CNT)] = 17;
+  CHECK(sim.start());
+  ASTRONODE_POSIX_SERIAL serial;
+  CHECK(serial.attach(sim.slave));
+  ASTRONODE astronode;
+  CHECK(astronode.begin(serial) == ANS_STATUS_SUCCESS);
+  CHECK(astronode.read_performance_counter() == ANS_STATUS_SUCCESS);
+  CHECK(astronode.mst_struct.uptime == 4321 && astronode.per_struct.ack_msg_cnt == 17);
+
+#if defined(ASTRONODE_WITH_SNAPSHOT)
+  ASTRONODE::ASTRONODE_SNAPSHOT snapshot;
+  astronode.snapshot_read(&snapshot);
+  CHECK(snapshot.mst.uptime == 4321 && snapshot.per.ack_msg_cnt == 17);
+#endif
+}
+
+#if defined(ASTRONODE_WITH_SNAPSHOT)
+// Publication n: all the fields derived from n
+static void publish(ASTRONODE &astronode,
+                    uint32_t n)
+{
+  for (uint8_t i = 0; i < PER_TYPE_CNT; i++)
+  {
+    *ASTRONODE::per_counter(&astronode.per_struct, i) = n + i;
+  }
+  astronode.end_struct.time_since_last_sat_search = n;
+  astronode.end_struct.last_sat_search_peak_rssi = (uint8_t)n;
+  astronode.lcd_struct.time_start_last_contact = n;
+  astronode.lcd_struct.time_end_last_contact = n + 1;
+  astronode.lcd_struct.time_peak_rssi_last_contact = n + 2;
+
+  uint8_t mst[MST_CMD_LENGTH] = {MST_TYPE_MSG_IN_QUEUE, 1, (uint8_t)n,
+                                 MST_TYPE_ACK_MSG_QUEUE, 1, (uint8_t)(n >> 8),
+                                 MST_TYPE_LAST_RST, 1, (uint8_t)(n >> 16),
+                                 MST_UPTIME, 4};
+  memcpy(&mst[11], &n, sizeof(n));
+  astronode.decode_module_state(mst); // Publishes
+}
+
+// All the fields of s from the same publication
+static bool consistent(const ASTRONODE::ASTRONODE_SNAPSHOT &s)
+{
+  uint32_t n = s.mst.uptime;
+  ASTRONODE::ASTRONODE_PER_STRUCT per = s.per;
+  for (uint8_t i = 0; i < PER_TYPE_CNT; i++)
+  {
+    if (*ASTRONODE::per_counter(&per, i) != (n ? n + i : 0))
+    {
+      return false;
+    }
+  }
+  return s.mst.msg_in_queue == (uint8_t)n &&
+         s.mst.ack_msg_in_queue == (uint8_t)(n >> 8) &&
+         s.mst.last_rst == (uint8_t)(n >> 16) &&
+         s.end.time_since_last_sat_search == n &&
+         s.end.last_sat_search_peak_rssi == (uint8_t)n &&
+         s.lcd.time_start_last_contact == n &&
+         s.lcd.time_end_last_contact == (n ? n + 1 : 0) &&
+         s.lcd.time_peak_rssi_last_contact == (n ? n + 2 : 0);
+}
+
+// Reader in another thread
+static void thread_reads(void)
+{
+  ASTRONODE astronode;
+  std::atomic<bool> done{false};
+
+  // One publication per reader time slice at most, as the UART answers would (the version is 8-bit)
+  std::thread writer([&] {
+    for (uint32_t n = 1; n <= PUBLICATIONS; n++)
+    {
+      publish(astronode, n);
+      std::this_thread::yield();
+    }
+    done = true;
+  });
+
+  uint32_t last = 0;
+  uint32_t seen = 0;
+  while (!done)
+  {
+    ASTRONODE::ASTRONODE_SNAPSHOT s;
+    astronode.snapshot_read(&s);
+    CHECK(consistent(s));
+    CHECK(s.mst.uptime >= last); // Never an older publication
+    if (s.mst.uptime != last)
+    {
+      seen++;
+    }
+    last = s.mst.uptime;
+    std::this_thread::yield();
+  }
+  writer.join();
+
+  ASTRONODE::ASTRONODE_SNAPSHOT s;
+  astronode.snapshot_read(&s);
+  CHECK(s.mst.uptime == PUBLICATIONS);
+  CHECK(astronode.snapshot_version() == (uint8_t)PUBLICATIONS);
+  CHECK(seen > 1);
+}
+
+// Reader in a signal handler, which interrupts the publications at any point (as an ISR would)
+static ASTRONODE *isr_astronode = NULL;
+static volatile sig_atomic_t isr_reads = 0;
+static volatile sig_atomic_t isr_torn = 0;
+
+static void isr(int signal)
+{
+  (void)signal;
+  ASTRONODE::ASTRONODE_SNAPSHOT s;
+  isr_astronode->snapshot_read(&s);
+  if (!consistent(s))
+  {
+    isr_torn = isr_torn + 1;
+  }
+  isr_reads = isr_reads + 1;
+}
+
+static void isr_reads_test(void)
+{
+  ASTRONODE astronode;
+  isr_astronode = &astronode;
+  signal(SIGALRM, isr);
+  struct itimerval period = {{0, 37}, {0, 37}};
+  CHECK(setitimer(ITIMER_REAL, &period, NULL) == 0);
+
+  uint32_t n = 1;
+  while (isr_reads < ISR_READS)
+  {
+    publish(astronode, n++);
+  }
+
+  struct itimerval off = {};
+  setitimer(ITIMER_REAL, &off, NULL);
+  signal(SIGALRM, SIG_DFL);
+  printf("%d snapshots read from the signal handler, %u publications\n", (int)isr_reads, n - 1);
+  CHECK(isr_torn == 0);
+}
+#endif
+
+int main(void)
+{
+#if defined(ASTRONODE_WITH_SNAPSHOT)
+  static_assert(has_snapshot<ASTRONODE>(nullptr), "snapshot_read() expected");
+  thread_reads();
+  isr_reads_test();
+#else
+  static_assert(!has_snapshot<ASTRONODE>(nullptr), "snapshot_read() without ASTRONODE_WITH_SNAPSHOT");
+#endif
+  read_structures();
+
+  TEST_PASSED();
+}
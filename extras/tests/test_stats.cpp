@@ -0,0 +1,149 @@
+/******************************************************************************************
+ * File:        test_stats.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * ASTRONODE_CONTACT_STATS: RSSI and duration bins, hour-of-day bucketing over simulated
+ * days of updates every 15 minutes, halving of the history, and a module reset (end of
+ * the last contact back to 0) which is not a contact.
+ ****************************************************************************************/
+
+#include "astronode.h"
+#include "astronode_posix.h"
+#include "astronode_sim.h"
+#include "astronode_stats.h"
+#include "test.h"
+
+#define DAY0 1699920000 // 2023-11-14 00:00 UTC
+#define UPDATE_PERIOD 900
+#define CONTACT_HOUR 5
+
+static ASTRONODE::ASTRONODE_LCD_STRUCT contact(uint32_t end,
+                                               uint32_t duration,
+                                               uint8_t rssi)
+{
+  ASTRONODE::ASTRONODE_LCD_STRUCT lcd = {};
+  lcd.time_start_last_contact = end - duration;
+  lcd.time_end_last_contact = end;
+  lcd.peak_rssi_last_contact = rssi;
+  return lcd;
+}
+
+static void bins(ASTRONODE_CONTACT_STATS &stats)
+{
+  CHECK(stats.rssi_bin(0) == 0 && stats.rssi_bin(ASTRONODE_STATS_RSSI_BIN_WIDTH - 1) == 0);
+  CHECK(stats.rssi_bin(ASTRONODE_STATS_RSSI_BIN_WIDTH) == 1);
+  CHECK(stats.rssi_bin(ASTRONODE_STATS_BINS * ASTRONODE_STATS_RSSI_BIN_WIDTH - 1) == ASTRONODE_STATS_BINS - 1);
+  CHECK(stats.rssi_bin(255) == ASTRONODE_STATS_BINS - 1);
+
+  CHECK(stats.duration_bin(0) == 0 && stats.duration_bin(15) == 0);
+  CHECK(stats.duration_bin(16) == 1 && stats.duration_bin(30) == 1);
+  CHECK(stats.duration_bin(31) == 2 && stats.duration_bin(60) == 2);
+  CHECK(stats.duration_bin(61) == 3);
+  CHECK(stats.duration_bin(15u << (ASTRONODE_STATS_BINS - 2)) == ASTRONODE_STATS_BINS - 2);
+  CHECK(stats.duration_bin(0xFFFFFFFF) == ASTRONODE_STATS_BINS - 1);
+}
+
+static void hours_and_histograms(ASTRONODE_CONTACT_STATS &stats)
+{
+  // A contact every day during CONTACT_HOUR, another one every other day during the next hour
+  ASTRONODE::ASTRONODE_LCD_STRUCT lcd = contact(DAY0 - 3600, 40, 9);
+  for (uint32_t now = DAY0; now < DAY0 + 10 * 86400; now += UPDATE_PERIOD)
+  {
+    uint32_t day = (now - DAY0) / 86400;
+    uint32_t second_of_day = (now - DAY0) % 86400;
+    if (second_of_day == CONTACT_HOUR * 3600 + 1800)
+    {
+      lcd = contact(now - 60, 40, 9); // Duration bin 2, RSSI bin 2
+    }
+    if (second_of_day == (CONTACT_HOUR + 1) * 3600 + 1800 && day % 2 == 0)
+    {
+      lcd = contact(now - 60, 10, 21); // Duration bin 0, RSSI bin 5
+    }
+    stats.add_lcd(lcd, now);
+  }
+
+  CHECK(stats.contact_count() == 15);
+  CHECK(stats.contact_probability(CONTACT_HOUR) == 1000);
+  CHECK(stats.contact_probability(CONTACT_HOUR + 1) == 500);
+  CHECK(stats.contact_probability(CONTACT_HOUR + 2) == 0);
+  CHECK(stats.best_hour(0, 24) == CONTACT_HOUR);
+  CHECK(stats.best_hour(CONTACT_HOUR + 1, 3) == CONTACT_HOUR + 1);
+
+  CHECK(stats.rssi_histogram(2) == 10 && stats.rssi_histogram(5) == 5);
+  CHECK(stats.duration_histogram(2) == 10 && stats.duration_histogram(0) == 5);
+  CHECK(stats.rssi_percentile(50) == 2 * ASTRONODE_STATS_RSSI_BIN_WIDTH);
+  CHECK(stats.rssi_percentile(90) == 5 * ASTRONODE_STATS_RSSI_BIN_WIDTH);
+  CHECK(stats.duration_percentile(30) == 15);
+  CHECK(stats.duration_percentile(100) == 60);
+
+  // Hour never observed
+  stats.clear();
+  stats.add_lcd(lcd, DAY0 + 3 * 3600);
+  stats.add_lcd(lcd, DAY0 + 4 * 3600);
+  CHECK(stats.contact_probability(3) == 0);
+  CHECK(stats.contact_probability(4) == STATS_PROBABILITY_UNKNOWN);
+  CHECK(stats.best_hour(5, 10) == -1);
+}
+
+static void halving(ASTRONODE_CONTACT_STATS &stats)
+{
+  stats.clear();
+  uint32_t now = DAY0;
+  stats.add_lcd(contact(now, 10, 0), now);
+  for (uint8_t i = 0; i < ASTRONODE_STATS_HISTORY; i++)
+  {
+    now += UPDATE_PERIOD;
+    stats.add_lcd(contact(now, 10, 0), now);
+  }
+  CHECK(stats.rssi_histogram(0) == ASTRONODE_STATS_HISTORY);
+  now += UPDATE_PERIOD;
+  stats.add_lcd(contact(now, 10, 30), now);
+  CHECK(stats.rssi_histogram(0) == ASTRONODE_STATS_HISTORY / 2);
+  CHECK(stats.rssi_histogram(7) == 1);
+}
+
+static void module_reset(void)
+{
+  ASTRONODE_SIM sim;
+  CHECK(sim.start());
+  ASTRONODE_POSIX_SERIAL serial;
+  CHECK(serial.attach(sim.slave));
+  ASTRONODE astronode;
+  CHECK(astronode.begin(serial) == ANS_STATUS_SUCCESS);
+  ASTRONODE_CONTACT_STATS stats(astronode);
+
+  uint32_t now = DAY0;
+  sim.contact_end = 400;
+  CHECK(stats.update(now) == ANS_STATUS_SUCCESS && stats.contact_count() == 0);
+  sim.contact_end = 800;
+  CHECK(stats.update(now += UPDATE_PERIOD) == ANS_STATUS_SUCCESS && stats.contact_count() == 1);
+
+  // Reset: no last contact, then the next contact (earlier end, module time restarted)
+  sim.contact_end = 0;
+  CHECK(stats.update(now += UPDATE_PERIOD) == ANS_STATUS_SUCCESS && stats.contact_count() == 1);
+  CHECK(stats.update(now += UPDATE_PERIOD) == ANS_STATUS_SUCCESS && stats.contact_count() == 1);
+  sim.contact_end = 300;
+  CHECK(stats.update(now += UPDATE_PERIOD) == ANS_STATUS_SUCCESS && stats.contact_count() == 2);
+  CHECK(stats.update(now += UPDATE_PERIOD) == ANS_STATUS_SUCCESS && stats.contact_count() == 2);
+
+  // Reset seen with the end of the contact before it already (not back to 0)
+  sim.contact_end = 200;
+  CHECK(stats.update(now += UPDATE_PERIOD) == ANS_STATUS_SUCCESS && stats.contact_count() == 2);
+  sim.contact_end = 250;
+  CHECK(stats.update(now += UPDATE_PERIOD) == ANS_STATUS_SUCCESS && stats.contact_count() == 3);
+}
+
+int main(void)
+{
+  ASTRONODE astronode;
+  ASTRONODE_CONTACT_STATS stats(astronode);
+
+  bins(stats);
+  hours_and_histograms(stats);
+  halving(stats);
+  module_reset();
+
+  TEST_PASSED();
+}
@@ -0,0 +1,123 @@
+/******************************************************************************************
+ * File:        test_status.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * ASTRONODE::status_to_string(): every ans_status_e value against the messages of the
+ * former print_error_code_string() switch, every other code 0x0000..0xFFFF unknown (all
+ * the entries of the sorted table are found by the binary search), and the copy into a
+ * caller buffer.
+ ****************************************************************************************/
+
+#include "astronode.h"
+#include "test.h"
+
+#include <string>
+
+// Output of print_error_code_string() before the table (switch of the previous version)
+static const char *switch_message(uint16_t code)
+{
+  switch (code)
+  {
+  case ANS_STATUS_CRC_NOT_VALID:
+    return "ASTRONODE: Discrepancy between provided CRC and expected CRC.\n";
+  case ANS_STATUS_LENGTH_NOT_VALID:
+    return "ASTRONODE: Message exceeds the maximum length for a frame.\n";
+  case ANS_STATUS_OPCODE_NOT_VALID:
+    return "ASTRONODE: Invalid Operation Code used.\n";
+  case ANS_STATUS_ARG_NOT_VALID:
+    return "ASTRONODE: Invalid argument used.\n";
+  case ANS_STATUS_FLASH_WRITING_FAILED:
+    return "ASTRONODE: Failed to write to the flash.\n";
+  case ANS_STATUS_DEVICE_BUSY:
+    return "ASTRONODE: Device is busy.\n";
+  case ANS_STATUS_FORMAT_NOT_VALID:
+    return "ASTRONODE: At least one of the fields (SSID, password, token) is not composed of exclusively printable standard ASCII characters (0x20 to 0x7E).\n";
+  case ANS_STATUS_PERIOD_INVALID:
+    return "ASTRONODE: The Satellite Search Config period enumeration value is not valid.\n";
+  case ANS_STATUS_BUFFER_FULL:
+    return "ASTRONODE: Failed to queue the payload because the sending queue is already full.\n";
+  case ANS_STATUS_DUPLICATE_ID:
+    return "ASTRONODE: Failed to queue the payload because the Payload ID provided by the asset is already in use in the terminal queue.\n";
+  case ANS_STATUS_BUFFER_EMPTY:
+    return "ASTRONODE: Failed to dequeue a payload from the buffer because the buffer is empty.\n";
+  case ANS_STATUS_INVALID_POS:
+    return "ASTRONODE: Invalid position.\n";
+  case ANS_STATUS_NO_ACK:
+    return "ASTRONODE: No satellite acknowledgement available for any payload.\n";
+  case ANS_STATUS_NO_ACK_CLEAR:
+    return "ASTRONODE: No payload ack to clear, or it was already cleared.\n";
+  case ANS_STATUS_NO_COMMAND:
+    return "ASTRONODE: No command is available.\n";
+  case ANS_STATUS_NO_COMMAND_CLEAR:
+    return "ASTRONODE: No command to clear, or it was already cleared.\n";
+  case ANS_STATUS_MAX_TX_REACHED:
+    return "ASTRONODE: Failed to test Tx due to the maximum number of transmissions being reached.\n";
+  case ANS_STATUS_TIMEOUT:
+    return "ASTRONODE: Failed to receive data from astronode before timeout.\n";
+  case ANS_STATUS_HW_ERR:
+    return "ASTRONODE: Failed to send data to the terminal.\n";
+  case ANS_STATUS_SUCCESS:
+  case ANS_STATUS_DATA_SENT:
+  case ANS_STATUS_DATA_RECEIVED:
+    return "";
+  default:
+    return "ASTRONODE: Unknown error code.\n";
+  }
+}
+
+static const char *message(uint16_t code)
+{
+  return reinterpret_cast<const char *>(ASTRONODE::status_to_string(code));
+}
+
+int main(void)
+{
+  // Statuses of the module, as printed before
+  const uint16_t module_codes[] = {ANS_STATUS_CRC_NOT_VALID, ANS_STATUS_LENGTH_NOT_VALID, ANS_STATUS_OPCODE_NOT_VALID,
+                                   ANS_STATUS_ARG_NOT_VALID, ANS_STATUS_FLASH_WRITING_FAILED, ANS_STATUS_DEVICE_BUSY,
+                                   ANS_STATUS_FORMAT_NOT_VALID, ANS_STATUS_PERIOD_INVALID, ANS_STATUS_BUFFER_FULL,
+                                   ANS_STATUS_DUPLICATE_ID, ANS_STATUS_BUFFER_EMPTY, ANS_STATUS_INVALID_POS,
+                                   ANS_STATUS_NO_ACK, ANS_STATUS_NO_ACK_CLEAR, ANS_STATUS_NO_COMMAND,
+                                   ANS_STATUS_NO_COMMAND_CLEAR, ANS_STATUS_MAX_TX_REACHED};
+  for (uint16_t code : module_codes)
+  {
+    CHECK(std::string("ASTRONODE: ") + message(code) + "\n" == switch_message(code));
+  }
+
+  // Statuses of the library: timeout and hardware error as before, the others not printed
+  // (success) or printed as unknown before, with their own message now
+  CHECK(std::string("ASTRONODE: ") + message(ANS_STATUS_TIMEOUT) + "\n" == switch_message(ANS_STATUS_TIMEOUT));
+  CHECK(std::string("ASTRONODE: ") + message(ANS_STATUS_HW_ERR) + "\n" == switch_message(ANS_STATUS_HW_ERR));
+  CHECK(strcmp(switch_message(ANS_STATUS_SUCCESS), "") == 0 && strcmp(message(ANS_STATUS_SUCCESS), "Success.") == 0);
+  CHECK(strcmp(switch_message(ANS_STATUS_DATA_SENT), "") == 0 && strcmp(message(ANS_STATUS_DATA_SENT), "Data sent.") == 0);
+  CHECK(strcmp(message(ANS_STATUS_DATA_RECEIVED), "Data received.") == 0);
+  CHECK(strcmp(message(ANS_STATUS_PAYLOAD_TOO_LONG), "Payload exceeds the maximum payload size.") == 0);
+  CHECK(strcmp(message(ANS_STATUS_PAYLOD_ID_CHECK_FAILED), "Enqueued payload ID does not match the requested one.") == 0);
+  CHECK(strcmp(message(ANS_STATUS_PENDING), "Request in progress.") == 0);
+
+  // Every code: a message for each ans_status_e value only, each found by the binary search
+  const char *unknown = message(0xFFFF);
+  CHECK(strcmp(unknown, "Unknown error code.") == 0);
+  int known = 0;
+  for (uint32_t code = 0; code <= 0xFFFF; code++)
+  {
+    bool status = (code >= ANS_STATUS_SUCCESS && code <= ANS_STATUS_PENDING) ||
+                  (strcmp(switch_message(code), "ASTRONODE: Unknown error code.\n") != 0);
+    CHECK((message(code) != unknown) == status);
+    known += status;
+  }
+  CHECK(known == 17 + (ANS_STATUS_PENDING - ANS_STATUS_SUCCESS + 1));
+
+  // Copy into a buffer, truncated to its length
+  char buffer[16];
+  CHECK(ASTRONODE::status_to_string(ANS_STATUS_DEVICE_BUSY, buffer, sizeof(buffer)) == 15);
+  CHECK(strcmp(buffer, "Device is busy.") == 0);
+  CHECK(ASTRONODE::status_to_string(ANS_STATUS_NO_ACK, buffer, sizeof(buffer)) == 15);
+  CHECK(strcmp(buffer, "No satellite ac") == 0);
+  CHECK(ASTRONODE::status_to_string(ANS_STATUS_NO_ACK, buffer, 0) == 0);
+  CHECK(strcmp(buffer, "No satellite ac") == 0);
+
+  TEST_PASSED();
+}
@@ -0,0 +1,62 @@
+/******************************************************************************************
+ * File:        test_sync.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * ASTRONODE::configuration_sync(): no write or save while the configuration is unchanged,
+ * one write and one save when it changed, and a failed read of the configuration returned
+ * without writing or saving anything.
+ ****************************************************************************************/
+
+#include "astronode.h"
+#include "astronode_posix.h"
+#include "astronode_sim.h"
+#include "test.h"
+
+static ans_status_e sync(ASTRONODE &astronode,
+                         bool with_pl_ack)
+{
+  return astronode.configuration_sync(with_pl_ack, true, true, false, false, true, true, false);
+}
+
+int main(void)
+{
+  ASTRONODE_SIM sim;
+  CHECK(sim.start());
+  ASTRONODE_POSIX_SERIAL serial;
+  CHECK(serial.attach(sim.slave));
+  ASTRONODE astronode;
+  CHECK(astronode.begin(serial) == ANS_STATUS_SUCCESS);
+  astronode.set_request_retries(0);
+
+  // First sync: changed, written, saved and read back
+  CHECK(sync(astronode, true) == ANS_STATUS_SUCCESS);
+  CHECK(sim.cfg_writes == 1 && sim.cfg_saves == 1);
+  CHECK(astronode.config.with_pl_ack == true && astronode.config.with_msg_cmd_pin_en == true);
+
+  // Unchanged: no request at all
+  int frames = sim.frames;
+  CHECK(sync(astronode, true) == ANS_STATUS_SUCCESS);
+  CHECK(sync(astronode, true) == ANS_STATUS_SUCCESS);
+  CHECK(sim.cfg_writes == 1 && sim.cfg_saves == 1 && sim.frames == frames);
+
+  // Changed: one write, one save
+  CHECK(sync(astronode, false) == ANS_STATUS_SUCCESS);
+  CHECK(sim.cfg_writes == 2 && sim.cfg_saves == 2);
+  CHECK(astronode.config.with_pl_ack == false);
+
+  // Configuration unknown (factory reset) and its read unanswered: error returned, nothing written or saved
+  CHECK(astronode.factory_reset() == ANS_STATUS_SUCCESS);
+  frames = sim.frames;
+  sim.drop = 1;
+  CHECK(sync(astronode, false) == ANS_STATUS_TIMEOUT);
+  CHECK(sim.frames == frames + 1 && sim.cfg_writes == 2 && sim.cfg_saves == 2); // The CFG_RR only
+
+  // Read on the next sync: the default configuration differs, written and saved once
+  CHECK(sync(astronode, false) == ANS_STATUS_SUCCESS);
+  CHECK(sim.cfg_writes == 3 && sim.cfg_saves == 3);
+  CHECK(astronode.config.with_geoloc == true && astronode.config.with_msg_reset_pin_en == true);
+
+  TEST_PASSED();
+}
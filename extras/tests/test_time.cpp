@@ -0,0 +1,68 @@
+/******************************************************************************************
+ * File:        test_time.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * ASTRONODE_TIME: local time served after a sync, and MCU sleeps not counted by millis()
+ * reported with slept().
+ ****************************************************************************************/
+
+#include "astronode.h"
+#include "astronode_posix.h"
+#include "astronode_sim.h"
+#include "astronode_time.h"
+#include "test.h"
+
+#define SLEEP_S 600
+
+// Within one second: the module RTC is read after the local time
+static bool same_second(uint32_t local,
+                        uint32_t module)
+{
+  return module - local + 1 <= 2;
+}
+
+int main(void)
+{
+  ASTRONODE_SIM sim;
+  sim.rtc_live = true;
+  CHECK(sim.start());
+  ASTRONODE_POSIX_SERIAL serial;
+  CHECK(serial.attach(sim.slave));
+  ASTRONODE astronode;
+  CHECK(astronode.begin(serial) == ANS_STATUS_SUCCESS);
+
+  ASTRONODE_TIME clock(astronode, 1000);
+  CHECK(clock.update() == ANS_STATUS_SUCCESS && clock.synced());
+  uint32_t rtc_time;
+  CHECK(astronode.rtc_read(&rtc_time) == ANS_STATUS_SUCCESS);
+  CHECK(same_second(clock.now(), rtc_time));
+  CHECK(clock.nco() == 120 || clock.nco() == 119);
+  CHECK(clock.error_ms() < 100);
+  int frames = sim.frames;
+  CHECK(clock.update() == ANS_STATUS_SUCCESS && sim.frames == frames); // No request while the error is low
+
+  // Standby: the module RTC runs, millis() does not
+  {
+    std::lock_guard<std::mutex> guard(sim.lock);
+    sim.rtc += SLEEP_S;
+  }
+  CHECK(astronode.rtc_read(&rtc_time) == ANS_STATUS_SUCCESS);
+  CHECK(rtc_time - clock.now() >= SLEEP_S - 1);
+
+  clock.slept(SLEEP_S * 1000);
+  CHECK(same_second(clock.now(), rtc_time));
+  CHECK(clock.nco() == 0);
+  CHECK(clock.error_ms() >= SLEEP_S * 1000 / 1000000.0 * ASTRONODE_TIME_SLEEP_PPM);
+
+  // The sleep uncertainty exceeds max_error: synced again
+  frames = sim.frames;
+  CHECK(clock.update() == ANS_STATUS_SUCCESS && sim.frames > frames);
+  CHECK(clock.error_ms() < 100 && clock.drift_ppm() == 0);
+  CHECK(astronode.rtc_read(&rtc_time) == ANS_STATUS_SUCCESS);
+  CHECK(same_second(clock.now(), rtc_time));
+  CHECK(clock.nco() == 120 || clock.nco() == 119);
+
+  TEST_PASSED();
+}
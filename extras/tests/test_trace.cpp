@@ -0,0 +1,94 @@
+/******************************************************************************************
+ * File:        test_trace.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * ASTRONODE_TRACE_PLAYER: replay of a recorded session (traces/session.ant) through
+ * ASTRONODE. The session must give the recorded answers and send exactly the recorded
+ * requests. Run "build/test_trace record" to record the trace again on the simulator
+ * after a change of the requests sent by the library.
+ ****************************************************************************************/
+
+#include "astronode.h"
+#include "astronode_posix.h"
+#include "astronode_sim.h"
+#include "astronode_trace.h"
+#include "test.h"
+
+#define TRACE_PATH "traces/session.ant"
+#define SESSION_RTC 12345
+#define SESSION_PAYLOAD_ID 7
+
+static void session(Stream &port)
+{
+  ASTRONODE astronode;
+  CHECK(astronode.begin(port) == ANS_STATUS_SUCCESS);
+  CHECK(astronode.configuration_write(true, false, false, false, false, false, true, false) == ANS_STATUS_SUCCESS);
+
+  uint8_t data[80];
+  for (uint8_t i = 0; i < sizeof(data); i++)
+  {
+    data[i] = i;
+  }
+  CHECK(astronode.enqueue_payload(data, sizeof(data), SESSION_PAYLOAD_ID) == ANS_STATUS_SUCCESS);
+
+  uint32_t rtc_time;
+  CHECK(astronode.rtc_read(&rtc_time) == ANS_STATUS_SUCCESS);
+  CHECK(rtc_time == SESSION_RTC + ASTROCAST_REF_UNIX_TIME);
+  CHECK(astronode.read_performance_counter() == ANS_STATUS_SUCCESS);
+  CHECK(astronode.per_struct.queued_msg_cnt == 1);
+  uint16_t id;
+  CHECK(astronode.read_satellite_ack(&id) == ANS_STATUS_NO_ACK);
+}
+
+static void record(void)
+{
+  ASTRONODE_SIM sim;
+  sim.rtc = SESSION_RTC;
+  sim.delay_ms = 5;
+  CHECK(sim.start());
+  ASTRONODE_POSIX_SERIAL serial;
+  CHECK(serial.attach(sim.slave));
+
+  ASTRONODE_TRACE_FILE trace;
+  CHECK(trace.open(TRACE_PATH));
+  ASTRONODE_TRACE_RECORDER recorder(serial, trace);
+  session(recorder);
+  recorder.trace_flush();
+  trace.close();
+  CHECK(recorder.trace_dropped() == 0);
+}
+
+int main(int argc,
+         char *argv[])
+{
+  if (argc > 1 && strcmp(argv[1], "record") == 0)
+  {
+    record();
+    printf("%s recorded\n", TRACE_PATH);
+    return 0;
+  }
+
+  // Without delay, then 10 times faster than recorded
+  const uint16_t speeds[] = {0, 10};
+  for (uint16_t speed : speeds)
+  {
+    ASTRONODE_TRACE_PLAYER player;
+    CHECK(player.open(TRACE_PATH, speed));
+    session(player);
+    CHECK(player.mismatches() == 0);
+    CHECK(player.done());
+  }
+
+  // A request differing from the recorded one is counted
+  ASTRONODE_TRACE_PLAYER player;
+  CHECK(player.open(TRACE_PATH, 0));
+  ASTRONODE astronode;
+  CHECK(astronode.begin(player) == ANS_STATUS_SUCCESS);
+  CHECK(player.mismatches() == 0);
+  CHECK(astronode.configuration_write(false, false, false, false, false, false, true, false) == ANS_STATUS_SUCCESS);
+  CHECK(player.mismatches() > 0);
+
+  TEST_PASSED();
+}
@@ -0,0 +1,156 @@
+/******************************************************************************************
+ * File:        test_uplink.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * ASTRONODE_UPLINK: priority preemption (down to the head of the module queue) and
+ * latest-value supersede, and both when the dequeue fails or does not remove the last
+ * payload queued.
+ ****************************************************************************************/
+
+#include "astronode.h"
+#include "astronode_posix.h"
+#include "astronode_sim.h"
+#include "astronode_uplink.h"
+#include "test.h"
+
+static uint8_t data[10] = {1, 2, 3};
+
+static void clear_module_queue(ASTRONODE_SIM &sim)
+{
+  std::lock_guard<std::mutex> guard(sim.lock);
+  sim.queue.clear();
+}
+
+static void preemption(ASTRONODE &astronode,
+                       ASTRONODE_SIM &sim)
+{
+  clear_module_queue(sim);
+  ASTRONODE_UPLINK uplink(astronode);
+  for (uint16_t id = 1; id <= ASN_MSG_QUEUE_SIZE; id++)
+  {
+    CHECK(uplink.enqueue_payload(data, sizeof(data), id, UPLINK_PRIORITY_LOW) == ANS_STATUS_SUCCESS);
+  }
+  CHECK(uplink.enqueue_payload(data, sizeof(data), 9, UPLINK_PRIORITY_LOW) == ANS_STATUS_PENDING);
+  CHECK(uplink.enqueue_payload(data, sizeof(data), 9, UPLINK_PRIORITY_LOW) == ANS_STATUS_DUPLICATE_ID);
+
+  // Goes first after the head (may be in transmission), the low priority payloads are enqueued again behind it
+  CHECK(uplink.enqueue_payload(data, sizeof(data), 100, UPLINK_PRIORITY_HIGH) == ANS_STATUS_SUCCESS);
+  CHECK(sim.queue_ids() == std::vector<uint16_t>({1, 100, 2, 3, 4, 5, 6, 7}));
+  CHECK(uplink.displaced_total() == ASN_MSG_QUEUE_SIZE - 1);
+  CHECK(uplink.waiting_count() == 2);
+
+  // The module sends 3 payloads: room for the waiting ones
+  {
+    std::lock_guard<std::mutex> guard(sim.lock);
+    sim.queue.erase(sim.queue.begin(), sim.queue.begin() + 3);
+  }
+  CHECK(uplink.service() == ANS_STATUS_SUCCESS);
+  CHECK(uplink.waiting_count() == 0 && uplink.in_module_count() == ASN_MSG_QUEUE_SIZE - 1);
+  CHECK(sim.queue_ids() == std::vector<uint16_t>({3, 4, 5, 6, 7, 8, 9}));
+
+  // Module queue full of high priority payloads down to a low priority head: nothing displaced
+  clear_module_queue(sim);
+  ASTRONODE_UPLINK full(astronode);
+  CHECK(full.enqueue_payload(data, sizeof(data), 1, UPLINK_PRIORITY_LOW) == ANS_STATUS_SUCCESS);
+  for (uint16_t id = 2; id <= ASN_MSG_QUEUE_SIZE; id++)
+  {
+    CHECK(full.enqueue_payload(data, sizeof(data), id, UPLINK_PRIORITY_HIGH) == ANS_STATUS_SUCCESS);
+  }
+  CHECK(full.enqueue_payload(data, sizeof(data), 200, UPLINK_PRIORITY_HIGH) == ANS_STATUS_PENDING);
+  CHECK(full.displaced_total() == 0 && full.waiting_count() == 1);
+  CHECK(sim.queue_ids().front() == 1 && sim.queue_ids().size() == ASN_MSG_QUEUE_SIZE);
+
+  // Only the head in the module queue: kept, the high priority payload goes behind it
+  clear_module_queue(sim);
+  ASTRONODE_UPLINK single(astronode);
+  CHECK(single.enqueue_payload(data, sizeof(data), 1, UPLINK_PRIORITY_LOW) == ANS_STATUS_SUCCESS);
+  CHECK(single.enqueue_payload(data, sizeof(data), 100, UPLINK_PRIORITY_HIGH) == ANS_STATUS_SUCCESS);
+  CHECK(sim.queue_ids() == std::vector<uint16_t>({1, 100}));
+  CHECK(single.displaced_total() == 0);
+}
+
+static void supersede(ASTRONODE &astronode,
+                      ASTRONODE_SIM &sim)
+{
+  // In the module: removed, the payloads after it are enqueued again
+  clear_module_queue(sim);
+  ASTRONODE_UPLINK uplink(astronode);
+  CHECK(uplink.enqueue_payload(data, sizeof(data), 1) == ANS_STATUS_SUCCESS);
+  CHECK(uplink.enqueue_latest(data, sizeof(data), 2, 7) == ANS_STATUS_SUCCESS);
+  CHECK(uplink.enqueue_payload(data, sizeof(data), 3) == ANS_STATUS_SUCCESS);
+  CHECK(uplink.enqueue_latest(data, sizeof(data), 4, 7) == ANS_STATUS_SUCCESS);
+  CHECK(sim.queue_ids() == std::vector<uint16_t>({1, 3, 4}));
+  CHECK(uplink.latest_id(7) == 4 && uplink.superseded_total() == 1);
+
+  // Head of the module queue: may be in transmission, kept
+  clear_module_queue(sim);
+  ASTRONODE_UPLINK head(astronode);
+  CHECK(head.enqueue_latest(data, sizeof(data), 20, 9) == ANS_STATUS_SUCCESS);
+  CHECK(head.enqueue_latest(data, sizeof(data), 21, 9) == ANS_STATUS_SUCCESS);
+  CHECK(sim.queue_ids() == std::vector<uint16_t>({20, 21}));
+  CHECK(head.latest_id(9) == 21);
+
+  // Waiting: replaced
+  clear_module_queue(sim);
+  ASTRONODE_UPLINK waiting(astronode);
+  for (uint16_t id = 100; id < 100 + ASN_MSG_QUEUE_SIZE; id++)
+  {
+    CHECK(waiting.enqueue_payload(data, sizeof(data), id) == ANS_STATUS_SUCCESS);
+  }
+  CHECK(waiting.enqueue_latest(data, sizeof(data), 30, 4) == ANS_STATUS_PENDING);
+  CHECK(waiting.enqueue_latest(data, sizeof(data), 31, 4) == ANS_STATUS_PENDING);
+  CHECK(waiting.waiting_count() == 1 && waiting.latest_id(4) == 31);
+}
+
+static void dequeue_failures(ASTRONODE &astronode,
+                             ASTRONODE_SIM &sim)
+{
+  clear_module_queue(sim);
+  ASTRONODE_UPLINK uplink(astronode);
+  for (uint16_t id = 1; id <= 3; id++)
+  {
+    CHECK(uplink.enqueue_payload(data, sizeof(data), id, UPLINK_PRIORITY_LOW) == ANS_STATUS_SUCCESS);
+  }
+
+  // No answer to the dequeue: the new payload is not kept
+  sim.drop = 1;
+  CHECK(uplink.enqueue_payload(data, sizeof(data), 100, UPLINK_PRIORITY_HIGH) == ANS_STATUS_TIMEOUT);
+  CHECK(uplink.entry(100) == NULL);
+  CHECK(sim.queue_ids() == std::vector<uint16_t>({1, 2, 3}));
+
+  // The module removes another payload than the last one: it is enqueued again, the new payload is not kept
+  sim.dequeue_head = true;
+  CHECK(uplink.enqueue_payload(data, sizeof(data), 100, UPLINK_PRIORITY_HIGH) == ANS_STATUS_PAYLOD_ID_CHECK_FAILED);
+  CHECK(uplink.entry(100) == NULL);
+  CHECK(sim.queue_ids() == std::vector<uint16_t>({2, 3, 1}));
+  CHECK(uplink.waiting_count() == 0 && uplink.in_module_count() == 3);
+
+  CHECK(uplink.enqueue_latest(data, sizeof(data), 10, 5, UPLINK_PRIORITY_LOW) == ANS_STATUS_SUCCESS);
+  CHECK(uplink.enqueue_latest(data, sizeof(data), 11, 5, UPLINK_PRIORITY_LOW) == ANS_STATUS_PAYLOD_ID_CHECK_FAILED);
+  CHECK(uplink.entry(11) == NULL && uplink.latest_id(5) == 10);
+  CHECK(uplink.waiting_count() == 0 && uplink.in_module_count() == 4);
+  sim.dequeue_head = false;
+
+  // Retried with the same ID once the module behaves
+  CHECK(uplink.enqueue_payload(data, sizeof(data), 100, UPLINK_PRIORITY_HIGH) == ANS_STATUS_SUCCESS);
+  CHECK(sim.queue_ids() == std::vector<uint16_t>({3, 100, 1, 2, 10}));
+  CHECK(uplink.waiting_count() == 0 && uplink.in_module_count() == 5);
+}
+
+int main(void)
+{
+  ASTRONODE_SIM sim;
+  CHECK(sim.start());
+  ASTRONODE_POSIX_SERIAL serial;
+  CHECK(serial.attach(sim.slave));
+  ASTRONODE astronode;
+  CHECK(astronode.begin(serial) == ANS_STATUS_SUCCESS);
+
+  preemption(astronode, sim);
+  supersede(astronode, sim);
+  dequeue_failures(astronode, sim);
+
+  TEST_PASSED();
+}
@@ -0,0 +1,76 @@
+/******************************************************************************************
+ * File:        test_warm.cpp
+ * Compagny:    Astrocast SA
+ * Website:     https://www.astrocast.com/
+ ******************************************************************************************/
+/****************************************************************************************
+ * begin_warm(): MCU restarts with the module running (warm), after a module reset which
+ * happened once the uptime passed the one of the first record, after factory_reset() and
+ * after configuration_save() (cold), and after configuration_sync() (warm, new record).
+ ****************************************************************************************/
+
+#include "astronode.h"
+#include "astronode_posix.h"
+#include "astronode_sim.h"
+#include "test.h"
+
+#define NVM_PATH "build/test_warm.nvm"
+
+// MCU restart: a new ASTRONODE on the same module and record. Returns true on a warm start.
+static bool restart(ASTRONODE &astronode,
+                    ASTRONODE_POSIX_SERIAL &serial,
+                    ASTRONODE_NVM_FILE &nvm,
+                    ASTRONODE_SIM &sim)
+{
+  int cfg_reads = sim.cfg_reads;
+  astronode = ASTRONODE();
+  CHECK(astronode.begin_warm(serial, nvm) == ANS_STATUS_SUCCESS);
+  return sim.cfg_reads == cfg_reads;
+}
+
+int main(void)
+{
+  ASTRONODE_SIM sim;
+  CHECK(sim.start());
+  ASTRONODE_POSIX_SERIAL serial;
+  CHECK(serial.attach(sim.slave));
+  unlink(NVM_PATH);
+  ASTRONODE_NVM_FILE nvm;
+  CHECK(nvm.open(NVM_PATH));
+  ASTRONODE astronode;
+
+  // First start, then the module keeps running
+  sim.uptime = 1000;
+  CHECK(!restart(astronode, serial, nvm, sim));
+  sim.uptime = 3000;
+  CHECK(restart(astronode, serial, nvm, sim));
+
+  // Module reset, its uptime passed the one of the first record: seen with the uptime of the last warm start
+  sim.uptime = 2000;
+  CHECK(!restart(astronode, serial, nvm, sim));
+  sim.uptime = 2100;
+  CHECK(restart(astronode, serial, nvm, sim));
+
+  // Factory reset
+  CHECK(astronode.factory_reset() == ANS_STATUS_SUCCESS);
+  sim.uptime = 2200;
+  CHECK(!restart(astronode, serial, nvm, sim));
+  CHECK(astronode.config.with_pl_ack == false);
+
+  // New configuration through configuration_sync(): the record is rewritten with it
+  CHECK(astronode.configuration_sync(true, false, false, false, false, false, true, false) == ANS_STATUS_SUCCESS);
+  sim.uptime = 2300;
+  CHECK(restart(astronode, serial, nvm, sim));
+  CHECK(astronode.config.with_pl_ack == true && astronode.config.with_msg_cmd_pin_en == true);
+
+  // configuration_save() alone
+  CHECK(astronode.configuration_save() == ANS_STATUS_SUCCESS);
+  sim.uptime = 2400;
+  CHECK(!restart(astronode, serial, nvm, sim));
+  sim.uptime = 2500;
+  CHECK(restart(astronode, serial, nvm, sim));
+
+  nvm.close();
+  unlink(NVM_PATH);
+  TEST_PASSED();
+}